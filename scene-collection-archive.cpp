@@ -0,0 +1,581 @@
+#include "scene-collection-archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <zlib.h>
+
+#include "util/base.h"
+#include "util/platform.h"
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP_END_SIGNATURE 0x06054b50
+#define ZIP64_END_SIGNATURE 0x06064b50
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP64_EXTRA_ID 0x0001
+#define ZIP_FLAG_UTF8 0x0800
+#define ZIP_VERSION 20
+#define ZIP64_VERSION 45
+#define ZIP_METHOD_STORE 0
+#define ZIP_METHOD_DEFLATE 8
+#define ZIP_CHUNK_SIZE (256 * 1024)
+/* entries read into memory are scene collections, anything larger is not one and is not allocated */
+#define ZIP_MAX_STRING_SIZE ((uint64_t)256 * 1024 * 1024)
+
+static uint16_t read16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read64(const uint8_t *p)
+{
+	return (uint64_t)read32(p) | ((uint64_t)read32(p + 4) << 32);
+}
+
+static void put16(std::vector<uint8_t> &v, uint16_t value)
+{
+	v.push_back((uint8_t)(value & 0xFF));
+	v.push_back((uint8_t)(value >> 8));
+}
+
+static void put32(std::vector<uint8_t> &v, uint32_t value)
+{
+	put16(v, (uint16_t)(value & 0xFFFF));
+	put16(v, (uint16_t)(value >> 16));
+}
+
+static void put64(std::vector<uint8_t> &v, uint64_t value)
+{
+	put32(v, (uint32_t)(value & 0xFFFFFFFF));
+	put32(v, (uint32_t)(value >> 32));
+}
+
+ZipReader::~ZipReader()
+{
+	Close();
+}
+
+void ZipReader::Close()
+{
+	if (file)
+		fclose(file);
+	file = nullptr;
+	entries.clear();
+}
+
+bool ZipReader::Open(const char *path)
+{
+	Close();
+	file = os_fopen(path, "rb");
+	if (!file)
+		return false;
+
+	os_fseeki64(file, 0, SEEK_END);
+	const int64_t file_size = os_ftelli64(file);
+	if (file_size < 22) {
+		Close();
+		return false;
+	}
+	/* the end of central directory record is followed by a comment of at most 64k */
+	const int64_t tail_size = std::min<int64_t>(file_size, 22 + 0xFFFF);
+	std::vector<uint8_t> tail((size_t)tail_size);
+	os_fseeki64(file, file_size - tail_size, SEEK_SET);
+	if (fread(tail.data(), 1, tail.size(), file) != tail.size()) {
+		Close();
+		return false;
+	}
+	int64_t end = -1;
+	for (int64_t i = tail_size - 22; i >= 0; i--) {
+		if (read32(&tail[(size_t)i]) == ZIP_END_SIGNATURE) {
+			end = i;
+			break;
+		}
+	}
+	if (end < 0) {
+		Close();
+		return false;
+	}
+	const uint8_t *eocd = &tail[(size_t)end];
+	uint64_t count = read16(eocd + 10);
+	uint64_t offset = read32(eocd + 16);
+	if (count == 0xFFFF || offset == 0xFFFFFFFF) {
+		const int64_t end_position = file_size - tail_size + end;
+		uint8_t locator[20];
+		uint8_t eocd64[56];
+		if (end_position < 20 || os_fseeki64(file, end_position - 20, SEEK_SET) != 0 ||
+		    fread(locator, 1, sizeof(locator), file) != sizeof(locator) || read32(locator) != ZIP64_LOCATOR_SIGNATURE ||
+		    os_fseeki64(file, (int64_t)read64(locator + 8), SEEK_SET) != 0 ||
+		    fread(eocd64, 1, sizeof(eocd64), file) != sizeof(eocd64) || read32(eocd64) != ZIP64_END_SIGNATURE) {
+			Close();
+			return false;
+		}
+		count = read64(eocd64 + 32);
+		offset = read64(eocd64 + 48);
+	}
+	if (!ReadCentralDirectory(offset, count)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool ZipReader::ReadCentralDirectory(uint64_t offset, uint64_t count)
+{
+	if (os_fseeki64(file, (int64_t)offset, SEEK_SET) != 0)
+		return false;
+	uint8_t header[46];
+	std::vector<uint8_t> extra;
+	for (uint64_t i = 0; i < count; i++) {
+		if (fread(header, 1, sizeof(header), file) != sizeof(header) || read32(header) != ZIP_CENTRAL_HEADER_SIGNATURE)
+			return false;
+		ArchiveEntry entry;
+		entry.method = read16(header + 10);
+		entry.crc = read32(header + 16);
+		entry.compressed_size = read32(header + 20);
+		entry.size = read32(header + 24);
+		const uint16_t name_length = read16(header + 28);
+		const uint16_t extra_length = read16(header + 30);
+		const uint16_t comment_length = read16(header + 32);
+		entry.offset = read32(header + 42);
+
+		entry.name.resize(name_length);
+		extra.resize(extra_length);
+		if ((name_length && fread(&entry.name[0], 1, name_length, file) != name_length) ||
+		    (extra_length && fread(extra.data(), 1, extra_length, file) != extra_length) ||
+		    os_fseeki64(file, comment_length, SEEK_CUR) != 0)
+			return false;
+
+		for (size_t pos = 0; pos + 4 <= extra.size();) {
+			const uint16_t id = read16(&extra[pos]);
+			const uint16_t size = read16(&extra[pos + 2]);
+			const size_t end = std::min(extra.size(), pos + 4 + size);
+			pos += 4;
+			if (id == ZIP64_EXTRA_ID) {
+				if (entry.size == 0xFFFFFFFF && pos + 8 <= end) {
+					entry.size = read64(&extra[pos]);
+					pos += 8;
+				}
+				if (entry.compressed_size == 0xFFFFFFFF && pos + 8 <= end) {
+					entry.compressed_size = read64(&extra[pos]);
+					pos += 8;
+				}
+				if (entry.offset == 0xFFFFFFFF && pos + 8 <= end) {
+					entry.offset = read64(&extra[pos]);
+					pos += 8;
+				}
+			}
+			pos = end;
+		}
+		std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+		entry.directory = !entry.name.empty() && entry.name.back() == '/';
+		entries.push_back(std::move(entry));
+	}
+	std::sort(entries.begin(), entries.end(),
+		  [](const ArchiveEntry &a, const ArchiveEntry &b) { return a.offset < b.offset; });
+	return true;
+}
+
+bool ZipReader::Read(const ArchiveEntry &entry, const std::function<bool(const uint8_t *data, size_t size)> &write)
+{
+	if (!file || entry.directory)
+		return false;
+	if (entry.method != ZIP_METHOD_STORE && entry.method != ZIP_METHOD_DEFLATE) {
+		blog(LOG_WARNING, "[Scene Collection Manager] unsupported compression method %d for '%s'", entry.method,
+		     entry.name.c_str());
+		return false;
+	}
+
+	uint8_t header[30];
+	if (os_fseeki64(file, (int64_t)entry.offset, SEEK_SET) != 0 || fread(header, 1, sizeof(header), file) != sizeof(header) ||
+	    read32(header) != ZIP_LOCAL_HEADER_SIGNATURE)
+		return false;
+	if (os_fseeki64(file, (int64_t)read16(header + 26) + read16(header + 28), SEEK_CUR) != 0)
+		return false;
+
+	std::vector<uint8_t> in(ZIP_CHUNK_SIZE);
+	std::vector<uint8_t> out(entry.method == ZIP_METHOD_DEFLATE ? ZIP_CHUNK_SIZE : 0);
+	z_stream zs = {};
+	if (entry.method == ZIP_METHOD_DEFLATE && inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+		return false;
+
+	uLong crc = crc32(0L, Z_NULL, 0);
+	uint64_t remaining = entry.compressed_size;
+	uint64_t written = 0;
+	bool success = true;
+	int zr = Z_OK;
+	while (success && (remaining > 0 || (entry.method == ZIP_METHOD_DEFLATE && zr != Z_STREAM_END))) {
+		const size_t chunk = (size_t)std::min<uint64_t>(remaining, in.size());
+		if (chunk && fread(in.data(), 1, chunk, file) != chunk) {
+			success = false;
+			break;
+		}
+		remaining -= chunk;
+		if (entry.method == ZIP_METHOD_STORE) {
+			crc = crc32(crc, in.data(), (uInt)chunk);
+			written += chunk;
+			success = write(in.data(), chunk);
+			continue;
+		}
+		zs.next_in = in.data();
+		zs.avail_in = (uInt)chunk;
+		do {
+			zs.next_out = out.data();
+			zs.avail_out = (uInt)out.size();
+			zr = inflate(&zs, Z_NO_FLUSH);
+			if (zr != Z_OK && zr != Z_STREAM_END && !(zr == Z_BUF_ERROR && zs.avail_in == 0)) {
+				success = false;
+				break;
+			}
+			const size_t produced = out.size() - zs.avail_out;
+			if (produced) {
+				crc = crc32(crc, out.data(), (uInt)produced);
+				written += produced;
+				if (!write(out.data(), produced))
+					success = false;
+			}
+		} while (success && zs.avail_out == 0 && zr != Z_STREAM_END);
+		if (success && chunk == 0 && zr != Z_STREAM_END)
+			success = false;
+	}
+	if (entry.method == ZIP_METHOD_DEFLATE)
+		inflateEnd(&zs);
+
+	if (success && (written != entry.size || (uint32_t)crc != entry.crc)) {
+		blog(LOG_WARNING, "[Scene Collection Manager] corrupt archive entry '%s'", entry.name.c_str());
+		success = false;
+	}
+	return success;
+}
+
+bool ZipReader::ReadToString(const ArchiveEntry &entry, std::string &out)
+{
+	out.clear();
+	if (entry.size > ZIP_MAX_STRING_SIZE) {
+		blog(LOG_WARNING, "[Scene Collection Manager] archive entry '%s' is too large to read", entry.name.c_str());
+		return false;
+	}
+	out.reserve((size_t)entry.size);
+	/* the header size is only checked after inflating, so more data than it claims stops the read here */
+	const bool success = Read(entry, [&out, &entry](const uint8_t *data, size_t size) {
+		if (out.size() + size > entry.size)
+			return false;
+		out.append((const char *)data, size);
+		return true;
+	});
+	if (!success)
+		out.clear();
+	return success;
+}
+
+bool ZipReader::Extract(const ArchiveEntry &entry, const std::string &path)
+{
+	const auto slash = path.find_last_of('/');
+	if (slash != std::string::npos)
+		os_mkdirs(path.substr(0, slash).c_str());
+
+	FILE *f = os_fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+	const bool success =
+		Read(entry, [f](const uint8_t *data, size_t size) { return size == 0 || fwrite(data, 1, size, f) == size; });
+	fclose(f);
+	if (!success)
+		os_unlink(path.c_str());
+	return success;
+}
+
+ZipWriter::~ZipWriter()
+{
+	/* not closed, the archive is incomplete */
+	if (file)
+		fclose(file);
+}
+
+bool ZipWriter::Open(const char *path)
+{
+	if (file)
+		fclose(file);
+	entries.clear();
+	failed = false;
+	file = os_fopen(path, "wb");
+	if (!file)
+		return false;
+
+	const time_t now = time(nullptr);
+	struct tm t {};
+#ifdef _WIN32
+	localtime_s(&t, &now);
+#else
+	localtime_r(&now, &t);
+#endif
+	dos_time = (uint16_t)((t.tm_hour << 11) | (t.tm_min << 5) | (t.tm_sec / 2));
+	dos_date = (uint16_t)(((t.tm_year > 80 ? t.tm_year - 80 : 0) << 9) | ((t.tm_mon + 1) << 5) | t.tm_mday);
+	return true;
+}
+
+bool ZipWriter::Close()
+{
+	if (!file)
+		return false;
+	if (!failed && !WriteCentralDirectory())
+		failed = true;
+	if (fclose(file) != 0)
+		failed = true;
+	file = nullptr;
+	return !failed;
+}
+
+bool ZipWriter::AddData(const std::string &name, const void *data, size_t size, bool compress)
+{
+	return Add(name, size, compress, [data, size](const std::function<bool(const uint8_t *, size_t)> &write) {
+		const uint8_t *p = (const uint8_t *)data;
+		for (size_t pos = 0; pos < size; pos += ZIP_CHUNK_SIZE) {
+			if (!write(p + pos, std::min<size_t>(ZIP_CHUNK_SIZE, size - pos)))
+				return false;
+		}
+		return true;
+	});
+}
+
+bool ZipWriter::AddFile(const std::string &name, const char *path, bool compress)
+{
+	const int64_t size = os_get_file_size(path);
+	if (size < 0)
+		return false;
+	FILE *in = os_fopen(path, "rb");
+	if (!in)
+		return false;
+	const bool success = Add(name, (uint64_t)size, compress, [in](const std::function<bool(const uint8_t *, size_t)> &write) {
+		std::vector<uint8_t> buffer(ZIP_CHUNK_SIZE);
+		size_t read;
+		while ((read = fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+			if (!write(buffer.data(), read))
+				return false;
+		}
+		return !ferror(in);
+	});
+	fclose(in);
+	return success;
+}
+
+bool ZipWriter::Add(const std::string &name, uint64_t size, bool compress,
+		    const std::function<bool(const std::function<bool(const uint8_t *data, size_t size)> &write)> &read)
+{
+	if (!file || failed || name.length() > 0xFFFF)
+		return false;
+
+	ArchiveEntry entry;
+	entry.name = name;
+	entry.method = compress ? ZIP_METHOD_DEFLATE : ZIP_METHOD_STORE;
+	entry.offset = (uint64_t)os_ftelli64(file);
+	/* deflate can grow incompressible data a little */
+	const bool zip64 = size >= 0xFFFF0000ULL;
+
+	std::vector<uint8_t> header;
+	put32(header, ZIP_LOCAL_HEADER_SIGNATURE);
+	put16(header, zip64 ? ZIP64_VERSION : ZIP_VERSION);
+	put16(header, ZIP_FLAG_UTF8);
+	put16(header, entry.method);
+	put16(header, dos_time);
+	put16(header, dos_date);
+	put32(header, 0);
+	put32(header, zip64 ? 0xFFFFFFFF : 0);
+	put32(header, zip64 ? 0xFFFFFFFF : 0);
+	put16(header, (uint16_t)name.length());
+	put16(header, zip64 ? 20 : 0);
+	header.insert(header.end(), name.begin(), name.end());
+	if (zip64) {
+		put16(header, ZIP64_EXTRA_ID);
+		put16(header, 16);
+		put64(header, 0);
+		put64(header, 0);
+	}
+	if (fwrite(header.data(), 1, header.size(), file) != header.size()) {
+		failed = true;
+		return false;
+	}
+
+	z_stream zs = {};
+	if (compress && deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		failed = true;
+		return false;
+	}
+	std::vector<uint8_t> out(compress ? ZIP_CHUNK_SIZE : 0);
+	uLong crc = crc32(0L, Z_NULL, 0);
+	auto deflate_out = [&](int flush) {
+		int zr;
+		do {
+			zs.next_out = out.data();
+			zs.avail_out = (uInt)out.size();
+			zr = deflate(&zs, flush);
+			if (zr == Z_STREAM_ERROR)
+				return false;
+			const size_t produced = out.size() - zs.avail_out;
+			if (produced && fwrite(out.data(), 1, produced, file) != produced)
+				return false;
+			entry.compressed_size += produced;
+		} while (zs.avail_out == 0 || (flush == Z_FINISH && zr != Z_STREAM_END));
+		return true;
+	};
+	bool success = read([&](const uint8_t *data, size_t length) {
+		crc = crc32(crc, data, (uInt)length);
+		entry.size += length;
+		if (!compress) {
+			entry.compressed_size += length;
+			return fwrite(data, 1, length, file) == length;
+		}
+		zs.next_in = (Bytef *)data;
+		zs.avail_in = (uInt)length;
+		return deflate_out(Z_NO_FLUSH);
+	});
+	if (compress) {
+		if (success)
+			success = deflate_out(Z_FINISH);
+		deflateEnd(&zs);
+	}
+	entry.crc = (uint32_t)crc;
+	if (success && !zip64 && (entry.size >= 0xFFFFFFFF || entry.compressed_size >= 0xFFFFFFFF)) {
+		blog(LOG_WARNING, "[Scene Collection Manager] '%s' grew while adding it to the archive", name.c_str());
+		success = false;
+	}
+
+	/* patch crc and sizes into the local header */
+	const int64_t end = os_ftelli64(file);
+	std::vector<uint8_t> patch;
+	put32(patch, entry.crc);
+	put32(patch, zip64 ? 0xFFFFFFFF : (uint32_t)entry.compressed_size);
+	put32(patch, zip64 ? 0xFFFFFFFF : (uint32_t)entry.size);
+	if (success && (os_fseeki64(file, (int64_t)entry.offset + 14, SEEK_SET) != 0 ||
+			fwrite(patch.data(), 1, patch.size(), file) != patch.size()))
+		success = false;
+	if (success && zip64) {
+		patch.clear();
+		put64(patch, entry.size);
+		put64(patch, entry.compressed_size);
+		if (os_fseeki64(file, (int64_t)(entry.offset + 30 + name.length() + 4), SEEK_SET) != 0 ||
+		    fwrite(patch.data(), 1, patch.size(), file) != patch.size())
+			success = false;
+	}
+	if (os_fseeki64(file, end, SEEK_SET) != 0)
+		success = false;
+
+	/* a partly written entry can not be taken back */
+	if (!success) {
+		failed = true;
+		return false;
+	}
+	entries.push_back(std::move(entry));
+	return true;
+}
+
+bool ZipWriter::WriteCentralDirectory()
+{
+	const uint64_t offset = (uint64_t)os_ftelli64(file);
+	std::vector<uint8_t> cd;
+	for (const auto &entry : entries) {
+		std::vector<uint8_t> extra;
+		if (entry.size >= 0xFFFFFFFF)
+			put64(extra, entry.size);
+		if (entry.compressed_size >= 0xFFFFFFFF)
+			put64(extra, entry.compressed_size);
+		if (entry.offset >= 0xFFFFFFFF)
+			put64(extra, entry.offset);
+		const bool zip64 = !extra.empty();
+
+		cd.clear();
+		put32(cd, ZIP_CENTRAL_HEADER_SIGNATURE);
+		put16(cd, ZIP64_VERSION);
+		put16(cd, zip64 ? ZIP64_VERSION : ZIP_VERSION);
+		put16(cd, ZIP_FLAG_UTF8);
+		put16(cd, entry.method);
+		put16(cd, dos_time);
+		put16(cd, dos_date);
+		put32(cd, entry.crc);
+		put32(cd, (uint32_t)std::min<uint64_t>(entry.compressed_size, 0xFFFFFFFF));
+		put32(cd, (uint32_t)std::min<uint64_t>(entry.size, 0xFFFFFFFF));
+		put16(cd, (uint16_t)entry.name.length());
+		put16(cd, zip64 ? (uint16_t)(extra.size() + 4) : 0);
+		put16(cd, 0);
+		put16(cd, 0);
+		put16(cd, 0);
+		put32(cd, 0);
+		put32(cd, (uint32_t)std::min<uint64_t>(entry.offset, 0xFFFFFFFF));
+		cd.insert(cd.end(), entry.name.begin(), entry.name.end());
+		if (zip64) {
+			put16(cd, ZIP64_EXTRA_ID);
+			put16(cd, (uint16_t)extra.size());
+			cd.insert(cd.end(), extra.begin(), extra.end());
+		}
+		if (fwrite(cd.data(), 1, cd.size(), file) != cd.size())
+			return false;
+	}
+	const uint64_t end = (uint64_t)os_ftelli64(file);
+	const uint64_t size = end - offset;
+	const uint64_t count = entries.size();
+
+	std::vector<uint8_t> eocd;
+	if (count >= 0xFFFF || size >= 0xFFFFFFFF || offset >= 0xFFFFFFFF) {
+		put32(eocd, ZIP64_END_SIGNATURE);
+		put64(eocd, 44);
+		put16(eocd, ZIP64_VERSION);
+		put16(eocd, ZIP64_VERSION);
+		put32(eocd, 0);
+		put32(eocd, 0);
+		put64(eocd, count);
+		put64(eocd, count);
+		put64(eocd, size);
+		put64(eocd, offset);
+		put32(eocd, ZIP64_LOCATOR_SIGNATURE);
+		put32(eocd, 0);
+		put64(eocd, end);
+		put32(eocd, 1);
+	}
+	put32(eocd, ZIP_END_SIGNATURE);
+	put16(eocd, 0);
+	put16(eocd, 0);
+	put16(eocd, (uint16_t)std::min<uint64_t>(count, 0xFFFF));
+	put16(eocd, (uint16_t)std::min<uint64_t>(count, 0xFFFF));
+	put32(eocd, (uint32_t)std::min<uint64_t>(size, 0xFFFFFFFF));
+	put32(eocd, (uint32_t)std::min<uint64_t>(offset, 0xFFFFFFFF));
+	put16(eocd, 0);
+	return fwrite(eocd.data(), 1, eocd.size(), file) == eocd.size();
+}
+
+bool IsArchiveFile(const std::string &path)
+{
+	const auto point = path.find_last_of('.');
+	if (point == std::string::npos)
+		return false;
+	auto ext = path.substr(point + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+	return ext == "zip";
+}
+
+bool GetSafeArchivePath(const std::string &name, std::string &safe)
+{
+	safe.clear();
+	if (name.empty() || name[0] == '/' || name[0] == '\\' || name.find(':') != std::string::npos)
+		return false;
+	size_t start = 0;
+	while (start <= name.length()) {
+		auto end = name.find_first_of("/\\", start);
+		if (end == std::string::npos)
+			end = name.length();
+		const auto part = name.substr(start, end - start);
+		if (part == "..")
+			return false;
+		if (!part.empty() && part != ".") {
+			if (!safe.empty())
+				safe += "/";
+			safe += part;
+		}
+		start = end + 1;
+	}
+	return !safe.empty();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ArchiveEntry {
+	std::string name;
+	uint64_t offset = 0;
+	uint64_t compressed_size = 0;
+	uint64_t size = 0;
+	uint32_t crc = 0;
+	uint16_t method = 0;
+	bool directory = false;
+};
+
+/* reads zip archives entry by entry, only one chunk of an entry is kept in memory at a time */
+class ZipReader {
+public:
+	ZipReader() = default;
+	~ZipReader();
+	ZipReader(const ZipReader &) = delete;
+	ZipReader &operator=(const ZipReader &) = delete;
+
+	bool Open(const char *path);
+	void Close();
+
+	/* entries sorted by their position in the archive */
+	const std::vector<ArchiveEntry> &Entries() const { return entries; }
+
+	bool Read(const ArchiveEntry &entry, const std::function<bool(const uint8_t *data, size_t size)> &write);
+	bool ReadToString(const ArchiveEntry &entry, std::string &out);
+	bool Extract(const ArchiveEntry &entry, const std::string &path);
+
+private:
+	bool ReadCentralDirectory(uint64_t offset, uint64_t count);
+
+	FILE *file = nullptr;
+	std::vector<ArchiveEntry> entries;
+};
+
+/* writes zip archives in one sequential pass, entry data is streamed and the sizes are patched into the local header
+ * afterwards, zip64 records are only written when needed */
+class ZipWriter {
+public:
+	ZipWriter() = default;
+	~ZipWriter();
+	ZipWriter(const ZipWriter &) = delete;
+	ZipWriter &operator=(const ZipWriter &) = delete;
+
+	bool Open(const char *path);
+	/* writes the central directory, returns false if anything failed since Open */
+	bool Close();
+
+	bool AddData(const std::string &name, const void *data, size_t size, bool compress);
+	bool AddFile(const std::string &name, const char *path, bool compress);
+
+private:
+	bool Add(const std::string &name, uint64_t size, bool compress,
+		 const std::function<bool(const std::function<bool(const uint8_t *data, size_t size)> &write)> &read);
+	bool WriteCentralDirectory();
+
+	FILE *file = nullptr;
+	bool failed = false;
+	uint16_t dos_time = 0;
+	uint16_t dos_date = 0;
+	std::vector<ArchiveEntry> entries;
+};
+
+bool IsArchiveFile(const std::string &path);
+
+/* returns false for absolute names and names that would escape the target directory */
+bool GetSafeArchivePath(const std::string &name, std::string &safe);
@@ -0,0 +1,340 @@
+#include "scene-collection-backup-model.hpp"
+
+#include <QDateTime>
+#include <QLocale>
+#include <QMainWindow>
+#include <QPointer>
+#include <QThreadPool>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "obs-frontend-api.h"
+#include "obs-module.h"
+
+/* rows read per job, so a screen of rows or a whole sort is spread over the thread pool */
+#define BACKUP_METADATA_BATCH 16
+
+BackupListModel::BackupListModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+void BackupListModel::SetBackups(std::shared_ptr<BackupStorage> backupStorage, const std::string &file)
+{
+	beginResetModel();
+	std::unordered_map<std::string, Row> known;
+	if (file == collectionFile && backupStorage == storage) {
+		for (auto &row : rows) {
+			if (!row.backup.path.empty() && (row.loaded || row.loading || row.named || row.naming))
+				known.emplace(row.backup.path, std::move(row));
+		}
+	} else {
+		generation++;
+		requested.clear();
+		requestedNames.clear();
+	}
+	storage = std::move(backupStorage);
+	collectionFile = file;
+	rows.clear();
+	if (storage) {
+		for (auto &backup : storage->List(collectionFile, false)) {
+			Row row;
+			const auto it = known.find(backup.path);
+			/* a storage that lists with metadata has the current time and size */
+			if (backup.modified == 0 && backup.size == 0 && it != known.end()) {
+				row = std::move(it->second);
+			} else {
+				row.backup = std::move(backup);
+				row.loaded = row.backup.modified != 0 || row.backup.size != 0;
+				row.named = row.loaded;
+			}
+			rows.push_back(std::move(row));
+		}
+	}
+	UpdateChanges();
+	endResetModel();
+	if (sortColumn >= 0)
+		sort(sortColumn, sortOrder);
+}
+
+void BackupListModel::Clear()
+{
+	beginResetModel();
+	rows.clear();
+	requested.clear();
+	requestedNames.clear();
+	storage.reset();
+	collectionFile.clear();
+	generation++;
+	sortPending = false;
+	endResetModel();
+}
+
+void BackupListModel::AddBackup(const std::string &name)
+{
+	if (FindRow(name) >= 0)
+		return;
+	beginInsertRows(QModelIndex(), (int)rows.size(), (int)rows.size());
+	Row row;
+	row.backup.name = name;
+	row.loaded = true;
+	row.named = true;
+	rows.push_back(std::move(row));
+	endInsertRows();
+}
+
+std::string BackupListModel::GetName(int row) const
+{
+	if (row < 0 || (size_t)row >= rows.size())
+		return "";
+	return rows[(size_t)row].backup.name;
+}
+
+BackupFile BackupListModel::GetBackup(int row) const
+{
+	if (row < 0 || (size_t)row >= rows.size())
+		return BackupFile();
+	return rows[(size_t)row].backup;
+}
+
+int BackupListModel::FindRow(const std::string &name) const
+{
+	for (size_t i = 0; i < rows.size(); i++) {
+		if (rows[i].backup.name == name)
+			return (int)i;
+	}
+	return -1;
+}
+
+int BackupListModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : (int)rows.size();
+}
+
+int BackupListModel::columnCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant BackupListModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid() || (size_t)index.row() >= rows.size())
+		return QVariant();
+	if (role == Qt::TextAlignmentRole)
+		return index.column() == Size || index.column() == Change ? QVariant(int(Qt::AlignRight | Qt::AlignVCenter))
+									  : QVariant();
+	if (role != Qt::DisplayRole)
+		return QVariant();
+
+	const auto &row = rows[(size_t)index.row()];
+	if (index.column() == Name ? !row.named : !row.loaded)
+		RequestMetadata((size_t)index.row(), index.column() == Name);
+	const QLocale locale;
+	switch (index.column()) {
+	case Name:
+		return QString::fromUtf8(row.backup.name.c_str());
+	case Modified:
+		if (!row.loaded || row.backup.modified == 0)
+			return QVariant();
+		return locale.toString(QDateTime::fromSecsSinceEpoch(row.backup.modified), QLocale::ShortFormat);
+	case Size:
+		if (!row.loaded || row.backup.modified == 0)
+			return QVariant();
+		return locale.formattedDataSize((qint64)row.backup.size);
+	case Change:
+		if (!row.hasChange)
+			return QVariant();
+		return QString::fromUtf8(row.change < 0 ? "-" : "+") +
+		       locale.formattedDataSize(row.change < 0 ? -row.change : row.change);
+	default:
+		return QVariant();
+	}
+}
+
+QVariant BackupListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant();
+	switch (section) {
+	case Name:
+		return QString::fromUtf8(obs_module_text("BackupColumnName"));
+	case Modified:
+		return QString::fromUtf8(obs_module_text("BackupColumnModified"));
+	case Size:
+		return QString::fromUtf8(obs_module_text("BackupColumnSize"));
+	case Change:
+		return QString::fromUtf8(obs_module_text("BackupColumnChange"));
+	default:
+		return QVariant();
+	}
+}
+
+void BackupListModel::sort(int column, Qt::SortOrder order)
+{
+	sortColumn = column;
+	sortOrder = order;
+	if (column != Name) {
+		/* sorted once everything is read, the rows keep their order until then */
+		bool missing = false;
+		for (size_t i = 0; i < rows.size(); i++) {
+			if (rows[i].loaded)
+				continue;
+			missing = true;
+			RequestMetadata(i, false);
+		}
+		sortPending = missing;
+		if (missing)
+			return;
+	}
+	sortPending = false;
+	ApplySort();
+}
+
+void BackupListModel::RequestMetadata(size_t row, bool name) const
+{
+	auto &r = rows[row];
+	if (name) {
+		/* reading the name also reads the time and size */
+		if (r.named || r.naming)
+			return;
+		r.naming = true;
+		requestedNames.push_back(r.backup);
+	} else {
+		if (r.loaded || r.loading || r.naming)
+			return;
+		r.loading = true;
+		requested.push_back(r.backup);
+	}
+	if (loadQueued)
+		return;
+	/* collects the requests of one paint or sort into one load */
+	loadQueued = true;
+	QMetaObject::invokeMethod(const_cast<BackupListModel *>(this), [this] { LoadRequested(); }, Qt::QueuedConnection);
+}
+
+void BackupListModel::LoadRequested() const
+{
+	loadQueued = false;
+	if (!storage) {
+		requested.clear();
+		requestedNames.clear();
+		return;
+	}
+	const auto backupStorage = storage;
+	const auto file = collectionFile;
+	const uint64_t forGeneration = generation;
+	QPointer<BackupListModel> model(const_cast<BackupListModel *>(this));
+	const auto main = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+	const auto load = [&](std::vector<BackupFile> &pending, bool names) {
+		for (size_t start = 0; start < pending.size(); start += BACKUP_METADATA_BATCH) {
+			const size_t end = std::min(pending.size(), start + BACKUP_METADATA_BATCH);
+			auto backups = std::make_shared<std::vector<BackupFile>>(pending.begin() + (ptrdiff_t)start,
+										 pending.begin() + (ptrdiff_t)end);
+			QThreadPool::globalInstance()->start([backupStorage, file, forGeneration, model, main, backups, names] {
+				for (auto &backup : *backups)
+					backupStorage->Stat(file, backup, names);
+				QMetaObject::invokeMethod(
+					main,
+					[model, forGeneration, backups, names] {
+						if (model)
+							model->MetadataLoaded(forGeneration, *backups, names);
+					},
+					Qt::QueuedConnection);
+			});
+		}
+		pending.clear();
+	};
+	load(requestedNames, true);
+	load(requested, false);
+}
+
+void BackupListModel::MetadataLoaded(uint64_t forGeneration, const std::vector<BackupFile> &backups, bool names)
+{
+	if (forGeneration != generation || rows.empty())
+		return;
+	std::unordered_map<std::string, size_t> byPath;
+	for (size_t i = 0; i < rows.size(); i++)
+		byPath[rows[i].backup.path] = i;
+	for (const auto &backup : backups) {
+		const auto it = byPath.find(backup.path);
+		if (it == byPath.end())
+			continue;
+		auto &row = rows[it->second];
+		/* also when it could not be read, so it is not asked for again */
+		row.backup.modified = backup.modified;
+		row.backup.size = backup.size;
+		row.loaded = true;
+		row.loading = false;
+		if (names) {
+			row.backup.name = backup.name;
+			row.named = true;
+			row.naming = false;
+		}
+	}
+	UpdateChanges();
+	emit dataChanged(index(0, 0), index((int)rows.size() - 1, ColumnCount - 1));
+	if (sortPending && std::all_of(rows.begin(), rows.end(), [](const Row &row) { return row.loaded; })) {
+		sortPending = false;
+		ApplySort();
+	}
+}
+
+void BackupListModel::UpdateChanges()
+{
+	/* the change is against the previous backup in time of those that are read */
+	std::vector<size_t> known;
+	for (size_t i = 0; i < rows.size(); i++) {
+		rows[i].hasChange = false;
+		if (rows[i].loaded && rows[i].backup.modified != 0)
+			known.push_back(i);
+	}
+	std::sort(known.begin(), known.end(), [this](size_t a, size_t b) {
+		const auto &backupA = rows[a].backup;
+		const auto &backupB = rows[b].backup;
+		return backupA.modified != backupB.modified ? backupA.modified < backupB.modified : backupA.name < backupB.name;
+	});
+	for (size_t i = 1; i < known.size(); i++) {
+		auto &row = rows[known[i]];
+		row.hasChange = true;
+		row.change = (int64_t)row.backup.size - (int64_t)rows[known[i - 1]].backup.size;
+	}
+}
+
+void BackupListModel::ApplySort()
+{
+	if (sortColumn < 0 || rows.size() < 2)
+		return;
+	emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+	const auto less = [this](const Row &a, const Row &b) {
+		switch (sortColumn) {
+		case Modified:
+			return a.backup.modified < b.backup.modified;
+		case Size:
+			return a.backup.size < b.backup.size;
+		case Change:
+			if (a.hasChange != b.hasChange)
+				return !a.hasChange;
+			return a.change < b.change;
+		default:
+			return a.backup.name < b.backup.name;
+		}
+	};
+	std::vector<size_t> order(rows.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return sortOrder == Qt::AscendingOrder ? less(rows[a], rows[b]) : less(rows[b], rows[a]);
+	});
+	std::vector<int> newRow(rows.size());
+	std::vector<Row> sorted;
+	sorted.reserve(rows.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		newRow[order[i]] = (int)i;
+		sorted.push_back(std::move(rows[order[i]]));
+	}
+	rows = std::move(sorted);
+
+	const auto from = persistentIndexList();
+	QModelIndexList to;
+	for (const auto &persistent : from)
+		to.append(persistent.isValid() ? index(newRow[(size_t)persistent.row()], persistent.column()) : persistent);
+	changePersistentIndexList(from, to);
+	emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <memory>
+#include <string>
+#include <vector>
+#include "scene-collection-storage.hpp"
+
+/* the backups of one scene collection for a table view. Listing only reads which backups exist, time and size are read
+ * in the background for the rows the view asks for and kept, so sorting and listing again do not read the backups again.
+ * The name needs the backup to be parsed, so it is only read for rows that show it. Sorting on time, size or change
+ * reads the time and size that are still missing once */
+class BackupListModel : public QAbstractTableModel {
+	Q_OBJECT
+public:
+	enum Column { Name, Modified, Size, Change, ColumnCount };
+
+	explicit BackupListModel(QObject *parent = nullptr);
+
+	void SetBackups(std::shared_ptr<BackupStorage> storage, const std::string &collectionFile);
+	void Clear();
+	/* shows a backup that is still being written, until the backups are listed again */
+	void AddBackup(const std::string &name);
+	const std::string &GetCollectionFile() const { return collectionFile; }
+	/* the name to pass to the storage */
+	std::string GetName(int row) const;
+	/* as listed, time and size are only set once the row is loaded */
+	BackupFile GetBackup(int row) const;
+	int FindRow(const std::string &name) const;
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+	struct Row {
+		BackupFile backup;
+		bool loaded = false;
+		bool loading = false;
+		bool named = false;
+		bool naming = false;
+		bool hasChange = false;
+		int64_t change = 0;
+	};
+
+	void RequestMetadata(size_t row, bool name) const;
+	void LoadRequested() const;
+	void MetadataLoaded(uint64_t forGeneration, const std::vector<BackupFile> &backups, bool names);
+	void UpdateChanges();
+	void ApplySort();
+
+	std::shared_ptr<BackupStorage> storage;
+	std::string collectionFile;
+	/* data() requests metadata, so the rows and the requests change in const */
+	mutable std::vector<Row> rows;
+	mutable std::vector<BackupFile> requested;
+	mutable std::vector<BackupFile> requestedNames;
+	mutable bool loadQueued = false;
+	uint64_t generation = 0;
+	int sortColumn = -1;
+	Qt::SortOrder sortOrder = Qt::AscendingOrder;
+	bool sortPending = false;
+};
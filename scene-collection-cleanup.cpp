@@ -0,0 +1,187 @@
+#include "scene-collection-cleanup.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <unordered_set>
+#include <sys/stat.h>
+
+#include "scene-collection-core.hpp"
+#include "scene-collection-lock.hpp"
+#include "scene-collection-trash.hpp"
+#include "util/base.h"
+#include "util/dstr.h"
+#include "util/platform.h"
+
+#define SCENE_COLLECTION_MANAGER_TEMP "scene_collection_manager_temp.json"
+
+static std::string WithSlash(std::string dir)
+{
+	if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+		dir += "/";
+	return dir;
+}
+
+static bool HasExtension(const std::string &name, const char *ext)
+{
+	const size_t l = strlen(ext);
+	return name.length() > l && astrcmpi(name.c_str() + name.length() - l, ext) == 0;
+}
+
+static bool GetFileInfo(const std::string &path, uint64_t &bytes, int64_t &modified)
+{
+	struct stat st {};
+	if (os_stat(path.c_str(), &st) != 0)
+		return false;
+	bytes = (uint64_t)st.st_size;
+	modified = (int64_t)st.st_mtime;
+	return true;
+}
+
+/* leftovers of obs_data_save_json_safe next to the files in dir */
+static void FindLeftoverFiles(const std::string &dir, int64_t now, std::vector<OrphanEntry> &orphans)
+{
+	os_dir_t *d = os_opendir(dir.c_str());
+	if (!d)
+		return;
+	std::unordered_set<std::string> names;
+	std::vector<std::string> candidates;
+	while (struct os_dirent *ent = os_readdir(d)) {
+		if (ent->directory)
+			continue;
+		names.insert(ent->d_name);
+		if (HasExtension(ent->d_name, ".tmp") || HasExtension(ent->d_name, ".bak"))
+			candidates.emplace_back(ent->d_name);
+	}
+	os_closedir(d);
+	for (const auto &name : candidates) {
+		/* a .bak is the last good copy of its file, only worth keeping while that file exists */
+		const auto base = name.substr(0, name.length() - 4);
+		OrphanEntry entry;
+		entry.path = dir + name;
+		if (!GetFileInfo(entry.path, entry.bytes, entry.modified))
+			continue;
+		if (HasExtension(name, ".bak") && names.count(base))
+			continue;
+		if (HasExtension(name, ".tmp") && entry.modified > now - CLEANUP_TMP_AGE)
+			continue;
+		orphans.push_back(entry);
+	}
+}
+
+/* only a directory that holds nothing but backups and their leftovers is treated as a backup directory, and only when
+ * this plugin made it: it has the marker, or an automatic backup for directories from before the marker */
+static bool GetBackupDirectoryInfo(const std::string &dir, uint64_t &bytes, int64_t &modified)
+{
+	os_dir_t *d = os_opendir(dir.c_str());
+	if (!d)
+		return false;
+	bool backups = true;
+	bool any = false;
+	bool ours = false;
+	while (struct os_dirent *ent = os_readdir(d)) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0 || strcmp(ent->d_name, BACKUP_LOCK_FILE) == 0)
+			continue;
+		if (strcmp(ent->d_name, BACKUP_DIR_MARKER) == 0) {
+			ours = true;
+			continue;
+		}
+		if (ent->directory ||
+		    !(HasExtension(ent->d_name, ".json") || HasExtension(ent->d_name, ".bak") || HasExtension(ent->d_name, ".tmp"))) {
+			backups = false;
+			break;
+		}
+		int day, hms;
+		char ext[6] = {};
+		if (sscanf(ent->d_name, "%d_%d.%5s", &day, &hms, ext) == 3 && strcmp(ext, "json") == 0)
+			ours = true;
+		uint64_t size;
+		int64_t time;
+		if (GetFileInfo(dir + ent->d_name, size, time)) {
+			bytes += size;
+			if (time > modified)
+				modified = time;
+		}
+		any = true;
+	}
+	os_closedir(d);
+	return backups && any && ours;
+}
+
+static void FindOrphanDirectories(const std::string &dir, const std::unordered_set<std::string> &collections, int64_t now,
+				  std::vector<OrphanEntry> &orphans)
+{
+	os_dir_t *d = os_opendir(dir.c_str());
+	if (!d)
+		return;
+	std::vector<std::string> subdirs;
+	while (struct os_dirent *ent = os_readdir(d)) {
+		/* skips . and .. along with the trash and backups moved to the trash next to where they were */
+		if (ent->directory && ent->d_name[0] != '.' && !strstr(ent->d_name, ".trash-"))
+			subdirs.emplace_back(ent->d_name);
+	}
+	os_closedir(d);
+	for (const auto &name : subdirs) {
+		const auto path = dir + name + "/";
+		if (collections.count(name)) {
+			FindLeftoverFiles(path, now, orphans);
+			continue;
+		}
+		OrphanEntry entry;
+		entry.path = path;
+		entry.directory = true;
+		if (GetBackupDirectoryInfo(path, entry.bytes, entry.modified))
+			orphans.push_back(entry);
+	}
+}
+
+std::vector<OrphanEntry> FindOrphans(const std::string &scenesDir, const std::string &customBackupDir,
+				     const std::string &currentFile)
+{
+	std::vector<OrphanEntry> orphans;
+	const auto scenes = WithSlash(scenesDir);
+	const int64_t now = (int64_t)time(nullptr);
+
+	/* backup directories are named after the collection file, not the collection */
+	std::unordered_set<std::string> collections;
+	os_dir_t *d = os_opendir(scenes.c_str());
+	if (!d)
+		return orphans;
+	while (struct os_dirent *ent = os_readdir(d)) {
+		if (!ent->directory && HasExtension(ent->d_name, ".json"))
+			collections.insert(GetFilenameFromPath(ent->d_name, false));
+	}
+	os_closedir(d);
+
+	OrphanEntry temp;
+	temp.path = scenes + SCENE_COLLECTION_MANAGER_TEMP;
+	if (temp.path != currentFile && GetFileInfo(temp.path, temp.bytes, temp.modified)) {
+		orphans.push_back(temp);
+		collections.erase(GetFilenameFromPath(SCENE_COLLECTION_MANAGER_TEMP, false));
+	}
+	FindLeftoverFiles(scenes, now, orphans);
+	FindOrphanDirectories(scenes, collections, now, orphans);
+	if (!customBackupDir.empty())
+		FindOrphanDirectories(WithSlash(customBackupDir), collections, now, orphans);
+	return orphans;
+}
+
+uint64_t RemoveOrphans(const std::vector<OrphanEntry> &orphans, int64_t before)
+{
+	uint64_t bytes = 0;
+	size_t removed = 0;
+	for (const auto &orphan : orphans) {
+		if (orphan.modified >= before)
+			continue;
+		const bool success = orphan.directory ? RemoveDirectoryRecursive(orphan.path) : os_unlink(orphan.path.c_str()) == 0;
+		if (!success) {
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to remove '%s'", orphan.path.c_str());
+			continue;
+		}
+		bytes += orphan.bytes;
+		removed++;
+	}
+	if (removed)
+		blog(LOG_INFO, "[Scene Collection Manager] removed %zu orphaned backups and leftover files (%llu bytes)", removed,
+		     (unsigned long long)bytes);
+	return bytes;
+}
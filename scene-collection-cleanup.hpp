@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* temporary files from an interrupted save are only left behind when they are older than this */
+#define CLEANUP_TMP_AGE (60 * 60)
+
+struct OrphanEntry {
+	std::string path;
+	bool directory = false;
+	uint64_t bytes = 0;
+	/* newest modification time of the file or of the files in the directory */
+	int64_t modified = 0;
+};
+
+/* backup directories in the scenes directory or customBackupDir without a scene collection file, and leftover files:
+ * the temporary collection used while switching unless it is currentFile, stale *.tmp files and *.bak files of
+ * collections or backups that no longer exist. A directory only counts when it was made by this plugin, is not empty
+ * and holds nothing but backups */
+std::vector<OrphanEntry> FindOrphans(const std::string &scenesDir, const std::string &customBackupDir,
+				     const std::string &currentFile);
+
+/* removes the entries that were last modified before the given time, returns the bytes reclaimed */
+uint64_t RemoveOrphans(const std::vector<OrphanEntry> &orphans, int64_t before);
@@ -0,0 +1,335 @@
+#include "scene-collection-convert.hpp"
+
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include "scene-collection-trace.hpp"
+
+enum class TextConversion { None, ToFreeType, ToGdiPlus };
+
+struct ConvertedSource {
+	obs_data_t *source = nullptr;
+	TextConversion text = TextConversion::None;
+	size_t report = (size_t)-1;
+};
+
+class SceneCollectionConverter {
+public:
+	SceneCollectionConverter(const SourceTypeMappings &mappings, SourceTarget target) : mappings(mappings), target(target) {}
+	~SceneCollectionConverter();
+
+	void Convert(obs_data_t *data);
+	std::vector<SourceConversion> report;
+
+private:
+	void AddSources(obs_data_t *data, const char *name);
+	void ConvertSource(ConvertedSource &converted);
+	void ConvertSceneItems(obs_data_t *scene);
+	void ToFreeType(obs_data_t *settings, SourceConversion &conversion);
+	void ToGdiPlus(obs_data_t *settings, SourceConversion &conversion);
+	void ToFreeTypeTransform(obs_data_t *item, obs_data_t *settings);
+	void ToGdiPlusTransform(obs_data_t *item, obs_data_t *settings);
+	SourceConversion &Report(ConvertedSource &converted, const char *from_id);
+
+	const SourceTypeMappings &mappings;
+	SourceTarget target;
+	/* has sources of another platform, so it was not made on the target */
+	bool foreign = false;
+	std::vector<ConvertedSource> sources;
+	std::unordered_map<std::string, size_t> names;
+};
+
+SceneCollectionConverter::~SceneCollectionConverter()
+{
+	for (auto &converted : sources)
+		obs_data_release(converted.source);
+}
+
+void SceneCollectionConverter::AddSources(obs_data_t *data, const char *name)
+{
+	obs_data_array_t *array = obs_data_get_array(data, name);
+	const size_t count = obs_data_array_count(array);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *s = obs_data_array_item(array, i);
+		if (!s)
+			continue;
+		names.emplace(obs_data_get_string(s, "name"), sources.size());
+		sources.push_back({s});
+	}
+	obs_data_array_release(array);
+}
+
+SourceConversion &SceneCollectionConverter::Report(ConvertedSource &converted, const char *from_id)
+{
+	if (converted.report == (size_t)-1) {
+		converted.report = report.size();
+		const char *id = obs_data_get_string(converted.source, "id");
+		report.push_back({obs_data_get_string(converted.source, "name"), from_id ? from_id : id, id, {}});
+	}
+	return report[converted.report];
+}
+
+void SceneCollectionConverter::ConvertSource(ConvertedSource &converted)
+{
+	obs_data_t *s = converted.source;
+	const std::string from_id = obs_data_get_string(s, "id");
+	if (mappings.Apply(s, target)) {
+		auto &conversion = Report(converted, from_id.c_str());
+		conversion.to_id = obs_data_get_string(s, "id");
+		const SourceTypeMapping *mapping = mappings.Find(target, from_id.c_str());
+		if (mapping && mapping->reset_settings)
+			conversion.changes.emplace_back("settings reset");
+		if (mapping) {
+			for (const auto &key : mapping->settings)
+				conversion.changes.push_back("setting '" + key.first + "' kept as '" + key.second + "'");
+		}
+	}
+
+	const char *id = obs_data_get_string(s, "id");
+	if (target != SourceTarget::Windows && strcmp(id, "text_gdiplus") == 0) {
+		obs_data_set_string(s, "id", "text_ft2_source");
+		obs_data_set_string(s, "versioned_id", "text_ft2_source_v2");
+		converted.text = TextConversion::ToFreeType;
+		auto &conversion = Report(converted, from_id.c_str());
+		conversion.to_id = "text_ft2_source";
+		if (obs_data_t *settings = obs_data_get_obj(s, "settings")) {
+			ToFreeType(settings, conversion);
+			obs_data_release(settings);
+		}
+	} else if (target == SourceTarget::Windows && foreign && strcmp(id, "text_ft2_source") == 0) {
+		/* FreeType text works on Windows too, the lossy conversion is only for collections from another platform */
+		obs_data_set_string(s, "id", "text_gdiplus");
+		const char *vid = obs_initialized() ? obs_get_latest_input_type_id("text_gdiplus") : nullptr;
+		obs_data_set_string(s, "versioned_id", vid ? vid : "text_gdiplus_v3");
+		converted.text = TextConversion::ToGdiPlus;
+		auto &conversion = Report(converted, from_id.c_str());
+		conversion.to_id = "text_gdiplus";
+		if (obs_data_t *settings = obs_data_get_obj(s, "settings")) {
+			ToGdiPlus(settings, conversion);
+			obs_data_release(settings);
+		}
+	}
+}
+
+static void RenameSetting(obs_data_t *settings, const char *from, const char *to, SourceConversion &conversion)
+{
+	if (CopyDataItem(settings, from, settings, to)) {
+		obs_data_erase(settings, from);
+		conversion.changes.push_back(std::string("setting '") + from + "' renamed to '" + to + "'");
+	}
+}
+
+void SceneCollectionConverter::ToFreeType(obs_data_t *settings, SourceConversion &conversion)
+{
+	obs_data_set_default_int(settings, "color", 0xFFFFFF);
+	long long color = obs_data_get_int(settings, "color");
+	color = color & 0xFFFFFF;
+	obs_data_set_default_int(settings, "opacity", 100);
+	long long opacity = obs_data_get_int(settings, "opacity");
+	color |= ((opacity * 255 / 100) & 0xFF) << 24;
+	obs_data_set_int(settings, "color1", color);
+	obs_data_set_int(settings, "color2", color);
+	conversion.changes.emplace_back("color and opacity converted");
+	obs_data_set_default_bool(settings, "extents_wrap", true);
+	if (obs_data_get_bool(settings, "extents_wrap")) {
+		obs_data_set_default_int(settings, "extents_cx", 100);
+		obs_data_set_int(settings, "custom_width", obs_data_get_int(settings, "extents_cx"));
+		obs_data_set_bool(settings, "word_wrap", true);
+		conversion.changes.emplace_back("wrap width converted");
+	}
+	RenameSetting(settings, "read_from_file", "from_file", conversion);
+	RenameSetting(settings, "file", "text_file", conversion);
+}
+
+void SceneCollectionConverter::ToGdiPlus(obs_data_t *settings, SourceConversion &conversion)
+{
+	obs_data_set_default_int(settings, "color1", 0xFFFFFFFF);
+	obs_data_set_default_int(settings, "color2", 0xFFFFFFFF);
+	const long long color1 = obs_data_get_int(settings, "color1");
+	const long long color2 = obs_data_get_int(settings, "color2");
+	obs_data_set_int(settings, "color", color1 & 0xFFFFFF);
+	obs_data_set_int(settings, "opacity", ((color1 >> 24) & 0xFF) * 100 / 255);
+	if (color1 != color2) {
+		obs_data_set_bool(settings, "gradient", true);
+		obs_data_set_int(settings, "gradient_color", color2 & 0xFFFFFF);
+		obs_data_set_int(settings, "gradient_opacity", ((color2 >> 24) & 0xFF) * 100 / 255);
+	}
+	conversion.changes.emplace_back("color and opacity converted");
+	if (obs_data_get_bool(settings, "word_wrap")) {
+		obs_data_set_bool(settings, "extents", true);
+		obs_data_set_bool(settings, "extents_wrap", true);
+		obs_data_set_int(settings, "extents_cx", obs_data_get_int(settings, "custom_width"));
+		conversion.changes.emplace_back("wrap width converted");
+	}
+	RenameSetting(settings, "from_file", "read_from_file", conversion);
+	RenameSetting(settings, "text_file", "file", conversion);
+}
+
+void SceneCollectionConverter::ToFreeTypeTransform(obs_data_t *item, obs_data_t *settings)
+{
+	struct vec2 scale;
+	obs_data_get_vec2(item, "scale", &scale);
+	scale.x *= 9.0f / 11.0f;
+	scale.y *= 9.0f / 11.0f;
+	if (obs_data_get_bool(settings, "extents_wrap")) {
+		obs_data_set_int(item, "bounds_type", OBS_BOUNDS_MAX_ONLY);
+		struct vec2 bounds;
+		bounds.x = (float)obs_data_get_double(settings, "extents_cx");
+		bounds.y = (float)obs_data_get_double(settings, "extents_cy");
+		if (bounds.y < 2.0) {
+			auto font = obs_data_get_obj(settings, "font");
+			auto font_size = obs_data_get_double(font, "size");
+			obs_data_release(font);
+			bounds.y = (float)font_size;
+		}
+		obs_data_set_vec2(item, "bounds", &bounds);
+	} else {
+		obs_data_set_vec2(item, "scale", &scale);
+	}
+	const char *align_str = obs_data_get_string(settings, "align");
+	const char *valign_str = obs_data_get_string(settings, "valign");
+	int bounds_align = 0;
+	if (strcmp(align_str, "center") == 0) {
+		bounds_align += OBS_ALIGN_CENTER;
+		obs_data_set_int(settings, "custom_width", 0);
+	} else if (strcmp(align_str, "right") == 0) {
+		bounds_align += OBS_ALIGN_RIGHT;
+	} else {
+		bounds_align += OBS_ALIGN_LEFT;
+	}
+
+	if (strcmp(valign_str, "center") == 0)
+		bounds_align += OBS_ALIGN_CENTER;
+	else if (strcmp(valign_str, "bottom") == 0)
+		bounds_align += OBS_ALIGN_BOTTOM;
+	else
+		bounds_align += OBS_ALIGN_TOP;
+	obs_data_set_int(item, "bounds_align", bounds_align);
+}
+
+void SceneCollectionConverter::ToGdiPlusTransform(obs_data_t *item, obs_data_t *settings)
+{
+	if (obs_data_get_int(item, "bounds_type") == OBS_BOUNDS_MAX_ONLY) {
+		struct vec2 bounds;
+		obs_data_get_vec2(item, "bounds", &bounds);
+		obs_data_set_bool(settings, "extents", true);
+		obs_data_set_int(settings, "extents_cx", (long long)bounds.x);
+		obs_data_set_int(settings, "extents_cy", (long long)bounds.y);
+	} else {
+		struct vec2 scale;
+		obs_data_get_vec2(item, "scale", &scale);
+		scale.x *= 11.0f / 9.0f;
+		scale.y *= 11.0f / 9.0f;
+		obs_data_set_vec2(item, "scale", &scale);
+	}
+	const long long bounds_align = obs_data_get_int(item, "bounds_align");
+	if (bounds_align & OBS_ALIGN_RIGHT)
+		obs_data_set_string(settings, "align", "right");
+	else if (bounds_align & OBS_ALIGN_LEFT)
+		obs_data_set_string(settings, "align", "left");
+	else
+		obs_data_set_string(settings, "align", "center");
+	if (bounds_align & OBS_ALIGN_BOTTOM)
+		obs_data_set_string(settings, "valign", "bottom");
+	else if (bounds_align & OBS_ALIGN_TOP)
+		obs_data_set_string(settings, "valign", "top");
+	else
+		obs_data_set_string(settings, "valign", "center");
+}
+
+void SceneCollectionConverter::ConvertSceneItems(obs_data_t *scene)
+{
+	obs_data_t *scene_settings = obs_data_get_obj(scene, "settings");
+	obs_data_array_t *items = obs_data_get_array(scene_settings, "items");
+	obs_data_release(scene_settings);
+	const size_t count = obs_data_array_count(items);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(items, i);
+		if (!item)
+			continue;
+		const auto it = names.find(obs_data_get_string(item, "name"));
+		if (it != names.end() && sources[it->second].text != TextConversion::None) {
+			auto &converted = sources[it->second];
+			obs_data_t *settings = obs_data_get_obj(converted.source, "settings");
+			if (!settings) {
+				settings = obs_data_create();
+				obs_data_set_obj(converted.source, "settings", settings);
+			}
+			if (converted.text == TextConversion::ToFreeType)
+				ToFreeTypeTransform(item, settings);
+			else
+				ToGdiPlusTransform(item, settings);
+			obs_data_release(settings);
+			Report(converted, nullptr)
+				.changes.push_back(std::string("transform in '") + obs_data_get_string(scene, "name") + "' converted");
+		}
+		obs_data_release(item);
+	}
+	obs_data_array_release(items);
+}
+
+void SceneCollectionConverter::Convert(obs_data_t *data)
+{
+	AddSources(data, "sources");
+	AddSources(data, "groups");
+	const char *globalAudio[] = {"DesktopAudioDevice1", "DesktopAudioDevice2", "AuxAudioDevice1",
+				     "AuxAudioDevice2",     "AuxAudioDevice3",     "AuxAudioDevice4"};
+	for (auto ga : globalAudio) {
+		if (obs_data_t *s = obs_data_get_obj(data, ga))
+			sources.push_back({s});
+	}
+
+	for (const auto &converted : sources) {
+		if (mappings.Find(target, obs_data_get_string(converted.source, "id"))) {
+			foreign = true;
+			break;
+		}
+	}
+	for (auto &converted : sources)
+		ConvertSource(converted);
+
+	for (auto &converted : sources) {
+		const char *id = obs_data_get_string(converted.source, "id");
+		if (strcmp(id, "scene") == 0 || strcmp(id, "group") == 0)
+			ConvertSceneItems(converted.source);
+	}
+}
+
+std::vector<SourceConversion> ConvertSceneCollection(obs_data_t *data, const SourceTypeMappings &mappings, SourceTarget target,
+						     bool dry_run)
+{
+	TraceSpan span("convert_sources");
+	obs_data_t *copy = nullptr;
+	if (dry_run) {
+		copy = obs_data_create_from_json(obs_data_get_json(data));
+		if (!copy)
+			return {};
+		data = copy;
+	}
+	SceneCollectionConverter converter(mappings, target);
+	converter.Convert(data);
+	std::vector<SourceConversion> report = std::move(converter.report);
+	obs_data_release(copy);
+	return report;
+}
+
+std::string FormatConversionReport(const std::vector<SourceConversion> &report)
+{
+	std::string text;
+	for (const auto &conversion : report) {
+		text += conversion.name;
+		text += ": ";
+		text += conversion.from_id;
+		if (conversion.to_id != conversion.from_id) {
+			text += " -> ";
+			text += conversion.to_id;
+		}
+		text += "\n";
+		for (const auto &change : conversion.changes) {
+			text += "\t";
+			text += change;
+			text += "\n";
+		}
+	}
+	return text;
+}
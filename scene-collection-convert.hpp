@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "obs.h"
+#include "source-type-mappings.hpp"
+
+struct SourceConversion {
+	std::string name;
+	std::string from_id;
+	std::string to_id;
+	std::vector<std::string> changes;
+};
+
+/* converts the OS specific sources of a scene collection for the target platform,
+ * with dry_run the data is left untouched and only the report is returned */
+std::vector<SourceConversion> ConvertSceneCollection(obs_data_t *data, const SourceTypeMappings &mappings, SourceTarget target,
+						     bool dry_run = false);
+
+std::string FormatConversionReport(const std::vector<SourceConversion> &report);
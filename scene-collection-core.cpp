@@ -0,0 +1,680 @@
+#include "scene-collection-core.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <wctype.h>
+#include <sys/stat.h>
+
+#include "scene-collection-archive.hpp"
+#include "scene-collection-convert.hpp"
+#include "scene-collection-json-stream.hpp"
+#include "scene-collection-lock.hpp"
+#include "scene-collection-throttle.hpp"
+#include "scene-collection-trace.hpp"
+#include "util/dstr.h"
+#include "util/platform.h"
+
+bool GetFileSafeName(const char *name, std::string &file)
+{
+	const size_t base_len = strlen(name);
+	size_t len = os_utf8_to_wcs(name, base_len, nullptr, 0);
+	std::wstring wfile;
+
+	if (!len)
+		return false;
+
+	wfile.resize(len);
+	os_utf8_to_wcs(name, base_len, &wfile[0], len + 1);
+
+	for (size_t i = wfile.size(); i > 0; i--) {
+		size_t im1 = i - 1;
+
+		if (iswspace(wfile[im1])) {
+			wfile[im1] = '_';
+		} else if (wfile[im1] != '_' && !iswalnum(wfile[im1])) {
+			wfile.erase(im1, 1);
+		}
+	}
+
+	if (wfile.size() == 0)
+		wfile = L"characters_only";
+
+	len = os_wcs_to_utf8(wfile.c_str(), wfile.size(), nullptr, 0);
+	if (!len)
+		return false;
+
+	file.resize(len);
+	os_wcs_to_utf8(wfile.c_str(), wfile.size(), &file[0], len + 1);
+	return true;
+}
+
+std::string GetFilenameFromPath(std::string path, bool with_extension)
+{
+	const auto slash = path.find_last_of("/\\");
+	if (slash != std::string::npos) {
+		path = path.substr(slash + 1);
+	}
+	if (!with_extension) {
+		const auto point = path.find_last_of('.');
+		if (point != std::string::npos) {
+			path = path.substr(0, point);
+		}
+	}
+	return path;
+}
+
+static bool replace(std::string &str, const char *from, const char *to)
+{
+	size_t start_pos = str.find(from);
+	if (start_pos == std::string::npos)
+		return false;
+	str.replace(start_pos, strlen(from), to);
+	return true;
+}
+
+void import_parts(obs_data_t *data, const char *dir)
+{
+	TraceSpan span("import_parts");
+	obs_data_array_t *a = obs_data_get_array(data, "imports");
+	if (!a)
+		return;
+	size_t count = obs_data_array_count(a);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(a, i);
+		if (!item)
+			continue;
+		const char *file = obs_data_get_string(item, "file");
+		obs_data_t *file_data = nullptr;
+		if (!file || !strlen(file)) {
+			obs_data_release(item);
+			continue;
+		}
+		if (os_file_exists(file)) {
+			file_data = obs_data_create_from_json_file(file);
+		}
+		if (!file_data) {
+			std::string newFile = dir;
+			newFile += file;
+			if (os_file_exists(newFile.c_str())) {
+				file_data = obs_data_create_from_json_file(newFile.c_str());
+			}
+		}
+		if (!file_data) {
+			obs_data_release(item);
+			continue;
+		}
+		obs_data_item_t *item2 = obs_data_first(file_data);
+		while (item2) {
+			if (obs_data_item_gettype(item2) != OBS_DATA_ARRAY) {
+				obs_data_item_next(&item2);
+				continue;
+			}
+			obs_data_array_t *fa = obs_data_item_get_array(item2);
+			obs_data_array_t *da = obs_data_get_array(data, obs_data_item_get_name(item2));
+			if (!da) {
+				da = obs_data_array_create();
+				obs_data_set_array(data, obs_data_item_get_name(item2), da);
+			}
+			size_t c = obs_data_array_count(fa);
+			for (size_t j = 0; j < c; j++) {
+				obs_data_t *fi = obs_data_array_item(fa, j);
+				if (!fi)
+					continue;
+				const char *name = obs_data_get_string(fi, "name");
+				if (!name || !strlen(name)) {
+					obs_data_release(fi);
+					continue;
+				}
+				bool found = false;
+				size_t c2 = obs_data_array_count(da);
+				for (size_t k = 0; k < c2; k++) {
+					obs_data_t *di = obs_data_array_item(da, k);
+					if (!di)
+						continue;
+					if (strcmp(obs_data_get_string(di, "name"), name) == 0) {
+						obs_data_array_erase(da, k);
+						obs_data_array_insert(da, k, fi);
+						found = true;
+						break;
+					}
+
+					obs_data_release(di);
+				}
+				if (!found) {
+					obs_data_array_push_back(da, fi);
+				}
+				obs_data_release(fi);
+			}
+			obs_data_item_next(&item2);
+		}
+		obs_data_release(file_data);
+		obs_data_release(item);
+	}
+}
+
+/* caches one directory listing per directory so resolving a moved file
+ * does not need a stat for every candidate suffix */
+class DirectoryListingCache {
+public:
+	bool contains(const std::string &dir, const std::string &name)
+	{
+		auto it = listings.find(dir);
+		if (it == listings.end())
+			it = listings.emplace(dir, read(dir)).first;
+		return it->second.count(normalize(name)) > 0;
+	}
+
+private:
+	static std::string normalize(std::string name)
+	{
+#if defined(_WIN32) || defined(__APPLE__)
+		for (auto &c : name)
+			if (c >= 'A' && c <= 'Z')
+				c = c - 'A' + 'a';
+#endif
+		return name;
+	}
+
+	static std::unordered_set<std::string> read(std::string dir)
+	{
+		std::unordered_set<std::string> names;
+		while (dir.length() > 1 && (dir.back() == '/' || dir.back() == '\\'))
+			dir.resize(dir.length() - 1);
+		os_dir_t *d = os_opendir(dir.c_str());
+		if (!d)
+			return names;
+		while (struct os_dirent *ent = os_readdir(d))
+			names.insert(normalize(ent->d_name));
+		os_closedir(d);
+		return names;
+	}
+
+	std::unordered_map<std::string, std::unordered_set<std::string>> listings;
+};
+
+struct PathRewrite {
+	obs_data_t *data;
+	std::string name;
+	std::string value;
+};
+
+static bool is_absolute_path(const std::string &str)
+{
+	if (str.empty())
+		return false;
+	if (str[0] == '/' || str[0] == '\\')
+		return true;
+	return str.length() > 2 && str[1] == ':' && (str[2] == '/' || str[2] == '\\');
+}
+
+bool GetReferencedPath(std::string str, std::string &path)
+{
+	if (str.substr(0, 7) == "file://")
+		str = str.substr(7);
+	if (str.length() >= MAX_PATH || str.find_last_of("/\\") == std::string::npos || !is_absolute_path(str))
+		return false;
+	path = str;
+	return true;
+}
+
+static bool find_moved_file(const std::string &str, const char *dir, DirectoryListingCache &cache, std::string &newFile)
+{
+	std::size_t found = str.find_last_of("/\\");
+	while (found != std::string::npos) {
+		auto file = found == 0 && str[0] != '/' && str[0] != '\\' ? str : str.substr(found + 1);
+		if (file.find('.') == std::string::npos)
+			break;
+		std::string listDir = dir;
+		std::string name = file;
+		const auto sub = file.find_last_of("/\\");
+		if (sub != std::string::npos) {
+			listDir += file.substr(0, sub + 1);
+			name = file.substr(sub + 1);
+		}
+		for (auto &c : listDir)
+			if (c == '\\')
+				c = '/';
+		if (!name.empty() && cache.contains(listDir, name)) {
+			newFile = dir;
+			newFile += file;
+			return true;
+		}
+		if (found == 0) {
+			found = std::string::npos;
+		} else {
+			found = str.find_last_of("/\\", found - 1);
+			if (found == std::string::npos) {
+				found = 0;
+			}
+		}
+	}
+	return false;
+}
+
+/* returns true with the new value when str needs to be changed */
+static bool fix_path(std::string str, const char *dir, DirectoryListingCache &cache, PathFixStats &stats, std::string &value)
+{
+	char path_buffer[MAX_PATH];
+	bool edit = replace(str, "[U_COMBOBULATOR_PATH]", dir);
+	value = str;
+	bool local_url = false;
+	if (str.substr(0, 7) == "file://") {
+		str = str.substr(7);
+		local_url = true;
+	}
+	std::string newFile;
+	if (str.length() < MAX_PATH && str.find_last_of("/\\") != std::string::npos && !os_file_exists(str.c_str())) {
+		if (find_moved_file(str, dir, cache, newFile)) {
+			value = local_url ? "file://" : "";
+			if (os_get_abs_path(newFile.c_str(), path_buffer, MAX_PATH)) {
+				for (auto i = 0; path_buffer[i] != '\0'; i++)
+					if (path_buffer[i] == '\\')
+						path_buffer[i] = '/';
+				value += path_buffer;
+			}
+			edit = true;
+			stats.fixed++;
+		} else if (is_absolute_path(str)) {
+			stats.missing++;
+		}
+	}
+	return edit;
+}
+
+static void collect_path_fixes(obs_data_t *data, const char *dir, DirectoryListingCache &cache, std::vector<PathRewrite> &rewrites,
+			       PathFixStats &stats)
+{
+	obs_data_item_t *item = obs_data_first(data);
+	for (; item; obs_data_item_next(&item)) {
+		const enum obs_data_type type = obs_data_item_gettype(item);
+		if (type == OBS_DATA_STRING) {
+			std::string value;
+			if (fix_path(obs_data_item_get_string(item), dir, cache, stats, value)) {
+				obs_data_addref(data);
+				rewrites.push_back({data, obs_data_item_get_name(item), value});
+			}
+		} else if (type == OBS_DATA_OBJECT) {
+			if (obs_data_t *obj = obs_data_item_get_obj(item)) {
+				collect_path_fixes(obj, dir, cache, rewrites, stats);
+				obs_data_release(obj);
+			}
+		} else if (type == OBS_DATA_ARRAY) {
+			const auto array = obs_data_item_get_array(item);
+			const auto count = obs_data_array_count(array);
+			for (size_t i = 0; i < count; i++) {
+				if (obs_data_t *obj = obs_data_array_item(array, i)) {
+					collect_path_fixes(obj, dir, cache, rewrites, stats);
+					obs_data_release(obj);
+				}
+			}
+			obs_data_array_release(array);
+		}
+	}
+}
+
+PathFixStats try_fix_paths(obs_data_t *data, const char *dir)
+{
+	TraceSpan span("try_fix_paths");
+	PathFixStats stats;
+	DirectoryListingCache cache;
+	std::vector<PathRewrite> rewrites;
+	collect_path_fixes(data, dir, cache, rewrites, stats);
+	for (auto &rewrite : rewrites) {
+		obs_data_set_string(rewrite.data, rewrite.name.c_str(), rewrite.value.c_str());
+		obs_data_release(rewrite.data);
+	}
+	blog(LOG_INFO, "[Scene Collection Manager] fixed %zu paths, %zu missing, using '%s'", stats.fixed, stats.missing, dir);
+	return stats;
+}
+
+PathFixStats try_fix_paths_file(const std::string &file, const std::string &out, const char *dir, bool &success)
+{
+	PathFixStats stats;
+	DirectoryListingCache cache;
+	auto fix = [&](const std::vector<JsonStreamFrame> &, const std::string &, size_t, std::string &value) {
+		std::string fixed;
+		if (!fix_path(value, dir, cache, stats, fixed))
+			return false;
+		value = fixed;
+		return true;
+	};
+	/* written next to out first so out can be the file itself */
+	const auto tmp = out + ".tmp";
+	success = TransformJsonFile(file, tmp, fix);
+	if (success && os_rename(tmp.c_str(), out.c_str()) != 0) {
+		os_unlink(tmp.c_str());
+		success = false;
+	}
+	blog(LOG_INFO, "[Scene Collection Manager] fixed %zu paths, %zu missing, using '%s'", stats.fixed, stats.missing, dir);
+	return stats;
+}
+
+std::string GetBackupDirectory(std::string filename, const std::string &customBackupDir)
+{
+	if (customBackupDir.empty()) {
+		auto l = filename.length();
+		if (l > 5 && filename.compare(l - 5, 5, ".json") == 0) {
+			filename.resize(l - 5);
+			filename.append("/");
+		}
+		return filename;
+	}
+	filename = GetFilenameFromPath(filename, false);
+	std::string dir = customBackupDir;
+
+	if (dir.back() != '/' && dir.back() != '\\')
+		dir += "/";
+	dir += filename;
+	dir += "/";
+	return dir;
+}
+
+std::string GenerateBackupName()
+{
+	char *fn = os_generate_formatted_filename("", true, "%CCYY-%MM-%DD %hh:%mm:%ss");
+	std::string backupName = fn;
+	bfree(fn);
+	if (!backupName.empty() && backupName.back() == '.')
+		backupName.resize(backupName.length() - 1);
+	return backupName;
+}
+
+static void PrepareImport(obs_data_t *data, const std::string &file, const SourceTypeMappings &mappings, SourceTarget target)
+{
+	std::string dir = file;
+	std::size_t slash = dir.find_last_of("/\\");
+	if (slash != std::string::npos) {
+		auto point = dir.find_last_of('.');
+		if (point != std::string::npos && point > slash) {
+			dir = dir.substr(0, point);
+			dir += "/";
+			try_fix_paths(data, dir.c_str());
+		}
+		dir = dir.substr(0, slash + 1);
+	}
+	import_parts(data, dir.c_str());
+	try_fix_paths(data, dir.c_str());
+	ConvertSceneCollection(data, mappings, target);
+}
+
+/* a new directory under mediaDir named after the archive, so nothing that is already there is written over */
+static bool CreateArchiveMediaDirectory(const std::string &file, const std::string &mediaDir, std::string &dir)
+{
+	if (mediaDir.empty() || os_mkdirs(mediaDir.c_str()) == MKDIR_ERROR)
+		return false;
+	std::string base = mediaDir;
+	if (base.back() != '/' && base.back() != '\\')
+		base += "/";
+	base += GetFilenameFromPath(file, false);
+	for (int i = 1; i < 1000; i++) {
+		dir = i == 1 ? base : base + " " + std::to_string(i);
+		const int result = os_mkdir(dir.c_str());
+		if (result == MKDIR_SUCCESS) {
+			dir += "/";
+			return true;
+		}
+		if (result == MKDIR_ERROR)
+			return false;
+	}
+	return false;
+}
+
+/* only reads up to the name of the collection instead of parsing the whole file */
+static bool HasCollectionName(const std::string &file)
+{
+	bool found = false;
+	TransformJsonFile(
+		file, "",
+		[&found](const std::vector<JsonStreamFrame> &frames, const std::string &key, size_t, std::string &value) {
+			if (frames.size() == 1 && key == "name" && !value.empty())
+				found = true;
+			return false;
+		},
+		[&found] { return found; });
+	return found;
+}
+
+static void LoadArchiveImport(const std::string &file, const std::string &mediaDir,
+			      std::vector<std::pair<std::string, obs_data_t *>> &collections)
+{
+	ZipReader zip;
+	if (!zip.Open(file.c_str())) {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to open archive '%s'", file.c_str());
+		return;
+	}
+	/* media is extracted in the directory layout try_fix_paths expects */
+	std::string target;
+	if (!CreateArchiveMediaDirectory(file, mediaDir, target)) {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to create a directory for the media of '%s' in '%s'",
+		     file.c_str(), mediaDir.c_str());
+		return;
+	}
+	for (const auto &entry : zip.Entries()) {
+		std::string name;
+		if (entry.directory || !GetSafeArchivePath(entry.name, name))
+			continue;
+		const auto path = target + name;
+		/* an archive can hold the same name twice */
+		if (os_file_exists(path.c_str()) || !zip.Extract(entry, path)) {
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to extract '%s' from '%s'", entry.name.c_str(),
+			     file.c_str());
+			continue;
+		}
+		if (name.find('/') != std::string::npos || name.length() <= 5 ||
+		    astrcmpi(name.c_str() + name.length() - 5, ".json") != 0 || !HasCollectionName(path))
+			continue;
+		obs_data_t *data;
+		{
+			TraceSpan span("parse");
+			data = obs_data_create_from_json_file(path.c_str());
+		}
+		/* otherwise a part used by "imports", which stays next to the media */
+		if (data && obs_data_has_user_value(data, "sources")) {
+			os_unlink(path.c_str());
+			collections.emplace_back(path, data);
+			continue;
+		}
+		obs_data_release(data);
+	}
+}
+
+std::vector<obs_data_t *> LoadImportFile(const std::string &file, const SourceTypeMappings &mappings, SourceTarget target,
+					 const std::string &mediaDir)
+{
+	std::vector<std::pair<std::string, obs_data_t *>> collections;
+	if (IsArchiveFile(file)) {
+		TraceSpan span("extract");
+		LoadArchiveImport(file, mediaDir, collections);
+	} else {
+		TraceSpan span("parse");
+		if (obs_data_t *data = obs_data_create_from_json_file(file.c_str()))
+			collections.emplace_back(file, data);
+	}
+	std::vector<obs_data_t *> result;
+	for (auto &collection : collections) {
+		PrepareImport(collection.second, collection.first, mappings, target);
+		result.push_back(collection.second);
+	}
+	return result;
+}
+
+static std::string GetNameOrFilename(obs_data_t *data, const char *filePath)
+{
+	std::string name = obs_data_get_string(data, "name");
+
+	/* if no name found, use the file name as the name
+	 * (this only happens when switching to the new version) */
+	if (name.empty())
+		name = GetFilenameFromPath(filePath, false);
+	return name;
+}
+
+std::map<std::string, std::string> EnumerateSceneCollections(const std::string &dir)
+{
+	std::map<std::string, std::string> collections;
+	std::string path = dir;
+	if (!path.empty() && path.back() != '/' && path.back() != '\\')
+		path += "/";
+	path += "*.json";
+	os_glob_t *glob;
+	int globbed;
+	{
+		TraceSpan span("glob");
+		globbed = os_glob(path.c_str(), 0, &glob);
+	}
+	if (globbed != 0) {
+		blog(LOG_WARNING, "Failed to glob scene collections in:%s", path.c_str());
+		return collections;
+	}
+	for (size_t i = 0; i < glob->gl_pathc; i++) {
+		const char *filePath = glob->gl_pathv[i].path;
+		if (glob->gl_pathv[i].directory)
+			continue;
+		obs_data_t *data;
+		{
+			TraceSpan span("parse");
+			data = obs_data_create_from_json_file_safe(filePath, "bak");
+		}
+		if (!data)
+			continue;
+		collections[GetNameOrFilename(data, filePath)] = filePath;
+		obs_data_release(data);
+	}
+	os_globfree(glob);
+	return collections;
+}
+
+bool ReadBackupMetadata(BackupFile &backup, bool name)
+{
+	struct stat stats {};
+	if (os_stat(backup.path.c_str(), &stats) != 0)
+		return false;
+	backup.modified = (int64_t)stats.st_ctime;
+	backup.size = (uint64_t)stats.st_size;
+	if (!name)
+		return true;
+	TraceSpan span("parse");
+	auto *data = obs_data_create_from_json_file_safe(backup.path.c_str(), "bak");
+	backup.name = GetNameOrFilename(data, backup.path.c_str());
+	obs_data_release(data);
+	return true;
+}
+
+std::vector<BackupFile> ListBackups(const std::string &backupDir, bool metadata)
+{
+	std::vector<BackupFile> backups;
+	const auto f = backupDir + "*.json";
+	os_glob_t *glob;
+	int globbed;
+	{
+		TraceSpan span("glob");
+		globbed = os_glob(f.c_str(), 0, &glob);
+	}
+	if (globbed != 0)
+		return backups;
+	for (size_t i = 0; i < glob->gl_pathc; i++) {
+		const char *filePath = glob->gl_pathv[i].path;
+		if (glob->gl_pathv[i].directory)
+			continue;
+		BackupFile backup{GetFilenameFromPath(filePath, false), filePath};
+		if (metadata)
+			ReadBackupMetadata(backup);
+		backups.push_back(backup);
+	}
+	os_globfree(glob);
+	return backups;
+}
+
+bool SaveBackup(const std::string &filename, const std::string &backupDir, const std::string &name, IoThrottle *throttle)
+{
+	auto *data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+	if (!data)
+		return false;
+	const bool success = SaveBackup(data, backupDir, name, throttle);
+	obs_data_release(data);
+	return success;
+}
+
+bool SaveBackup(obs_data_t *data, const std::string &backupDir, const std::string &name, IoThrottle *throttle)
+{
+	std::string safeName;
+	if (!data || !GetFileSafeName(name.c_str(), safeName))
+		return false;
+	TraceSpan span("save");
+	os_mkdirs(backupDir.c_str());
+	const auto marker = backupDir + BACKUP_DIR_MARKER;
+	if (!os_file_exists(marker.c_str()))
+		os_quick_write_utf8_file(marker.c_str(), "", 0, false);
+	obs_data_set_string(data, "name", name.c_str());
+	const auto backupFile = backupDir + safeName + ".json";
+	const char *json = obs_data_get_json(data);
+	return json && *json && WriteFileThrottled(backupFile, json, strlen(json), throttle);
+}
+
+size_t PruneBackups(const std::string &backupDir, int max)
+{
+	if (max <= 0 || !os_file_exists(backupDir.c_str()))
+		return 0;
+	TraceSpan span("retention");
+	/* another instance sharing the directory prunes it next time */
+	BackupDirLock lock(backupDir);
+	if (!lock.Locked())
+		return 0;
+	const auto f = backupDir + "*.json";
+	os_glob_t *glob;
+	if (os_glob(f.c_str(), 0, &glob) != 0)
+		return 0;
+	std::vector<std::pair<time_t, std::string>> candidates;
+	size_t file_count = 0;
+	for (size_t i = 0; i < glob->gl_pathc; i++) {
+		const char *filePath = glob->gl_pathv[i].path;
+		if (glob->gl_pathv[i].directory)
+			continue;
+		int d, t;
+		if (sscanf(GetFilenameFromPath(filePath, true).c_str(), "%d_%d.json", &d, &t) != 2)
+			continue;
+		file_count++;
+		struct stat stats {};
+		if (os_stat(filePath, &stats) == 0 && stats.st_size > 0)
+			candidates.emplace_back(stats.st_ctime, filePath);
+	}
+	os_globfree(glob);
+
+	std::sort(candidates.begin(), candidates.end());
+	size_t removed = 0;
+	for (const auto &candidate : candidates) {
+		if (file_count <= (size_t)max)
+			break;
+		if (os_unlink(candidate.second.c_str()) != 0)
+			break;
+		file_count--;
+		removed++;
+	}
+	return removed;
+}
+
+void RunParallel(size_t count, size_t jobs, const std::function<void(size_t)> &job)
+{
+	if (!jobs)
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	jobs = std::min(jobs, count);
+	if (jobs <= 1) {
+		for (size_t i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+	std::atomic<size_t> next{0};
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < jobs; t++) {
+		threads.emplace_back([&] {
+			for (size_t i = next++; i < count; i = next++)
+				job(i);
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+}
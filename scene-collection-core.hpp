@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "obs.h"
+#include "source-type-mappings.hpp"
+
+class IoThrottle;
+
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+/* written into every backup directory, only directories with it are ever cleaned up as orphaned backups */
+#define BACKUP_DIR_MARKER ".scene-collection-manager-backups"
+/* in the scenes directory, the media of imported archives is extracted into a directory of its own in here */
+#define IMPORTED_MEDIA_DIR "imported-media/"
+
+struct PathFixStats {
+	size_t fixed = 0;
+	size_t missing = 0;
+};
+
+struct BackupFile {
+	std::string name;
+	/* local path or the key in the backup storage */
+	std::string path;
+	int64_t modified = 0;
+	uint64_t size = 0;
+};
+
+bool GetFileSafeName(const char *name, std::string &file);
+std::string GetFilenameFromPath(std::string path, bool with_extension);
+std::string GetBackupDirectory(std::string filename, const std::string &customBackupDir);
+std::string GenerateBackupName();
+
+void import_parts(obs_data_t *data, const char *dir);
+PathFixStats try_fix_paths(obs_data_t *data, const char *dir);
+/* the absolute local path a string in a scene collection points at, these are the paths try_fix_paths reports missing */
+bool GetReferencedPath(std::string str, std::string &path);
+/* try_fix_paths on a scene collection file without loading it, the json is streamed from file to out which may be file */
+PathFixStats try_fix_paths_file(const std::string &file, const std::string &out, const char *dir, bool &success);
+
+/* loads a .json or .zip scene collection for import, fixing paths, merging imports and converting sources,
+ * the media of a .zip is extracted into a new directory in mediaDir, the returned data needs to be released */
+std::vector<obs_data_t *> LoadImportFile(const std::string &file, const SourceTypeMappings &mappings, SourceTarget target,
+					 const std::string &mediaDir);
+
+/* scene collection name to file, for all collections in the directory */
+std::map<std::string, std::string> EnumerateSceneCollections(const std::string &dir);
+/* the backups in backupDir, without metadata only the file is listed and the name is the file name */
+std::vector<BackupFile> ListBackups(const std::string &backupDir, bool metadata = true);
+/* reads the time and size of a backup listed without metadata, and with name its name from the backup itself */
+bool ReadBackupMetadata(BackupFile &backup, bool name = true);
+/* writes the scene collection as backup name into backupDir, paced by throttle when given, the backup only appears
+ * once it is completely written */
+bool SaveBackup(const std::string &filename, const std::string &backupDir, const std::string &name, IoThrottle *throttle = nullptr);
+/* same for an already loaded scene collection, which gets the backup name set */
+bool SaveBackup(obs_data_t *data, const std::string &backupDir, const std::string &name, IoThrottle *throttle = nullptr);
+/* removes the oldest automatic backups until at most max are left, skipped when another instance holds the lock on
+ * backupDir */
+size_t PruneBackups(const std::string &backupDir, int max);
+
+/* runs job for every index on at most jobs threads, 0 uses the number of cores */
+void RunParallel(size_t count, size_t jobs, const std::function<void(size_t)> &job);
@@ -0,0 +1,324 @@
+#include "scene-collection-diff.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#define DIFF_MAX_VALUE 80
+
+static uint64_t Mix(uint64_t x)
+{
+	/* splitmix64 finalizer, spreads the bits so sums of hashes do not cancel out */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t HashString(const char *str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (; str && *str; str++) {
+		hash ^= (unsigned char)*str;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static std::string Render(obs_data_item_t *item)
+{
+	std::string value;
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		value = "\"";
+		value += obs_data_item_get_string(item);
+		value += "\"";
+		break;
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_DOUBLE)
+			value = std::to_string(obs_data_item_get_double(item));
+		else
+			value = std::to_string(obs_data_item_get_int(item));
+		break;
+	case OBS_DATA_BOOLEAN:
+		value = obs_data_item_get_bool(item) ? "true" : "false";
+		break;
+	case OBS_DATA_OBJECT:
+		value = "{...}";
+		break;
+	case OBS_DATA_ARRAY: {
+		obs_data_array_t *array = obs_data_item_get_array(item);
+		value = "[" + std::to_string(obs_data_array_count(array)) + "]";
+		obs_data_array_release(array);
+		break;
+	}
+	default:
+		value = "null";
+	}
+	if (value.length() > DIFF_MAX_VALUE)
+		value = value.substr(0, DIFF_MAX_VALUE - 3) + "...";
+	return value;
+}
+
+class SceneCollectionDiffer {
+public:
+	void DiffObject(obs_data_t *from, obs_data_t *to, const std::string &path);
+
+	SceneCollectionDiff diff;
+
+private:
+	/* by the address of the object or array, both collections stay loaded while comparing */
+	std::unordered_map<const void *, uint64_t> hashes;
+
+	uint64_t Hash(obs_data_t *data);
+	uint64_t Hash(obs_data_array_t *array);
+	uint64_t Hash(obs_data_item_t *item);
+	void DiffArray(obs_data_array_t *from, obs_data_array_t *to, const std::string &path);
+	void DiffItem(obs_data_item_t *from, obs_data_item_t *to, const std::string &path);
+};
+
+uint64_t SceneCollectionDiffer::Hash(obs_data_t *data)
+{
+	const auto it = hashes.find(data);
+	if (it != hashes.end())
+		return it->second;
+	/* members are summed so the order of the keys in the file does not matter */
+	uint64_t hash = OBS_DATA_OBJECT;
+	obs_data_item_t *item = obs_data_first(data);
+	for (; item; obs_data_item_next(&item))
+		hash += Mix(HashString(obs_data_item_get_name(item)) ^ Hash(item));
+	hashes[data] = hash;
+	return hash;
+}
+
+uint64_t SceneCollectionDiffer::Hash(obs_data_array_t *array)
+{
+	const auto it = hashes.find(array);
+	if (it != hashes.end())
+		return it->second;
+	uint64_t hash = OBS_DATA_ARRAY;
+	const size_t count = obs_data_array_count(array);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_array_item(array, i);
+		hash = Mix(hash + Hash(obj));
+		obs_data_release(obj);
+	}
+	hashes[array] = hash;
+	return hash;
+}
+
+uint64_t SceneCollectionDiffer::Hash(obs_data_item_t *item)
+{
+	const auto type = obs_data_item_gettype(item);
+	uint64_t hash = 0;
+	switch (type) {
+	case OBS_DATA_STRING:
+		hash = HashString(obs_data_item_get_string(item));
+		break;
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_DOUBLE) {
+			const double value = obs_data_item_get_double(item);
+			memcpy(&hash, &value, sizeof(hash));
+			hash = Mix(hash) + 1;
+		} else {
+			hash = Mix((uint64_t)obs_data_item_get_int(item));
+		}
+		break;
+	case OBS_DATA_BOOLEAN:
+		hash = obs_data_item_get_bool(item) ? 1 : 0;
+		break;
+	case OBS_DATA_OBJECT:
+		if (obs_data_t *obj = obs_data_item_get_obj(item)) {
+			hash = Hash(obj);
+			obs_data_release(obj);
+		}
+		break;
+	case OBS_DATA_ARRAY:
+		if (obs_data_array_t *array = obs_data_item_get_array(item)) {
+			hash = Hash(array);
+			obs_data_array_release(array);
+		}
+		break;
+	default:
+		break;
+	}
+	return Mix(hash ^ ((uint64_t)type << 56));
+}
+
+void SceneCollectionDiffer::DiffObject(obs_data_t *from, obs_data_t *to, const std::string &path)
+{
+	if (Hash(from) == Hash(to)) {
+		diff.skipped++;
+		return;
+	}
+	const std::string prefix = path.empty() ? "" : path + "/";
+	obs_data_item_t *item = obs_data_first(from);
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		obs_data_item_t *other = obs_data_item_byname(to, name);
+		if (other) {
+			DiffItem(item, other, prefix + name);
+			obs_data_item_release(&other);
+		} else {
+			diff.changes.push_back({DiffType::Removed, prefix + name, Render(item), ""});
+		}
+	}
+	item = obs_data_first(to);
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		obs_data_item_t *other = obs_data_item_byname(from, name);
+		if (other)
+			obs_data_item_release(&other);
+		else
+			diff.changes.push_back({DiffType::Added, prefix + name, "", Render(item)});
+	}
+}
+
+void SceneCollectionDiffer::DiffItem(obs_data_item_t *from, obs_data_item_t *to, const std::string &path)
+{
+	const auto type = obs_data_item_gettype(from);
+	if (type != obs_data_item_gettype(to)) {
+		diff.changes.push_back({DiffType::Changed, path, Render(from), Render(to)});
+	} else if (type == OBS_DATA_OBJECT) {
+		obs_data_t *a = obs_data_item_get_obj(from);
+		obs_data_t *b = obs_data_item_get_obj(to);
+		if (a && b)
+			DiffObject(a, b, path);
+		obs_data_release(a);
+		obs_data_release(b);
+	} else if (type == OBS_DATA_ARRAY) {
+		obs_data_array_t *a = obs_data_item_get_array(from);
+		obs_data_array_t *b = obs_data_item_get_array(to);
+		if (a && b)
+			DiffArray(a, b, path);
+		obs_data_array_release(a);
+		obs_data_array_release(b);
+	} else if (Hash(from) != Hash(to)) {
+		diff.changes.push_back({DiffType::Changed, path, Render(from), Render(to)});
+	}
+}
+
+struct DiffElement {
+	obs_data_t *data;
+	std::string key;
+	std::string label;
+};
+
+/* elements are keyed by uuid when they all have one, else by name, repeated keys get their occurrence appended */
+static std::vector<DiffElement> GetElements(obs_data_array_t *array, const char *field)
+{
+	std::vector<DiffElement> elements;
+	std::unordered_map<std::string, size_t> seen;
+	const size_t count = obs_data_array_count(array);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_array_item(array, i);
+		DiffElement element{obj, field ? obs_data_get_string(obj, field) : std::to_string(i), ""};
+		const char *name = obs_data_get_string(obj, "name");
+		element.label = name && *name ? name : "#" + std::to_string(i);
+		const size_t n = ++seen[element.key];
+		if (n > 1) {
+			element.key += "#" + std::to_string(n);
+			element.label += " #" + std::to_string(n);
+		}
+		elements.push_back(std::move(element));
+	}
+	return elements;
+}
+
+static bool AllHave(obs_data_array_t *array, const char *field)
+{
+	const size_t count = obs_data_array_count(array);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_array_item(array, i);
+		const char *value = obs_data_get_string(obj, field);
+		const bool has = value && *value;
+		obs_data_release(obj);
+		if (!has)
+			return false;
+	}
+	return true;
+}
+
+void SceneCollectionDiffer::DiffArray(obs_data_array_t *from, obs_data_array_t *to, const std::string &path)
+{
+	if (Hash(from) == Hash(to)) {
+		diff.skipped++;
+		return;
+	}
+	const char *field = nullptr;
+	if (AllHave(from, "uuid") && AllHave(to, "uuid"))
+		field = "uuid";
+	else if (AllHave(from, "name") && AllHave(to, "name"))
+		field = "name";
+	auto a = GetElements(from, field);
+	auto b = GetElements(to, field);
+
+	std::unordered_map<std::string, size_t> index;
+	for (size_t i = 0; i < b.size(); i++)
+		index[b[i].key] = i;
+	std::vector<bool> matched(b.size(), false);
+	std::vector<size_t> order;
+	for (const auto &element : a) {
+		const auto it = index.find(element.key);
+		if (it == index.end()) {
+			diff.changes.push_back({DiffType::Removed, path + "/" + element.label, "{...}", ""});
+			continue;
+		}
+		matched[it->second] = true;
+		order.push_back(it->second);
+		DiffObject(element.data, b[it->second].data, path + "/" + b[it->second].label);
+	}
+	for (size_t i = 0; i < b.size(); i++) {
+		if (!matched[i])
+			diff.changes.push_back({DiffType::Added, path + "/" + b[i].label, "", "{...}"});
+	}
+	/* the position matters for scene items and filters, so a different order of the same elements is a change,
+	 * except for the sources themselves */
+	const bool ordered = path != "sources" && path != "groups";
+	for (size_t i = 1; ordered && field && i < order.size(); i++) {
+		if (order[i] < order[i - 1]) {
+			diff.changes.push_back({DiffType::Changed, path, "order", "reordered"});
+			break;
+		}
+	}
+	for (auto &element : a)
+		obs_data_release(element.data);
+	for (auto &element : b)
+		obs_data_release(element.data);
+}
+
+SceneCollectionDiff DiffSceneCollections(obs_data_t *from, obs_data_t *to)
+{
+	SceneCollectionDiffer differ;
+	if (!from || !to)
+		return differ.diff;
+	differ.diff.loaded = true;
+	differ.DiffObject(from, to, "");
+	/* a backup stores its own name in place of the name of the collection */
+	auto &changes = differ.diff.changes;
+	changes.erase(std::remove_if(changes.begin(), changes.end(), [](const DiffChange &change) { return change.path == "name"; }),
+		      changes.end());
+	return differ.diff;
+}
+
+std::string FormatSceneCollectionDiff(const SceneCollectionDiff &diff)
+{
+	std::string text;
+	for (const auto &change : diff.changes) {
+		switch (change.type) {
+		case DiffType::Added:
+			text += "+ " + change.path + ": " + change.to;
+			break;
+		case DiffType::Removed:
+			text += "- " + change.path + ": " + change.from;
+			break;
+		case DiffType::Changed:
+			text += "~ " + change.path + ": " + change.from + " -> " + change.to;
+			break;
+		}
+		text += "\n";
+	}
+	return text;
+}
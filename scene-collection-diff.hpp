@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "obs.h"
+
+enum class DiffType { Added, Removed, Changed };
+
+struct DiffChange {
+	DiffType type;
+	/* names joined with '/', sources, scene items and filters are named instead of numbered */
+	std::string path;
+	std::string from;
+	std::string to;
+};
+
+struct SceneCollectionDiff {
+	std::vector<DiffChange> changes;
+	/* objects and arrays that were equal and not compared any further */
+	size_t skipped = 0;
+	/* false when either collection could not be read, there are no changes then */
+	bool loaded = false;
+};
+
+/* compares two scene collections, array elements are matched by uuid or name instead of their position and
+ * subtrees with the same hash are skipped without walking them, the name of the collection itself is not compared */
+SceneCollectionDiff DiffSceneCollections(obs_data_t *from, obs_data_t *to);
+
+std::string FormatSceneCollectionDiff(const SceneCollectionDiff &diff);
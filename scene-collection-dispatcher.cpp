@@ -0,0 +1,68 @@
+#include "scene-collection-dispatcher.hpp"
+
+#include <QMainWindow>
+
+#include "obs-frontend-api.h"
+#include "util/platform.h"
+
+void OperationDispatcher::Dispatch(const std::string &name, Operation operation)
+{
+	DispatchAsync(name, [operation = std::move(operation)](std::function<void()> finished) {
+		operation();
+		finished();
+	});
+}
+
+void OperationDispatcher::DispatchAsync(const std::string &name, AsyncOperation operation)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		/* only a repeat of the last request collapses, anything asked for in between keeps its order */
+		if (!queue.empty() && queue.back().name == name) {
+			queue.back().collapsed++;
+			return;
+		}
+		queue.push_back({name, std::move(operation), os_gettime_ns(), 0});
+		if (running)
+			return;
+		running = true;
+	}
+	PostRunNext();
+}
+
+void OperationDispatcher::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	queue.clear();
+}
+
+void OperationDispatcher::RunNext()
+{
+	Queued next;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.empty()) {
+			running = false;
+			return;
+		}
+		next = std::move(queue.front());
+		queue.pop_front();
+	}
+	const uint64_t start = os_gettime_ns();
+	const std::string name = next.name;
+	const uint64_t queued = next.queued;
+	const size_t collapsed = next.collapsed;
+	next.operation([this, name, queued, collapsed, start] {
+		const uint64_t end = os_gettime_ns();
+		blog(LOG_INFO, "[Scene Collection Manager] %s waited %.1f ms and took %.1f ms, %zu repeats collapsed", name.c_str(),
+		     (double)(start - queued) / 1000000.0, (double)(end - start) / 1000000.0, collapsed);
+		PostRunNext();
+	});
+}
+
+/* the next operation gets its own turn of the event loop so the UI stays responsive between operations */
+void OperationDispatcher::PostRunNext()
+{
+	const auto main = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+	QMetaObject::invokeMethod(main, [this] { RunNext(); }, Qt::QueuedConnection);
+}
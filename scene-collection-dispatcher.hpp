@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+/* runs backup, restore and switch operations one after the other on the UI thread, in the order they were asked for
+ * from any thread. An operation asked for again right after itself before it started, like a held or mashed hotkey,
+ * runs only once */
+class OperationDispatcher {
+public:
+	using Operation = std::function<void()>;
+	/* starts on the UI thread and calls finished once, from any thread, the next operation waits for that */
+	using AsyncOperation = std::function<void(std::function<void()> finished)>;
+
+	/* name identifies the operation for collapsing and in the log */
+	void Dispatch(const std::string &name, Operation operation);
+	/* for operations that wait on the network or a disk without blocking the UI thread */
+	void DispatchAsync(const std::string &name, AsyncOperation operation);
+	/* drops what has not started yet */
+	void Clear();
+
+private:
+	struct Queued {
+		std::string name;
+		AsyncOperation operation;
+		uint64_t queued = 0;
+		size_t collapsed = 0;
+	};
+
+	void RunNext();
+	void PostRunNext();
+
+	std::mutex mutex;
+	std::deque<Queued> queue;
+	/* a RunNext is posted to the UI thread or an operation is running */
+	bool running = false;
+};
@@ -0,0 +1,757 @@
+#include "scene-collection-export.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#elif defined(__APPLE__)
+#include <unistd.h>
+#include <sys/clonefile.h>
+#endif
+
+#include "scene-collection-archive.hpp"
+#include "scene-collection-core.hpp"
+#include "scene-collection-json-stream.hpp"
+#include "util/dstr.h"
+#include "util/platform.h"
+
+#define EXPORT_HASH_BUFFER_SIZE (1024 * 1024)
+#define EXPORT_MANIFEST ".scene-collection-manager-manifest.json"
+
+struct ExportReference {
+	/* nullptr when the collection is streamed, the reference is then found again by its ordinal */
+	obs_data_t *data;
+	std::string name;
+	size_t ordinal;
+	bool local_url;
+	size_t file;
+	/* the string as it was in a streamed collection */
+	std::string original;
+};
+
+struct ExportFile {
+	std::string source;
+	std::string target;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	uint64_t hash = 0;
+	bool hashed = false;
+	size_t copy_of = (size_t)-1;
+	bool copied = false;
+	bool unchanged = false;
+};
+
+struct ManifestEntry {
+	std::string source;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	std::string hash;
+};
+
+static std::string GetRealPath(const std::string &path)
+{
+#ifdef _WIN32
+	char *abs = os_get_abs_path_ptr(path.c_str());
+#else
+	char *abs = realpath(path.c_str(), nullptr);
+#endif
+	if (!abs)
+		return path;
+	std::string real = abs;
+#ifdef _WIN32
+	bfree(abs);
+	std::replace(real.begin(), real.end(), '\\', '/');
+#else
+	free(abs);
+#endif
+	return real;
+}
+
+/* FNV-1a over the whole file, only used to find files with the same size and content */
+static bool HashFile(const std::string &path, uint64_t &hash)
+{
+	FILE *f = os_fopen(path.c_str(), "rb");
+	if (!f)
+		return false;
+	std::vector<uint8_t> buffer(EXPORT_HASH_BUFFER_SIZE);
+	hash = 14695981039346656037ULL;
+	size_t read;
+	while ((read = fread(buffer.data(), 1, buffer.size(), f)) > 0) {
+		for (size_t i = 0; i < read; i++) {
+			hash ^= buffer[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	const bool success = !ferror(f);
+	fclose(f);
+	return success;
+}
+
+/* the hash only finds candidates, files are the same when every byte is */
+static bool SameContent(const std::string &a, const std::string &b)
+{
+	FILE *fa = os_fopen(a.c_str(), "rb");
+	FILE *fb = fa ? os_fopen(b.c_str(), "rb") : nullptr;
+	bool same = fa && fb;
+	std::vector<uint8_t> bufferA(same ? EXPORT_HASH_BUFFER_SIZE : 0);
+	std::vector<uint8_t> bufferB(bufferA.size());
+	while (same) {
+		const size_t readA = fread(bufferA.data(), 1, bufferA.size(), fa);
+		const size_t readB = fread(bufferB.data(), 1, bufferB.size(), fb);
+		if (readA != readB || memcmp(bufferA.data(), bufferB.data(), readA) != 0 || ferror(fa) || ferror(fb))
+			same = false;
+		else if (readA == 0)
+			break;
+	}
+	if (fa)
+		fclose(fa);
+	if (fb)
+		fclose(fb);
+	return same;
+}
+
+static std::string HashToString(uint64_t hash)
+{
+	char str[17];
+	snprintf(str, sizeof(str), "%016llx", (unsigned long long)hash);
+	return str;
+}
+
+static std::string AddSubdir(const std::string &subdir, const char *name)
+{
+	std::string safe;
+	if (name && GetFileSafeName(name, safe))
+		return subdir + safe + "/";
+	return subdir;
+}
+
+class LocalFileExporter {
+public:
+	LocalFileExporter(std::string dir) : dir(std::move(dir)) {}
+	~LocalFileExporter()
+	{
+		for (auto &reference : references)
+			obs_data_release(reference.data);
+	}
+
+	void Collect(obs_data_t *data, const std::string &subdir);
+	bool CollectFile(const std::string &file, const std::string &subdir);
+	void FindDuplicates(size_t jobs);
+	void AssignPoolTargets(size_t jobs);
+	void AssignTargets(bool create_dirs);
+	void SkipUnchanged(const ExportOptions &options);
+	void Copy(size_t jobs);
+	void Write(ZipWriter &zip);
+	void Rewrite();
+	bool RewriteFile(const std::string &file, const std::string &out);
+	void SaveManifest(bool prune);
+
+	ExportStats stats;
+
+private:
+	std::string dir;
+	std::vector<ExportReference> references;
+	std::vector<ExportFile> files;
+	std::unordered_map<std::string, size_t> real_paths;
+	std::unordered_map<std::string, ManifestEntry> manifest;
+	/* original and new values of streamed references by ordinal */
+	std::unordered_map<size_t, std::pair<std::string, std::string>> rewrites;
+	bool content_addressed = false;
+
+	void Hash(const std::vector<size_t> &indices, size_t jobs);
+	bool AddReference(std::string str, const std::string &subdir, obs_data_t *data, const char *name, size_t ordinal);
+};
+
+/* subdir is the folder for this reference including the folder for its key */
+bool LocalFileExporter::AddReference(std::string str, const std::string &subdir, obs_data_t *data, const char *name,
+				     size_t ordinal)
+{
+	const std::string original = data ? "" : str;
+	bool local_url = false;
+	if (str.substr(0, 7) == "file://") {
+		str = str.substr(7);
+		local_url = true;
+	}
+	std::replace(str.begin(), str.end(), '\\', '/');
+	if (str.find('/') == std::string::npos ||
+	    (!dir.empty() && str.length() >= dir.length() && str.compare(0, dir.length(), dir) == 0) || !os_file_exists(str.c_str()))
+		return false;
+	struct stat st {};
+	if (os_stat(str.c_str(), &st) != 0 || (st.st_mode & S_IFMT) == S_IFDIR)
+		return false;
+	const auto real = GetRealPath(str);
+	auto it = real_paths.find(real);
+	if (it == real_paths.end()) {
+		ExportFile file;
+		file.source = str;
+		file.size = (uint64_t)st.st_size;
+		file.mtime = (int64_t)st.st_mtime;
+		file.target = subdir + GetFilenameFromPath(str, true);
+		it = real_paths.emplace(real, files.size()).first;
+		files.push_back(std::move(file));
+	}
+	if (data)
+		obs_data_addref(data);
+	references.push_back({data, name ? name : "", ordinal, local_url, it->second, original});
+	return true;
+}
+
+void LocalFileExporter::Collect(obs_data_t *data, const std::string &subdir)
+{
+	obs_data_item_t *item = obs_data_first(data);
+	for (; item; obs_data_item_next(&item)) {
+		const enum obs_data_type type = obs_data_item_gettype(item);
+		if (type == OBS_DATA_STRING) {
+			const char *name = obs_data_item_get_name(item);
+			AddReference(obs_data_item_get_string(item), AddSubdir(subdir, name), data, name, 0);
+		} else if (type == OBS_DATA_OBJECT) {
+			if (obs_data_t *obj = obs_data_item_get_obj(item)) {
+				Collect(obj, AddSubdir(subdir, obs_data_item_get_name(item)));
+				obs_data_release(obj);
+			}
+		} else if (type == OBS_DATA_ARRAY) {
+			const auto array = obs_data_item_get_array(item);
+			const auto count = obs_data_array_count(array);
+			const auto arrayDir = AddSubdir(subdir, obs_data_item_get_name(item));
+			for (size_t i = 0; i < count; i++) {
+				if (obs_data_t *obj = obs_data_array_item(array, i)) {
+					Collect(obj, AddSubdir(arrayDir, obs_data_get_string(obj, "name")));
+					obs_data_release(obj);
+				}
+			}
+			obs_data_array_release(array);
+		}
+	}
+}
+
+bool LocalFileExporter::CollectFile(const std::string &file, const std::string &subdir)
+{
+	/* the folder of a reference depends on the names of the objects in arrays it is in, which can come after it in the
+	 * file, so those names are read first and the references are added in a second pass */
+	std::unordered_map<uint64_t, std::string> names;
+	auto collectNames = [&](const std::vector<JsonStreamFrame> &frames, const std::string &key, size_t, std::string &value) {
+		if (key == "name" && frames.size() > 1 && frames[frames.size() - 2].array)
+			names[frames.back().id] = value;
+		return false;
+	};
+	if (!TransformJsonFile(file, "", collectNames))
+		return false;
+	auto collect = [&](const std::vector<JsonStreamFrame> &frames, const std::string &key, size_t ordinal, std::string &value) {
+		if (value.find_first_of("/\\") == std::string::npos)
+			return false;
+		std::string path = subdir;
+		for (size_t i = 1; i < frames.size(); i++) {
+			const auto &frame = frames[i];
+			if (!frames[i - 1].array) {
+				path = AddSubdir(path, frame.key.c_str());
+			} else if (frame.array) {
+				/* only objects in arrays are part of the scene collection */
+				return false;
+			} else {
+				const auto name = names.find(frame.id);
+				path = AddSubdir(path, name == names.end() ? nullptr : name->second.c_str());
+			}
+		}
+		AddReference(value, AddSubdir(path, key.c_str()), nullptr, key.c_str(), ordinal);
+		return false;
+	};
+	return TransformJsonFile(file, "", collect);
+}
+
+void LocalFileExporter::FindDuplicates(size_t jobs)
+{
+	/* only files sharing their size with another file need their content hashed */
+	std::map<uint64_t, std::vector<size_t>> sizes;
+	for (size_t i = 0; i < files.size(); i++)
+		sizes[files[i].size].push_back(i);
+	std::vector<size_t> hash;
+	for (const auto &size : sizes) {
+		if (size.second.size() > 1)
+			hash.insert(hash.end(), size.second.begin(), size.second.end());
+	}
+	if (hash.empty())
+		return;
+	Hash(hash, jobs);
+
+	std::map<std::pair<uint64_t, uint64_t>, std::vector<size_t>> contents;
+	for (size_t index : hash) {
+		const auto &file = files[index];
+		if (file.hashed)
+			contents[std::make_pair(file.size, file.hash)].push_back(index);
+	}
+	std::vector<const std::vector<size_t> *> groups;
+	for (const auto &content : contents) {
+		if (content.second.size() > 1)
+			groups.push_back(&content.second);
+	}
+	/* the same size and hash only make files candidates, a file is a copy of the first one in its group with the same
+	 * bytes and otherwise an original that later files are compared with */
+	RunParallel(groups.size(), jobs, [&](size_t i) {
+		std::vector<size_t> originals;
+		for (size_t index : *groups[i]) {
+			auto &file = files[index];
+			for (size_t original : originals) {
+				if (SameContent(files[original].source, file.source)) {
+					file.copy_of = original;
+					break;
+				}
+			}
+			if (file.copy_of == (size_t)-1)
+				originals.push_back(index);
+		}
+	});
+	for (const auto *group : groups) {
+		for (size_t index : *group) {
+			if (files[index].copy_of != (size_t)-1)
+				stats.duplicates++;
+		}
+	}
+}
+
+void LocalFileExporter::Hash(const std::vector<size_t> &indices, size_t jobs)
+{
+	RunParallel(indices.size(), jobs, [&](size_t i) {
+		auto &file = files[indices[i]];
+		if (!file.hashed)
+			file.hashed = HashFile(file.source, file.hash);
+	});
+}
+
+void LocalFileExporter::AssignPoolTargets(size_t jobs)
+{
+	std::vector<size_t> all(files.size());
+	for (size_t i = 0; i < all.size(); i++)
+		all[i] = i;
+	Hash(all, jobs);
+	FindDuplicates(jobs);
+	for (auto &file : files) {
+		if (file.copy_of != (size_t)-1 || !file.hashed)
+			continue;
+		const auto hash = HashToString(file.hash);
+		const auto name = GetFilenameFromPath(file.source, true);
+		const auto point = name.find_last_of('.');
+		std::string ext = point == std::string::npos ? "" : name.substr(point);
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+		file.target = "media/" + hash.substr(0, 2) + "/" + hash + ext;
+	}
+	content_addressed = true;
+}
+
+void LocalFileExporter::AssignTargets(bool create_dirs)
+{
+	/* different files that would end up at the same place get a numbered name */
+	std::unordered_set<std::string> targets;
+	std::unordered_set<std::string> dirs;
+	for (auto &file : files) {
+		if (file.copy_of != (size_t)-1)
+			continue;
+		if (!targets.insert(file.target).second) {
+			const auto slash = file.target.find_last_of('/');
+			auto point = file.target.find_last_of('.');
+			if (point == std::string::npos || (slash != std::string::npos && point < slash))
+				point = file.target.length();
+			const auto base = file.target.substr(0, point);
+			const auto ext = file.target.substr(point);
+			for (int n = 2;; n++) {
+				auto target = base + " (" + std::to_string(n) + ")" + ext;
+				if (targets.insert(target).second) {
+					file.target = target;
+					break;
+				}
+			}
+		}
+		const auto slash = file.target.find_last_of('/');
+		if (create_dirs && slash != std::string::npos && dirs.insert(file.target.substr(0, slash)).second)
+			os_mkdirs((dir + file.target.substr(0, slash)).c_str());
+	}
+}
+
+void LocalFileExporter::SkipUnchanged(const ExportOptions &options)
+{
+	obs_data_t *data = obs_data_create_from_json_file((dir + EXPORT_MANIFEST).c_str());
+	obs_data_array_t *array = obs_data_get_array(data, "files");
+	const size_t count = obs_data_array_count(array);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		if (!item)
+			continue;
+		auto &entry = manifest[obs_data_get_string(item, "target")];
+		entry.source = obs_data_get_string(item, "source");
+		entry.size = (uint64_t)obs_data_get_int(item, "size");
+		entry.mtime = obs_data_get_int(item, "mtime");
+		entry.hash = obs_data_get_string(item, "hash");
+		obs_data_release(item);
+	}
+	obs_data_array_release(array);
+	obs_data_release(data);
+
+	/* a file is unchanged if it was copied from the same source with the same size and the copy is still there,
+	 * with verify_hash every file is hashed so the new manifest has the hashes for the next export */
+	std::vector<size_t> unique;
+	std::vector<size_t> candidates;
+	for (size_t i = 0; i < files.size(); i++) {
+		auto &file = files[i];
+		if (file.copy_of != (size_t)-1)
+			continue;
+		unique.push_back(i);
+		const bool sameSize = os_get_file_size((dir + file.target).c_str()) == (int64_t)file.size;
+		const auto it = manifest.find(file.target);
+		if (it == manifest.end() || it->second.source != file.source || it->second.size != file.size || !sameSize) {
+			/* a pooled file is named after its content, the name only finds a candidate like the hash does */
+			if (content_addressed && file.hashed && sameSize && SameContent(file.source, dir + file.target))
+				file.unchanged = true;
+			continue;
+		}
+		if (options.verify_hash)
+			candidates.push_back(i);
+		else if (it->second.mtime == file.mtime)
+			file.unchanged = true;
+	}
+	if (options.verify_hash) {
+		Hash(unique, options.jobs);
+		for (size_t i : candidates) {
+			auto &file = files[i];
+			if (file.hashed && manifest[file.target].hash == HashToString(file.hash))
+				file.unchanged = true;
+		}
+	}
+	for (auto &file : files) {
+		if (file.unchanged) {
+			file.copied = true;
+			stats.unchanged++;
+		}
+	}
+}
+
+void LocalFileExporter::SaveManifest(bool prune)
+{
+	std::unordered_set<std::string> targets;
+	obs_data_array_t *array = obs_data_array_create();
+	auto addEntry = [array](const std::string &target, const ManifestEntry &entry) {
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "target", target.c_str());
+		obs_data_set_string(item, "source", entry.source.c_str());
+		obs_data_set_int(item, "size", (long long)entry.size);
+		obs_data_set_int(item, "mtime", entry.mtime);
+		if (!entry.hash.empty())
+			obs_data_set_string(item, "hash", entry.hash.c_str());
+		obs_data_array_push_back(array, item);
+		obs_data_release(item);
+	};
+	for (const auto &file : files) {
+		if (file.copy_of != (size_t)-1)
+			continue;
+		if (!file.copied) {
+			/* the copy failed, what an earlier export left there is still tracked and never pruned */
+			if (!targets.insert(file.target).second)
+				continue;
+			const auto it = manifest.find(file.target);
+			if (it != manifest.end())
+				addEntry(it->first, it->second);
+			continue;
+		}
+		targets.insert(file.target);
+		addEntry(file.target, {file.source, file.size, file.mtime, file.hashed ? HashToString(file.hash) : ""});
+	}
+	if (prune) {
+		/* only files written by an earlier export are removed, never anything else in dir */
+		for (const auto &entry : manifest) {
+			if (targets.count(entry.first) || entry.first.empty())
+				continue;
+			std::string path = dir + entry.first;
+			if (os_unlink(path.c_str()) != 0)
+				continue;
+			stats.removed++;
+			for (auto slash = entry.first.find_last_of('/'); slash != std::string::npos && slash > 0;
+			     slash = entry.first.find_last_of('/', slash - 1)) {
+				if (os_rmdir((dir + entry.first.substr(0, slash)).c_str()) != 0)
+					break;
+			}
+		}
+	} else {
+		/* keep tracking files that are not referenced anymore so a later export can still prune them */
+		for (const auto &entry : manifest) {
+			if (!targets.count(entry.first))
+				addEntry(entry.first, entry.second);
+		}
+	}
+	obs_data_t *data = obs_data_create();
+	obs_data_set_array(data, "files", array);
+	obs_data_array_release(array);
+	if (!obs_data_save_json_safe(data, (dir + EXPORT_MANIFEST).c_str(), "tmp", "bak"))
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to save export manifest in '%s'", dir.c_str());
+	obs_data_release(data);
+}
+
+void LocalFileExporter::Copy(size_t jobs)
+{
+	std::vector<size_t> copy;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (files[i].copy_of == (size_t)-1 && !files[i].unchanged)
+			copy.push_back(i);
+	}
+	/* largest files first so one big file does not end up last on a single worker */
+	std::sort(copy.begin(), copy.end(), [this](size_t a, size_t b) { return files[a].size > files[b].size; });
+	RunParallel(copy.size(), jobs, [&](size_t i) {
+		auto &file = files[copy[i]];
+		file.copied = CopyFileFast(file.source.c_str(), (dir + file.target).c_str());
+		if (!file.copied)
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to copy '%s' to '%s'", file.source.c_str(),
+			     (dir + file.target).c_str());
+	});
+	for (auto &file : files) {
+		if (file.copy_of != (size_t)-1 || file.unchanged) {
+			continue;
+		} else if (file.copied) {
+			stats.files++;
+			stats.bytes += file.size;
+		} else {
+			stats.failed++;
+		}
+	}
+}
+
+static bool IsCompressible(const std::string &path)
+{
+	static const char *extensions[] = {"txt", "json", "html", "htm", "css", "js", "lua", "py", "svg", "xml", "csv", "ini", "md"};
+	const auto point = path.find_last_of('.');
+	if (point == std::string::npos)
+		return false;
+	for (const char *ext : extensions) {
+		if (astrcmpi(path.c_str() + point + 1, ext) == 0)
+			return true;
+	}
+	return false;
+}
+
+void LocalFileExporter::Write(ZipWriter &zip)
+{
+	/* media is mostly compressed already, only text is deflated */
+	for (auto &file : files) {
+		if (file.copy_of != (size_t)-1)
+			continue;
+		file.copied = zip.AddFile(file.target, file.source.c_str(), IsCompressible(file.target));
+		if (file.copied) {
+			stats.files++;
+			stats.bytes += file.size;
+		} else {
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to add '%s' to the archive", file.source.c_str());
+			stats.failed++;
+		}
+	}
+}
+
+void LocalFileExporter::Rewrite()
+{
+	for (const auto &reference : references) {
+		size_t index = reference.file;
+		if (files[index].copy_of != (size_t)-1)
+			index = files[index].copy_of;
+		if (!files[index].copied)
+			continue;
+		std::string str = reference.local_url ? "file://" : "";
+		str += files[index].target;
+		if (reference.data)
+			obs_data_set_string(reference.data, reference.name.c_str(), str.c_str());
+		else
+			rewrites[reference.ordinal] = {reference.original, str};
+		stats.references++;
+	}
+}
+
+bool LocalFileExporter::RewriteFile(const std::string &file, const std::string &out)
+{
+	/* written next to out first so an export over the original file never leaves half a collection behind */
+	const auto tmp = out + ".tmp";
+	bool mismatch = false;
+	auto rewrite = [&](const std::vector<JsonStreamFrame> &, const std::string &, size_t ordinal, std::string &value) {
+		const auto it = rewrites.find(ordinal);
+		if (it == rewrites.end())
+			return false;
+		/* file is the same as when it was collected, a different string means the ordinals do not match anymore */
+		if (it->second.first != value) {
+			mismatch = true;
+			return false;
+		}
+		value = it->second.second;
+		return true;
+	};
+	if (!TransformJsonFile(file, tmp, rewrite) || mismatch) {
+		os_unlink(tmp.c_str());
+		return false;
+	}
+	if (os_rename(tmp.c_str(), out.c_str()) != 0) {
+		os_unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool HasExportManifest(const std::string &dir)
+{
+	return os_file_exists((dir + EXPORT_MANIFEST).c_str());
+}
+
+ExportStats export_local_files(obs_data_t *data, std::string dir, std::string subdir, const ExportOptions &options)
+{
+	LocalFileExporter exporter(dir);
+	exporter.Collect(data, subdir);
+	exporter.FindDuplicates(options.jobs);
+	exporter.AssignTargets(true);
+	exporter.SkipUnchanged(options);
+	exporter.Copy(options.jobs);
+	exporter.Rewrite();
+	exporter.SaveManifest(options.prune);
+	blog(LOG_INFO,
+	     "[Scene Collection Manager] exported %zu files (%llu bytes) for %zu references, %zu unchanged, %zu duplicates, %zu failed, %zu removed",
+	     exporter.stats.files, (unsigned long long)exporter.stats.bytes, exporter.stats.references, exporter.stats.unchanged,
+	     exporter.stats.duplicates, exporter.stats.failed, exporter.stats.removed);
+	return exporter.stats;
+}
+
+ExportStats ExportSceneCollectionFile(const std::string &file, const std::string &out, std::string dir, std::string subdir,
+				      const ExportOptions &options)
+{
+	/* both passes read a copy, so OBS saving the collection while the files are copied can not shift the references,
+	 * a collection that can not be read falls back to its .bak like obs_data_create_from_json_file_safe */
+	const auto snapshot = out + ".export";
+	std::unique_ptr<LocalFileExporter> exporter;
+	for (const auto &source : {file, file + ".bak"}) {
+		if (!os_file_exists(source.c_str()) || !CopyFileFast(source.c_str(), snapshot.c_str()))
+			continue;
+		auto candidate = std::make_unique<LocalFileExporter>(dir);
+		if (candidate->CollectFile(snapshot, subdir)) {
+			exporter = std::move(candidate);
+			break;
+		}
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to read '%s'", source.c_str());
+	}
+	if (!exporter) {
+		os_unlink(snapshot.c_str());
+		return {};
+	}
+	exporter->FindDuplicates(options.jobs);
+	exporter->AssignTargets(true);
+	exporter->SkipUnchanged(options);
+	exporter->Copy(options.jobs);
+	exporter->Rewrite();
+	exporter->SaveManifest(options.prune);
+	if (exporter->RewriteFile(snapshot, out))
+		exporter->stats.collections++;
+	else
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to save '%s'", out.c_str());
+	os_unlink(snapshot.c_str());
+	blog(LOG_INFO,
+	     "[Scene Collection Manager] exported %zu files (%llu bytes) for %zu references, %zu unchanged, %zu duplicates, %zu failed, %zu removed",
+	     exporter->stats.files, (unsigned long long)exporter->stats.bytes, exporter->stats.references, exporter->stats.unchanged,
+	     exporter->stats.duplicates, exporter->stats.failed, exporter->stats.removed);
+	return exporter->stats;
+}
+
+ExportStats ExportSceneCollections(const std::vector<obs_data_t *> &collections, std::string dir, const ExportOptions &options)
+{
+	LocalFileExporter exporter(dir);
+	for (obs_data_t *data : collections)
+		exporter.Collect(data, "");
+	exporter.AssignPoolTargets(options.jobs);
+	exporter.AssignTargets(true);
+	exporter.SkipUnchanged(options);
+	exporter.Copy(options.jobs);
+	exporter.Rewrite();
+	exporter.SaveManifest(options.prune);
+
+	for (obs_data_t *data : collections) {
+		std::string safeName;
+		if (!GetFileSafeName(obs_data_get_string(data, "name"), safeName))
+			continue;
+		const auto file = dir + safeName + ".json";
+		if (obs_data_save_json_safe(data, file.c_str(), "tmp", "bak"))
+			exporter.stats.collections++;
+		else
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to save '%s'", file.c_str());
+	}
+	blog(LOG_INFO,
+	     "[Scene Collection Manager] exported %zu collections with %zu files (%llu bytes) for %zu references, %zu unchanged, %zu duplicates, %zu failed",
+	     exporter.stats.collections, exporter.stats.files, (unsigned long long)exporter.stats.bytes, exporter.stats.references,
+	     exporter.stats.unchanged, exporter.stats.duplicates, exporter.stats.failed);
+	return exporter.stats;
+}
+
+bool ExportSceneCollectionArchive(obs_data_t *data, const std::string &file, size_t jobs)
+{
+	ZipWriter zip;
+	if (!zip.Open(file.c_str())) {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to create archive '%s'", file.c_str());
+		return false;
+	}
+	LocalFileExporter exporter("");
+	exporter.Collect(data, "");
+	exporter.FindDuplicates(jobs);
+	exporter.AssignTargets(false);
+	exporter.Write(zip);
+	exporter.Rewrite();
+
+	/* the collection goes last so references to files that could not be added keep their original path */
+	const char *json = obs_data_get_json(data);
+	const auto name = GetFilenameFromPath(file, false) + ".json";
+	bool success = json && zip.AddData(name, json, strlen(json), true);
+	success = zip.Close() && success;
+	if (!success) {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to write archive '%s'", file.c_str());
+		os_unlink(file.c_str());
+		return false;
+	}
+	blog(LOG_INFO, "[Scene Collection Manager] exported %zu files (%llu bytes) for %zu references into '%s'", exporter.stats.files,
+	     (unsigned long long)exporter.stats.bytes, exporter.stats.references, file.c_str());
+	return true;
+}
+
+bool CopyFileFast(const char *from, const char *to)
+{
+#if defined(__linux__)
+	const int in = open(from, O_RDONLY | O_CLOEXEC);
+	if (in >= 0) {
+		struct stat st {};
+		const int out = fstat(in, &st) == 0 ? open(to, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+		bool success = false;
+		if (out >= 0) {
+#ifdef FICLONE
+			success = ioctl(out, FICLONE, in) == 0;
+#endif
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+			off_t copied = 0;
+			while (!success && copied < st.st_size) {
+				const ssize_t n = copy_file_range(in, nullptr, out, nullptr, (size_t)(st.st_size - copied), 0);
+				if (n <= 0)
+					break;
+				copied += n;
+			}
+			if (copied == st.st_size)
+				success = true;
+#endif
+			close(out);
+		}
+		close(in);
+		if (success)
+			return true;
+	}
+#elif defined(__APPLE__)
+	unlink(to);
+	if (clonefile(from, to, 0) == 0)
+		return true;
+#endif
+	/* os_copyfile does not overwrite */
+	if (os_file_exists(to))
+		os_unlink(to);
+	return os_copyfile(from, to) == 0;
+}
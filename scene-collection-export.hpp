@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "obs.h"
+
+struct ExportStats {
+	size_t collections = 0;
+	size_t references = 0;
+	size_t files = 0;
+	size_t duplicates = 0;
+	size_t failed = 0;
+	size_t unchanged = 0;
+	size_t removed = 0;
+	uint64_t bytes = 0;
+};
+
+struct ExportOptions {
+	size_t jobs = 0;
+	/* compare the content hash instead of the modification time against the previous export */
+	bool verify_hash = false;
+	/* remove files of the previous export that are no longer referenced */
+	bool prune = false;
+};
+
+/* whether dir holds the manifest of an earlier export, so exporting into it again is incremental */
+bool HasExportManifest(const std::string &dir);
+
+/* copies the local files referenced by the scene collection into dir and rewrites the references relative to dir,
+ * a file referenced more than once or with the same content as another file is copied only once,
+ * files that did not change since the export recorded in the manifest of dir are not copied again */
+ExportStats export_local_files(obs_data_t *data, std::string dir, std::string subdir, const ExportOptions &options = {});
+
+/* export_local_files for a scene collection file that is streamed instead of loaded, the rewritten collection is saved
+ * as out which may be the same as file, collections is 1 in the result when out was saved */
+ExportStats ExportSceneCollectionFile(const std::string &file, const std::string &out, std::string dir, std::string subdir,
+				      const ExportOptions &options = {});
+
+/* exports several scene collections into dir as <safe name>.json, the local files of all of them are copied once into
+ * a content addressed pool media/<xx>/<hash><ext> that all collections point into */
+ExportStats ExportSceneCollections(const std::vector<obs_data_t *> &collections, std::string dir, const ExportOptions &options = {});
+
+/* streams the scene collection and the local files it references into one zip archive, the collection is stored at
+ * the root with the files relative to it so the archive can be imported again */
+bool ExportSceneCollectionArchive(obs_data_t *data, const std::string &file, size_t jobs = 0);
+
+/* copies a file using a reflink or an in-kernel copy where the file system supports it, overwrites an existing file */
+bool CopyFileFast(const char *from, const char *to);
@@ -0,0 +1,69 @@
+#include "scene-collection-info.hpp"
+
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+
+#include "scene-collection-core.hpp"
+#include "scene-collection-json-stream.hpp"
+#include "util/platform.h"
+
+int64_t GetModifiedTime(const std::string &path)
+{
+	struct stat st {};
+	if (os_stat(path.c_str(), &st) != 0)
+		return 0;
+	return (int64_t)st.st_mtime;
+}
+
+static bool IsLocalFile(std::string str)
+{
+	if (str.substr(0, 7) == "file://")
+		str = str.substr(7);
+	if (str.length() >= MAX_PATH || str.find_first_of("/\\") == std::string::npos || str.find('\n') != std::string::npos)
+		return false;
+	struct stat st {};
+	return os_stat(str.c_str(), &st) == 0 && (st.st_mode & S_IFMT) != S_IFDIR;
+}
+
+bool GetSceneCollectionInfo(const std::string &file, const std::string &backupDir, SceneCollectionInfo &info,
+			    const std::function<bool()> &cancelled)
+{
+	info = SceneCollectionInfo();
+	struct stat st {};
+	if (os_stat(file.c_str(), &st) != 0)
+		return false;
+	info.size = (uint64_t)st.st_size;
+	info.modified = (int64_t)st.st_mtime;
+
+	/* sources and groups are the top level arrays, their filters an array inside every source */
+	std::unordered_set<std::string> files;
+	auto count = [&](const std::vector<JsonStreamFrame> &frames, const std::string &key, size_t, std::string &value) {
+		if (key == "id" && frames.size() == 3 && (frames[1].key == "sources" || frames[1].key == "groups")) {
+			if (value == "scene")
+				info.scenes++;
+			else
+				info.sources++;
+			info.source_types[value]++;
+		} else if (key == "id" && frames.size() == 5 && frames[3].key == "filters") {
+			info.filters++;
+		} else if (!files.count(value) && IsLocalFile(value)) {
+			files.insert(value);
+		}
+		return false;
+	};
+	if (!TransformJsonFile(file, "", count, cancelled))
+		return false;
+	info.files = files.size();
+
+	for (const auto &backup : ListBackups(backupDir, false)) {
+		if (cancelled && cancelled())
+			return false;
+		const auto size = os_get_file_size(backup.path.c_str());
+		if (size > 0)
+			info.backup_bytes += (uint64_t)size;
+		info.backups++;
+	}
+	info.backups_modified = GetModifiedTime(backupDir);
+	return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+struct SceneCollectionInfo {
+	uint64_t size = 0;
+	int64_t modified = 0;
+	size_t scenes = 0;
+	size_t sources = 0;
+	size_t filters = 0;
+	/* distinct local files referenced that exist */
+	size_t files = 0;
+	std::map<std::string, size_t> source_types;
+	size_t backups = 0;
+	uint64_t backup_bytes = 0;
+	/* modification time of the backup directory, changes when a backup is added or removed */
+	int64_t backups_modified = 0;
+};
+
+/* modification time of a file or directory in seconds, 0 when it does not exist */
+int64_t GetModifiedTime(const std::string &path);
+
+/* reads the scene collection file without loading it and lists the backups in backupDir,
+ * returns false when the file could not be read or cancelled returned true */
+bool GetSceneCollectionInfo(const std::string &file, const std::string &backupDir, SceneCollectionInfo &info,
+			    const std::function<bool()> &cancelled = {});
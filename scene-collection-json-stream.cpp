@@ -0,0 +1,372 @@
+#include "scene-collection-json-stream.hpp"
+
+#include <cstdio>
+
+#include "util/base.h"
+#include "util/platform.h"
+
+#define JSON_STREAM_BUFFER_SIZE (64 * 1024)
+
+class JsonStream {
+public:
+	JsonStream(FILE *in, FILE *out, const JsonStringHandler &handler, const std::function<bool()> &cancelled)
+		: in(in),
+		  out(out),
+		  handler(handler),
+		  cancelled(cancelled)
+	{
+		input.resize(JSON_STREAM_BUFFER_SIZE);
+		if (out)
+			output.reserve(JSON_STREAM_BUFFER_SIZE);
+	}
+
+	bool Run();
+	bool Stopped() const { return stopped; }
+
+private:
+	int Get();
+	void Put(char c);
+	void Put(const std::string &str);
+	bool Flush();
+	/* reads a string after its opening quote, long is set when it did not fit and was passed through already */
+	bool ReadString(std::string &raw, bool &long_string);
+	static bool Decode(const std::string &raw, std::string &value);
+	static std::string Encode(const std::string &value);
+	void PassThrough(const std::string &raw, bool long_string);
+	void OnString();
+
+	FILE *in;
+	FILE *out;
+	const JsonStringHandler &handler;
+	const std::function<bool()> &cancelled;
+	bool stopped = false;
+	std::vector<char> input;
+	size_t input_pos = 0;
+	size_t input_size = 0;
+	std::string output;
+	bool write_failed = false;
+
+	std::vector<JsonStreamFrame> frames;
+	std::vector<std::string> keys;
+	std::vector<char> expect_key;
+	uint64_t next_id = 0;
+	size_t ordinal = 0;
+};
+
+int JsonStream::Get()
+{
+	if (input_pos == input_size) {
+		if (cancelled && cancelled()) {
+			stopped = true;
+			return EOF;
+		}
+		input_size = fread(input.data(), 1, input.size(), in);
+		input_pos = 0;
+		if (input_size == 0)
+			return EOF;
+	}
+	return (unsigned char)input[input_pos++];
+}
+
+void JsonStream::Put(char c)
+{
+	if (!out)
+		return;
+	output.push_back(c);
+	if (output.size() >= JSON_STREAM_BUFFER_SIZE)
+		Flush();
+}
+
+void JsonStream::Put(const std::string &str)
+{
+	if (!out)
+		return;
+	output.append(str);
+	if (output.size() >= JSON_STREAM_BUFFER_SIZE)
+		Flush();
+}
+
+bool JsonStream::Flush()
+{
+	if (out && !output.empty()) {
+		if (fwrite(output.data(), 1, output.size(), out) != output.size())
+			write_failed = true;
+		output.clear();
+	}
+	return !write_failed;
+}
+
+bool JsonStream::ReadString(std::string &raw, bool &long_string)
+{
+	raw.clear();
+	long_string = false;
+	bool escape = false;
+	for (;;) {
+		const int c = Get();
+		if (c == EOF)
+			return false;
+		if (!escape && c == '"')
+			return true;
+		escape = !escape && c == '\\';
+		if (long_string) {
+			Put((char)c);
+			continue;
+		}
+		raw.push_back((char)c);
+		if (raw.size() > JSON_STREAM_MAX_STRING) {
+			Put('"');
+			Put(raw);
+			raw.clear();
+			long_string = true;
+		}
+	}
+}
+
+static void AppendUtf8(std::string &str, uint32_t cp)
+{
+	if (cp < 0x80) {
+		str.push_back((char)cp);
+	} else if (cp < 0x800) {
+		str.push_back((char)(0xC0 | (cp >> 6)));
+		str.push_back((char)(0x80 | (cp & 0x3F)));
+	} else if (cp < 0x10000) {
+		str.push_back((char)(0xE0 | (cp >> 12)));
+		str.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+		str.push_back((char)(0x80 | (cp & 0x3F)));
+	} else {
+		str.push_back((char)(0xF0 | (cp >> 18)));
+		str.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+		str.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+		str.push_back((char)(0x80 | (cp & 0x3F)));
+	}
+}
+
+static bool ParseHex4(const std::string &raw, size_t pos, uint32_t &value)
+{
+	if (pos + 4 > raw.size())
+		return false;
+	value = 0;
+	for (size_t i = pos; i < pos + 4; i++) {
+		const char c = raw[i];
+		value <<= 4;
+		if (c >= '0' && c <= '9')
+			value |= (uint32_t)(c - '0');
+		else if (c >= 'a' && c <= 'f')
+			value |= (uint32_t)(c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F')
+			value |= (uint32_t)(c - 'A' + 10);
+		else
+			return false;
+	}
+	return true;
+}
+
+bool JsonStream::Decode(const std::string &raw, std::string &value)
+{
+	value.clear();
+	value.reserve(raw.size());
+	for (size_t i = 0; i < raw.size(); i++) {
+		const char c = raw[i];
+		if (c != '\\') {
+			value.push_back(c);
+			continue;
+		}
+		if (++i >= raw.size())
+			return false;
+		switch (raw[i]) {
+		case '"':
+		case '\\':
+		case '/':
+			value.push_back(raw[i]);
+			break;
+		case 'b':
+			value.push_back('\b');
+			break;
+		case 'f':
+			value.push_back('\f');
+			break;
+		case 'n':
+			value.push_back('\n');
+			break;
+		case 'r':
+			value.push_back('\r');
+			break;
+		case 't':
+			value.push_back('\t');
+			break;
+		case 'u': {
+			uint32_t cp;
+			if (!ParseHex4(raw, i + 1, cp))
+				return false;
+			i += 4;
+			uint32_t low;
+			if (cp >= 0xD800 && cp < 0xDC00 && i + 6 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u' &&
+			    ParseHex4(raw, i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				i += 6;
+			}
+			AppendUtf8(value, cp);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string JsonStream::Encode(const std::string &value)
+{
+	std::string raw;
+	raw.reserve(value.size() + 2);
+	for (const char c : value) {
+		switch (c) {
+		case '"':
+			raw += "\\\"";
+			break;
+		case '\\':
+			raw += "\\\\";
+			break;
+		case '\n':
+			raw += "\\n";
+			break;
+		case '\r':
+			raw += "\\r";
+			break;
+		case '\t':
+			raw += "\\t";
+			break;
+		case '\b':
+			raw += "\\b";
+			break;
+		case '\f':
+			raw += "\\f";
+			break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+				raw += escaped;
+			} else {
+				raw.push_back(c);
+			}
+		}
+	}
+	return raw;
+}
+
+void JsonStream::PassThrough(const std::string &raw, bool long_string)
+{
+	if (!long_string) {
+		Put('"');
+		Put(raw);
+	}
+	Put('"');
+}
+
+void JsonStream::OnString()
+{
+	std::string raw;
+	bool long_string;
+	const bool object = !frames.empty() && !frames.back().array;
+	if (!ReadString(raw, long_string)) {
+		if (!long_string) {
+			Put('"');
+			Put(raw);
+		}
+		return;
+	}
+	if (object && expect_key.back()) {
+		PassThrough(raw, long_string);
+		if (long_string || !Decode(raw, keys.back()))
+			keys.back().clear();
+		expect_key.back() = false;
+		return;
+	}
+	if (!object) {
+		PassThrough(raw, long_string);
+		return;
+	}
+
+	std::string value;
+	if (!long_string && Decode(raw, value) && handler(frames, keys.back(), ordinal, value)) {
+		Put('"');
+		Put(Encode(value));
+		Put('"');
+	} else {
+		PassThrough(raw, long_string);
+	}
+	ordinal++;
+}
+
+bool JsonStream::Run()
+{
+	int c;
+	while ((c = Get()) != EOF) {
+		switch (c) {
+		case '{':
+		case '[': {
+			Put((char)c);
+			JsonStreamFrame frame;
+			frame.array = c == '[';
+			if (!frames.empty() && !frames.back().array)
+				frame.key = keys.back();
+			frame.id = ++next_id;
+			frames.push_back(std::move(frame));
+			keys.emplace_back();
+			expect_key.push_back(c == '{');
+			break;
+		}
+		case '}':
+		case ']':
+			Put((char)c);
+			if (frames.empty() || frames.back().array != (c == ']'))
+				return false;
+			frames.pop_back();
+			keys.pop_back();
+			expect_key.pop_back();
+			break;
+		case ',':
+			Put((char)c);
+			if (!frames.empty() && !frames.back().array)
+				expect_key.back() = true;
+			break;
+		case '"':
+			OnString();
+			break;
+		default:
+			Put((char)c);
+		}
+		if (write_failed)
+			return false;
+	}
+	return frames.empty() && Flush();
+}
+
+bool TransformJsonFile(const std::string &file, const std::string &out, const JsonStringHandler &handler,
+		       const std::function<bool()> &cancelled)
+{
+	FILE *in = os_fopen(file.c_str(), "rb");
+	if (!in)
+		return false;
+	FILE *o = nullptr;
+	if (!out.empty()) {
+		o = os_fopen(out.c_str(), "wb");
+		if (!o) {
+			fclose(in);
+			return false;
+		}
+	}
+	JsonStream stream(in, o, handler, cancelled);
+	bool success = stream.Run() && !ferror(in);
+	fclose(in);
+	if (o) {
+		if (fclose(o) != 0)
+			success = false;
+		if (!success)
+			os_unlink(out.c_str());
+	}
+	if (!success && !stream.Stopped())
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to transform '%s'", file.c_str());
+	return success;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/* strings longer than this are passed through without being decoded */
+#define JSON_STREAM_MAX_STRING (64 * 1024)
+
+struct JsonStreamFrame {
+	bool array = false;
+	/* the key of this container in its parent object, empty when the parent is an array */
+	std::string key;
+	/* unique for every container in the stream, stays the same between passes over the same file */
+	uint64_t id = 0;
+};
+
+/* called for every string value of an object member with the containers it is in, its key and its position among these
+ * strings, return true after changing value to replace the string in the output */
+using JsonStringHandler =
+	std::function<bool(const std::vector<JsonStreamFrame> &frames, const std::string &key, size_t ordinal, std::string &value)>;
+
+/* copies the json in file to out token by token so memory use does not depend on the size of the file, only string values
+ * can be replaced and everything else is copied as is, with an empty out the file is only read,
+ * cancelled is checked before every read and stops the transform with a failure */
+bool TransformJsonFile(const std::string &file, const std::string &out, const JsonStringHandler &handler,
+		       const std::function<bool()> &cancelled = {});
@@ -0,0 +1,84 @@
+#include "scene-collection-lock.hpp"
+
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+#include "util/base.h"
+#include "util/bmem.h"
+#include "util/platform.h"
+
+#define BACKUP_LOCK_RETRY_MS 50
+
+BackupDirLock::BackupDirLock(const std::string &backupDir, int timeoutMs)
+{
+	const auto path = backupDir + BACKUP_LOCK_FILE;
+#ifdef _WIN32
+	wchar_t *wpath = nullptr;
+	if (!os_utf8_to_wcs_ptr(path.c_str(), 0, &wpath))
+		return;
+	HANDLE h = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			       OPEN_ALWAYS, FILE_ATTRIBUTE_HIDDEN, nullptr);
+	bfree(wpath);
+	if (h == INVALID_HANDLE_VALUE)
+		return;
+	handle = h;
+#else
+	fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return;
+#endif
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	bool contended = false;
+	bool busy = false;
+	for (;;) {
+#ifdef _WIN32
+		OVERLAPPED overlapped = {};
+		locked = LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != 0;
+		busy = !locked && GetLastError() == ERROR_LOCK_VIOLATION;
+#else
+		locked = flock(fd, LOCK_EX | LOCK_NB) == 0;
+		busy = !locked && errno == EWOULDBLOCK;
+#endif
+		if (locked || !busy || std::chrono::steady_clock::now() >= deadline)
+			break;
+		contended = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(BACKUP_LOCK_RETRY_MS));
+	}
+	if (busy)
+		blog(LOG_WARNING, "[Scene Collection Manager] backup directory '%s' is locked by another instance, skipped",
+		     backupDir.c_str());
+	else if (!locked)
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to lock backup directory '%s'", backupDir.c_str());
+	else if (contended)
+		blog(LOG_INFO, "[Scene Collection Manager] waited for the lock on backup directory '%s'", backupDir.c_str());
+}
+
+BackupDirLock::~BackupDirLock()
+{
+#ifdef _WIN32
+	if (!handle)
+		return;
+	if (locked) {
+		OVERLAPPED overlapped = {};
+		UnlockFileEx(handle, 0, 1, 0, &overlapped);
+	}
+	CloseHandle(handle);
+#else
+	if (fd < 0)
+		return;
+	/* the lock file stays, removing it would let another instance lock a file that is no longer in the directory */
+	if (locked)
+		flock(fd, LOCK_UN);
+	close(fd);
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+/* name of the lock file inside a backup directory */
+#define BACKUP_LOCK_FILE ".scene-collection-manager.lock"
+#define BACKUP_LOCK_TIMEOUT_MS 2000
+
+/* advisory lock on a backup directory that other OBS instances may share, the lock is only held for a prune pass or a
+ * rename and given up after timeoutMs of non-blocking attempts, which is logged */
+class BackupDirLock {
+public:
+	explicit BackupDirLock(const std::string &backupDir, int timeoutMs = BACKUP_LOCK_TIMEOUT_MS);
+	~BackupDirLock();
+	BackupDirLock(const BackupDirLock &) = delete;
+	BackupDirLock &operator=(const BackupDirLock &) = delete;
+
+	bool Locked() const { return locked; }
+
+private:
+	bool locked = false;
+#ifdef _WIN32
+	void *handle = nullptr;
+#else
+	int fd = -1;
+#endif
+};
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "scene-collection-convert.hpp"
+#include "scene-collection-core.hpp"
+#include "scene-collection-export.hpp"
+#include "scene-collection-trash.hpp"
+#include "util/platform.h"
+
+/* generates synthetic scene collections and times the collection operations on them,
+ * every measurement is printed as one JSON object per line */
+
+struct BenchmarkConfig {
+	size_t collections = 10;
+	size_t scenes = 20;
+	size_t sources = 200;
+	size_t depth = 3;
+	size_t filters = 2;
+	size_t backups = 50;
+	size_t parts = 50;
+	double pathDensity = 0.5;
+	size_t padding = 0;
+	size_t iterations = 3;
+	std::vector<size_t> scales = {1, 2, 4};
+	std::string work = "scene-collection-benchmark";
+	std::string mappings = "data/source-mappings.json";
+};
+
+struct GeneratedSet {
+	std::string scenesDir;
+	std::string collection;
+	std::string backupDir;
+	std::string movedDir;
+	size_t jsonSize = 0;
+};
+
+static const char *convertedTypes[] = {"dshow_input", "wasapi_input_capture", "wasapi_output_capture", "monitor_capture",
+				       "window_capture", "game_capture", "text_gdiplus"};
+
+static void PrintUsage()
+{
+	printf("Usage: scene-collection-manager-benchmark [options]\n"
+	       "\n"
+	       "Options:\n"
+	       "  --collections N     scene collections in the scenes directory (default 10)\n"
+	       "  --scenes N          scenes per collection (default 20)\n"
+	       "  --sources N         sources per collection (default 200)\n"
+	       "  --depth N           nesting depth of scenes (default 3)\n"
+	       "  --filters N         filters per source (default 2)\n"
+	       "  --backups N         backups of the collection (default 50)\n"
+	       "  --parts N           sources in the imported part (default 50)\n"
+	       "  --path-density F    fraction of sources referencing a local file (default 0.5)\n"
+	       "  --padding N         bytes of extra settings data per source, to grow the json (default 0)\n"
+	       "  --iterations N      runs per measurement, the median is reported (default 3)\n"
+	       "  --scale A,B,...     multipliers applied to collections, scenes, sources, backups and parts (default 1,2,4)\n"
+	       "  --mappings FILE     source-mappings.json used for conversion (default data/source-mappings.json)\n"
+	       "  --work DIR          the generated data is written to a new directory in DIR that is removed afterwards\n");
+}
+
+static bool ParseOptions(int argc, char **argv, BenchmarkConfig &config)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if (i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		if (strcmp(arg, "--collections") == 0) {
+			config.collections = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--scenes") == 0) {
+			config.scenes = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--sources") == 0) {
+			config.sources = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--depth") == 0) {
+			config.depth = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--filters") == 0) {
+			config.filters = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--backups") == 0) {
+			config.backups = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--parts") == 0) {
+			config.parts = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--path-density") == 0) {
+			config.pathDensity = atof(value);
+		} else if (strcmp(arg, "--padding") == 0) {
+			config.padding = strtoul(value, nullptr, 10);
+		} else if (strcmp(arg, "--iterations") == 0) {
+			config.iterations = std::max<size_t>(1, strtoul(value, nullptr, 10));
+		} else if (strcmp(arg, "--mappings") == 0) {
+			config.mappings = value;
+		} else if (strcmp(arg, "--work") == 0) {
+			config.work = value;
+		} else if (strcmp(arg, "--scale") == 0) {
+			config.scales.clear();
+			for (const char *p = value; *p;) {
+				char *end;
+				const size_t scale = strtoul(p, &end, 10);
+				if (end == p)
+					return false;
+				config.scales.push_back(std::max<size_t>(1, scale));
+				p = *end == ',' ? end + 1 : end;
+			}
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void WriteMediaFile(const std::string &path, size_t index)
+{
+	std::string content(4096, '\0');
+	for (size_t i = 0; i < content.size(); i++)
+		content[i] = (char)((index * 31 + i * 7) & 0xFF);
+	os_quick_write_utf8_file(path.c_str(), content.data(), content.size(), false);
+}
+
+static obs_data_t *GenerateSource(const BenchmarkConfig &config, size_t index, const std::string &oldMedia)
+{
+	obs_data_t *source = obs_data_create();
+	obs_data_t *settings = obs_data_create();
+	const std::string name = "Source " + std::to_string(index);
+	obs_data_set_string(source, "name", name.c_str());
+	const bool file = config.pathDensity > 0.0 &&
+			  (size_t)((double)(index + 1) * config.pathDensity) != (size_t)((double)index * config.pathDensity);
+	if (file) {
+		const std::string path = oldMedia + "media_" + std::to_string(index) + (index % 2 ? ".png" : ".mp4");
+		obs_data_set_string(source, "id", index % 2 ? "image_source" : "ffmpeg_source");
+		obs_data_set_string(settings, index % 2 ? "file" : "local_file", path.c_str());
+	} else {
+		const char *id = convertedTypes[index % (sizeof(convertedTypes) / sizeof(convertedTypes[0]))];
+		obs_data_set_string(source, "id", id);
+		if (strcmp(id, "text_gdiplus") == 0) {
+			obs_data_set_string(settings, "text", name.c_str());
+			obs_data_set_int(settings, "color", 0xFF8800);
+			obs_data_set_bool(settings, "extents_wrap", true);
+			obs_data_set_int(settings, "extents_cx", 400);
+		}
+	}
+	obs_data_set_string(source, "versioned_id", obs_data_get_string(source, "id"));
+	if (config.padding)
+		obs_data_set_string(settings, "padding", std::string(config.padding, 'x').c_str());
+	obs_data_set_obj(source, "settings", settings);
+	obs_data_release(settings);
+
+	obs_data_array_t *filters = obs_data_array_create();
+	for (size_t f = 0; f < config.filters; f++) {
+		obs_data_t *filter = obs_data_create();
+		obs_data_set_string(filter, "id", "color_filter");
+		obs_data_set_string(filter, "name", ("Filter " + std::to_string(f)).c_str());
+		obs_data_t *filterSettings = obs_data_create();
+		obs_data_set_double(filterSettings, "gamma", 0.1 * (double)f);
+		obs_data_set_obj(filter, "settings", filterSettings);
+		obs_data_release(filterSettings);
+		obs_data_array_push_back(filters, filter);
+		obs_data_release(filter);
+	}
+	obs_data_set_array(source, "filters", filters);
+	obs_data_array_release(filters);
+	return source;
+}
+
+static void AddSceneItem(obs_data_array_t *items, const std::string &name, size_t id)
+{
+	obs_data_t *item = obs_data_create();
+	obs_data_set_string(item, "name", name.c_str());
+	obs_data_set_int(item, "id", (long long)id);
+	obs_data_set_bool(item, "visible", true);
+	struct vec2 scale = {1.0f, 1.0f};
+	obs_data_set_vec2(item, "scale", &scale);
+	obs_data_array_push_back(items, item);
+	obs_data_release(item);
+}
+
+static obs_data_t *GenerateCollection(const BenchmarkConfig &config, const std::string &name, const std::string &oldMedia,
+				      const char *part)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_set_string(data, "name", name.c_str());
+	obs_data_array_t *sources = obs_data_array_create();
+	for (size_t i = 0; i < config.sources; i++) {
+		obs_data_t *source = GenerateSource(config, i, oldMedia);
+		obs_data_array_push_back(sources, source);
+		obs_data_release(source);
+	}
+	/* sources are spread over the scenes, every scene nests the next one up to depth */
+	for (size_t s = 0; s < config.scenes; s++) {
+		obs_data_t *scene = obs_data_create();
+		obs_data_set_string(scene, "id", "scene");
+		obs_data_set_string(scene, "versioned_id", "scene");
+		obs_data_set_string(scene, "name", ("Scene " + std::to_string(s)).c_str());
+		obs_data_t *settings = obs_data_create();
+		obs_data_array_t *items = obs_data_array_create();
+		size_t id = 1;
+		for (size_t i = s; i < config.sources; i += config.scenes)
+			AddSceneItem(items, "Source " + std::to_string(i), id++);
+		if (config.depth && (s + 1) % (config.depth + 1) != 0 && s + 1 < config.scenes)
+			AddSceneItem(items, "Scene " + std::to_string(s + 1), id++);
+		obs_data_set_array(settings, "items", items);
+		obs_data_array_release(items);
+		obs_data_set_obj(scene, "settings", settings);
+		obs_data_release(settings);
+		obs_data_array_push_back(sources, scene);
+		obs_data_release(scene);
+	}
+	obs_data_set_array(data, "sources", sources);
+	obs_data_array_release(sources);
+	if (part) {
+		obs_data_array_t *imports = obs_data_array_create();
+		obs_data_t *import = obs_data_create();
+		obs_data_set_string(import, "file", part);
+		obs_data_array_push_back(imports, import);
+		obs_data_release(import);
+		obs_data_set_array(data, "imports", imports);
+		obs_data_array_release(imports);
+	}
+	return data;
+}
+
+static GeneratedSet Generate(const BenchmarkConfig &config, const std::string &work)
+{
+	GeneratedSet set;
+	set.scenesDir = work + "scenes/";
+	set.movedDir = work + "moved/";
+	os_mkdirs(set.scenesDir.c_str());
+	os_mkdirs((set.movedDir + "media/").c_str());
+
+	/* the collections reference media in a location that no longer exists, the files were moved to movedDir */
+	const std::string oldMedia = work + "old/location/media/";
+	for (size_t i = 0; i < config.sources; i++) {
+		const bool file = config.pathDensity > 0.0 &&
+				  (size_t)((double)(i + 1) * config.pathDensity) != (size_t)((double)i * config.pathDensity);
+		if (file)
+			WriteMediaFile(set.movedDir + "media/media_" + std::to_string(i) + (i % 2 ? ".png" : ".mp4"), i);
+	}
+
+	BenchmarkConfig partConfig = config;
+	partConfig.sources = config.parts;
+	partConfig.scenes = 1;
+	obs_data_t *part = GenerateCollection(partConfig, "Part", oldMedia, nullptr);
+	obs_data_save_json(part, (set.scenesDir + "part.json").c_str());
+	obs_data_release(part);
+
+	for (size_t c = 0; c < config.collections; c++) {
+		const std::string name = "Collection " + std::to_string(c);
+		obs_data_t *data = GenerateCollection(config, name, oldMedia, c == 0 ? "part.json" : nullptr);
+		std::string safeName;
+		GetFileSafeName(name.c_str(), safeName);
+		const auto file = set.scenesDir + safeName + ".json";
+		obs_data_save_json(data, file.c_str());
+		obs_data_release(data);
+		if (c == 0)
+			set.collection = file;
+	}
+	set.backupDir = GetBackupDirectory(set.collection, "");
+	for (size_t b = 0; b < config.backups; b++) {
+		char name[32];
+		snprintf(name, sizeof(name), "2024-01-01 %02zu-%02zu-%02zu", (b / 3600) % 24, (b / 60) % 60, b % 60);
+		SaveBackup(set.collection, set.backupDir, name);
+	}
+	set.jsonSize = (size_t)std::max<int64_t>(0, os_get_file_size(set.collection.c_str()));
+	return set;
+}
+
+static void Report(const char *name, const BenchmarkConfig &config, const GeneratedSet &set, size_t scale,
+		   std::vector<uint64_t> &times)
+{
+	std::sort(times.begin(), times.end());
+	printf("{\"benchmark\":\"%s\",\"scale\":%zu,\"collections\":%zu,\"scenes\":%zu,\"sources\":%zu,\"depth\":%zu,"
+	       "\"filters\":%zu,\"backups\":%zu,\"parts\":%zu,\"path_density\":%g,\"json_bytes\":%zu,\"iterations\":%zu,"
+	       "\"median_ms\":%.3f,\"min_ms\":%.3f,\"max_ms\":%.3f}\n",
+	       name, scale, config.collections, config.scenes, config.sources, config.depth, config.filters, config.backups,
+	       config.parts, config.pathDensity, set.jsonSize, times.size(), (double)times[times.size() / 2] / 1000000.0,
+	       (double)times.front() / 1000000.0, (double)times.back() / 1000000.0);
+	fflush(stdout);
+}
+
+/* times run on a freshly loaded copy of the collection, loading is not included */
+static void MeasureOnData(const char *name, const BenchmarkConfig &config, const GeneratedSet &set, size_t scale,
+			  const std::function<void(obs_data_t *data)> &prepare, const std::function<void(obs_data_t *data)> &run)
+{
+	std::vector<uint64_t> times;
+	for (size_t i = 0; i < config.iterations; i++) {
+		obs_data_t *data = obs_data_create_from_json_file(set.collection.c_str());
+		if (prepare)
+			prepare(data);
+		const uint64_t start = os_gettime_ns();
+		run(data);
+		times.push_back(os_gettime_ns() - start);
+		obs_data_release(data);
+	}
+	Report(name, config, set, scale, times);
+}
+
+static void Measure(const char *name, const BenchmarkConfig &config, const GeneratedSet &set, size_t scale,
+		    const std::function<void(size_t iteration)> &run)
+{
+	std::vector<uint64_t> times;
+	for (size_t i = 0; i < config.iterations; i++) {
+		const uint64_t start = os_gettime_ns();
+		run(i);
+		times.push_back(os_gettime_ns() - start);
+	}
+	Report(name, config, set, scale, times);
+}
+
+static void RunBenchmarks(const BenchmarkConfig &config, const SourceTypeMappings &mappings, size_t scale)
+{
+	const std::string work = config.work + "/scale_" + std::to_string(scale) + "/";
+	RemoveDirectoryRecursive(work);
+	const GeneratedSet set = Generate(config, work);
+	const std::string scenesDir = set.scenesDir;
+	const std::string movedDir = set.movedDir;
+
+	Measure("load", config, set, scale, [&](size_t) { obs_data_release(obs_data_create_from_json_file(set.collection.c_str())); });
+	Measure("enumerate_collections", config, set, scale, [&](size_t) { EnumerateSceneCollections(scenesDir); });
+	Measure("list_backups", config, set, scale, [&](size_t) { ListBackups(set.backupDir); });
+	Measure("list_backup_files", config, set, scale, [&](size_t) { ListBackups(set.backupDir, false); });
+	Measure("backup_with_retention", config, set, scale, [&](size_t i) {
+		SaveBackup(set.collection, set.backupDir, "2099-01-01 00-00-" + std::to_string(i));
+		PruneBackups(set.backupDir, (int)config.backups);
+	});
+	MeasureOnData("import_parts", config, set, scale, nullptr, [&](obs_data_t *data) { import_parts(data, scenesDir.c_str()); });
+	MeasureOnData("try_fix_paths", config, set, scale, nullptr,
+		      [&](obs_data_t *data) { try_fix_paths(data, movedDir.c_str()); });
+	MeasureOnData("convert_sources", config, set, scale, nullptr,
+		      [&](obs_data_t *data) { ConvertSceneCollection(data, mappings, SourceTarget::LinuxX11); });
+
+	const auto fixPaths = [&](obs_data_t *data) {
+		try_fix_paths(data, movedDir.c_str());
+	};
+	size_t exportIndex = 0;
+	MeasureOnData("export_local_files", config, set, scale, fixPaths, [&](obs_data_t *data) {
+		export_local_files(data, work + "export_" + std::to_string(exportIndex++) + "/", "");
+	});
+	MeasureOnData("export_local_files_unchanged", config, set, scale, fixPaths,
+		      [&](obs_data_t *data) { export_local_files(data, work + "export_0/", ""); });
+
+	RemoveDirectoryRecursive(work);
+}
+
+int main(int argc, char **argv)
+{
+	BenchmarkConfig config;
+	if (!ParseOptions(argc, argv, config)) {
+		PrintUsage();
+		return 1;
+	}
+	SourceTypeMappings mappings;
+	if (!mappings.Load(config.mappings.c_str()))
+		fprintf(stderr, "failed to load mappings %s, only text sources are converted\n", config.mappings.c_str());
+
+	/* a directory of its own, so nothing that already was in --work is removed */
+	const std::string parent = config.work;
+	const bool parentExisted = os_file_exists(parent.c_str());
+	for (unsigned run = 0;; run++) {
+		config.work = parent + "/run_" + std::to_string(os_gettime_ns()) + "_" + std::to_string(run);
+		if (!os_file_exists(config.work.c_str()))
+			break;
+	}
+	if (os_mkdirs(config.work.c_str()) == MKDIR_ERROR) {
+		fprintf(stderr, "failed to create %s\n", config.work.c_str());
+		return 1;
+	}
+
+	base_set_log_handler([](int, const char *, va_list, void *) {}, nullptr);
+	for (size_t scale : config.scales) {
+		BenchmarkConfig scaled = config;
+		scaled.collections *= scale;
+		scaled.scenes *= scale;
+		scaled.sources *= scale;
+		scaled.backups *= scale;
+		scaled.parts *= scale;
+		RunBenchmarks(scaled, mappings, scale);
+	}
+	RemoveDirectoryRecursive(config.work);
+	if (!parentExisted)
+		os_rmdir(parent.c_str());
+	return 0;
+}
@@ -0,0 +1,435 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "scene-collection-cleanup.hpp"
+#include "scene-collection-convert.hpp"
+#include "scene-collection-core.hpp"
+#include "scene-collection-diff.hpp"
+#include "scene-collection-export.hpp"
+#include "scene-collection-scan.hpp"
+#include "scene-collection-trace.hpp"
+#include "util/dstr.h"
+#include "util/platform.h"
+
+struct CliOptions {
+	std::string command;
+	std::vector<std::string> paths;
+	std::vector<std::string> mappings;
+	std::string output;
+	std::string backupDir;
+	std::string trace;
+	SourceTarget target = GetCurrentSourceTarget();
+	size_t jobs = 0;
+	int max = 0;
+	bool dryRun = false;
+	bool archive = false;
+	bool verifyHash = false;
+	bool removeUnused = false;
+	bool pool = false;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: scene-collection-manager-cli [options] <command> <paths...>\n"
+	       "\n"
+	       "Commands:\n"
+	       "  import <scenes dir> <file|dir>...    import .json or .zip scene collections into the scenes directory\n"
+	       "  convert <file|dir>...                convert sources for the target platform in place\n"
+	       "  export <file|dir>...                 export collections with their local files to --output\n"
+	       "  fix-paths <media dir> <file|dir>...  point missing files to the media dir in place\n"
+	       "  diff <from file> <to file>           list what changed between two scene collections or backups\n"
+	       "  scan <scenes dir>                    list local files used by the scene collections that are missing\n"
+	       "  backup <scenes dir>                  backup every scene collection\n"
+	       "  prune <scenes dir>                   remove the oldest automatic backups above --max\n"
+	       "  cleanup <scenes dir>                 remove backup directories without a scene collection and leftover files\n"
+	       "\n"
+	       "Options:\n"
+	       "  --jobs N            number of collections processed in parallel (default: number of cores)\n"
+	       "  --target OS         windows, mac, linux or linux-wayland (default: this platform)\n"
+	       "  --mappings FILE     source-mappings.json to load over the shipped mappings, can be repeated, later files\n"
+	       "                      override earlier ones\n"
+	       "  --output DIR        export destination\n"
+	       "  --backup-dir DIR    custom backup directory (default: next to the scene collections)\n"
+	       "  --max N             maximum number of automatic backups to keep\n"
+	       "  --dry-run           only report what convert or cleanup would change\n"
+	       "  --archive           export every collection with its files into one .zip\n"
+	       "  --verify-hash       compare content instead of modification time to find files changed since the last export\n"
+	       "  --remove-unused     remove files of the last export that are no longer referenced\n"
+	       "  --pool              export all collections into --output with one shared media pool\n"
+	       "  --trace FILE        write a timeline of the work as Chrome trace JSON, for chrome://tracing or Perfetto\n");
+}
+
+static bool ParseTarget(const char *name, SourceTarget &target)
+{
+	if (strcmp(name, "windows") == 0)
+		target = SourceTarget::Windows;
+	else if (strcmp(name, "mac") == 0)
+		target = SourceTarget::Mac;
+	else if (strcmp(name, "linux") == 0)
+		target = SourceTarget::LinuxX11;
+	else if (strcmp(name, "linux-wayland") == 0)
+		target = SourceTarget::LinuxWayland;
+	else
+		return false;
+	return true;
+}
+
+static bool ParseOptions(int argc, char **argv, CliOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(arg, "--jobs") == 0 && hasValue) {
+			options.jobs = strtoul(argv[++i], nullptr, 10);
+		} else if (strcmp(arg, "--target") == 0 && hasValue) {
+			if (!ParseTarget(argv[++i], options.target))
+				return false;
+		} else if (strcmp(arg, "--mappings") == 0 && hasValue) {
+			options.mappings.emplace_back(argv[++i]);
+		} else if (strcmp(arg, "--output") == 0 && hasValue) {
+			options.output = argv[++i];
+		} else if (strcmp(arg, "--backup-dir") == 0 && hasValue) {
+			options.backupDir = argv[++i];
+		} else if (strcmp(arg, "--trace") == 0 && hasValue) {
+			options.trace = argv[++i];
+		} else if (strcmp(arg, "--max") == 0 && hasValue) {
+			options.max = atoi(argv[++i]);
+		} else if (strcmp(arg, "--dry-run") == 0) {
+			options.dryRun = true;
+		} else if (strcmp(arg, "--archive") == 0) {
+			options.archive = true;
+		} else if (strcmp(arg, "--verify-hash") == 0) {
+			options.verifyHash = true;
+		} else if (strcmp(arg, "--remove-unused") == 0) {
+			options.removeUnused = true;
+		} else if (strcmp(arg, "--pool") == 0) {
+			options.pool = true;
+		} else if (strncmp(arg, "--", 2) == 0) {
+			return false;
+		} else if (options.command.empty()) {
+			options.command = arg;
+		} else {
+			options.paths.emplace_back(arg);
+		}
+	}
+	return !options.command.empty() && !options.paths.empty();
+}
+
+static std::string WithSlash(std::string dir)
+{
+	if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+		dir += "/";
+	return dir;
+}
+
+/* expands directories to the scene collection files they contain */
+static std::vector<std::string> CollectFiles(const std::vector<std::string> &paths, bool archives)
+{
+	std::vector<std::string> files;
+	for (const auto &path : paths) {
+		os_dir_t *dir = os_opendir(path.c_str());
+		if (!dir) {
+			files.push_back(path);
+			continue;
+		}
+		while (struct os_dirent *ent = os_readdir(dir)) {
+			if (ent->directory)
+				continue;
+			const char *ext = os_get_path_extension(ent->d_name);
+			if (ext && (astrcmpi(ext, ".json") == 0 || (archives && astrcmpi(ext, ".zip") == 0)))
+				files.push_back(WithSlash(path) + ent->d_name);
+		}
+		os_closedir(dir);
+	}
+	return files;
+}
+
+static int Import(const CliOptions &options, const SourceTypeMappings &mappings)
+{
+	const std::string scenesDir = WithSlash(options.paths[0]);
+	const auto files = CollectFiles(std::vector<std::string>(options.paths.begin() + 1, options.paths.end()), true);
+	const std::string mediaDir = scenesDir + IMPORTED_MEDIA_DIR;
+	std::vector<std::vector<obs_data_t *>> loaded(files.size());
+	RunParallel(files.size(), options.jobs,
+		    [&](size_t i) { loaded[i] = LoadImportFile(files[i], mappings, options.target, mediaDir); });
+
+	std::map<std::string, obs_data_t *> saves;
+	int failed = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (loaded[i].empty()) {
+			fprintf(stderr, "failed to import %s\n", files[i].c_str());
+			failed++;
+		}
+		for (obs_data_t *data : loaded[i]) {
+			std::string safeName;
+			if (!GetFileSafeName(obs_data_get_string(data, "name"), safeName)) {
+				obs_data_release(data);
+				continue;
+			}
+			auto &save = saves[scenesDir + safeName + ".json"];
+			obs_data_release(save);
+			save = data;
+		}
+	}
+	std::vector<std::pair<std::string, obs_data_t *>> jobs(saves.begin(), saves.end());
+	std::mutex output;
+	RunParallel(jobs.size(), options.jobs, [&](size_t i) {
+		const bool saved = obs_data_save_json_safe(jobs[i].second, jobs[i].first.c_str(), "tmp", "bak");
+		obs_data_release(jobs[i].second);
+		std::lock_guard<std::mutex> lock(output);
+		printf("%s %s\n", saved ? "imported" : "failed to save", jobs[i].first.c_str());
+		if (!saved)
+			failed++;
+	});
+	return failed ? 2 : 0;
+}
+
+static int Convert(const CliOptions &options, const SourceTypeMappings &mappings)
+{
+	const auto files = CollectFiles(options.paths, false);
+	std::mutex output;
+	int failed = 0;
+	RunParallel(files.size(), options.jobs, [&](size_t i) {
+		obs_data_t *data = obs_data_create_from_json_file_safe(files[i].c_str(), "bak");
+		if (!data) {
+			std::lock_guard<std::mutex> lock(output);
+			fprintf(stderr, "failed to read %s\n", files[i].c_str());
+			failed++;
+			return;
+		}
+		const auto report = ConvertSceneCollection(data, mappings, options.target, options.dryRun);
+		const bool saved = options.dryRun || report.empty() ||
+				   obs_data_save_json_safe(data, files[i].c_str(), "tmp", "bak");
+		obs_data_release(data);
+		std::lock_guard<std::mutex> lock(output);
+		printf("%s: %zu sources%s\n%s", files[i].c_str(), report.size(), options.dryRun ? " would be converted" : " converted",
+		       FormatConversionReport(report).c_str());
+		if (!saved) {
+			fprintf(stderr, "failed to save %s\n", files[i].c_str());
+			failed++;
+		}
+	});
+	return failed ? 2 : 0;
+}
+
+static int Export(const CliOptions &options)
+{
+	if (options.output.empty()) {
+		fprintf(stderr, "export needs --output\n");
+		return 1;
+	}
+	const std::string outputDir = WithSlash(options.output);
+	os_mkdirs(outputDir.c_str());
+	const auto files = CollectFiles(options.paths, false);
+	ExportOptions exportOptions;
+	exportOptions.verify_hash = options.verifyHash;
+	exportOptions.prune = options.removeUnused;
+	if (options.pool) {
+		std::vector<obs_data_t *> collections;
+		for (const auto &file : files) {
+			if (obs_data_t *data = obs_data_create_from_json_file_safe(file.c_str(), "bak"))
+				collections.push_back(data);
+			else
+				fprintf(stderr, "failed to read %s\n", file.c_str());
+		}
+		exportOptions.jobs = options.jobs;
+		const auto stats = ExportSceneCollections(collections, outputDir, exportOptions);
+		for (obs_data_t *data : collections)
+			obs_data_release(data);
+		printf("exported %zu collections with %zu files into %s\n", stats.collections, stats.files, outputDir.c_str());
+		return stats.collections == files.size() && !stats.failed ? 0 : 2;
+	}
+	std::mutex output;
+	int failed = 0;
+	RunParallel(files.size(), options.jobs, [&](size_t i) {
+		bool saved;
+		std::string file;
+		if (options.archive) {
+			obs_data_t *data = obs_data_create_from_json_file_safe(files[i].c_str(), "bak");
+			std::string safeName;
+			if (!data || !GetFileSafeName(obs_data_get_string(data, "name"), safeName)) {
+				obs_data_release(data);
+				std::lock_guard<std::mutex> lock(output);
+				fprintf(stderr, "failed to read %s\n", files[i].c_str());
+				failed++;
+				return;
+			}
+			file = outputDir + safeName + ".zip";
+			saved = ExportSceneCollectionArchive(data, file);
+			obs_data_release(data);
+		} else {
+			/* streamed so the collection is never loaded, it keeps the name of its file */
+			const auto name = GetFilenameFromPath(files[i], false);
+			file = outputDir + name + ".json";
+			saved = ExportSceneCollectionFile(files[i], file, outputDir + name + "/", "", exportOptions).collections == 1;
+		}
+		std::lock_guard<std::mutex> lock(output);
+		printf("%s %s\n", saved ? "exported" : "failed to export", file.c_str());
+		if (!saved)
+			failed++;
+	});
+	return failed ? 2 : 0;
+}
+
+static int FixPaths(const CliOptions &options)
+{
+	const std::string mediaDir = WithSlash(options.paths[0]);
+	const auto files = CollectFiles(std::vector<std::string>(options.paths.begin() + 1, options.paths.end()), false);
+	std::mutex output;
+	int failed = 0;
+	RunParallel(files.size(), options.jobs, [&](size_t i) {
+		bool saved;
+		const auto stats = try_fix_paths_file(files[i], files[i], mediaDir.c_str(), saved);
+		std::lock_guard<std::mutex> lock(output);
+		if (saved) {
+			printf("%s: %zu paths fixed, %zu missing\n", files[i].c_str(), stats.fixed, stats.missing);
+		} else {
+			fprintf(stderr, "failed to fix %s\n", files[i].c_str());
+			failed++;
+		}
+	});
+	return failed ? 2 : 0;
+}
+
+static int Diff(const CliOptions &options)
+{
+	obs_data_t *from = obs_data_create_from_json_file_safe(options.paths[0].c_str(), "bak");
+	obs_data_t *to = obs_data_create_from_json_file_safe(options.paths[1].c_str(), "bak");
+	if (!from || !to) {
+		fprintf(stderr, "failed to read %s\n", (from ? options.paths[1] : options.paths[0]).c_str());
+		obs_data_release(from);
+		obs_data_release(to);
+		return 1;
+	}
+	const auto diff = DiffSceneCollections(from, to);
+	obs_data_release(from);
+	obs_data_release(to);
+	printf("%s%zu differences\n", FormatSceneCollectionDiff(diff).c_str(), diff.changes.size());
+	return diff.changes.empty() ? 0 : 2;
+}
+
+static int Scan(const CliOptions &options)
+{
+	MediaScanner scanner;
+	const auto missing = scanner.Scan(EnumerateSceneCollections(options.paths[0]), options.jobs);
+	for (const auto &media : missing)
+		printf("%s: %s: %s\n", media.collection.c_str(), media.source.c_str(), media.path.c_str());
+	printf("%zu missing files, %zu paths checked in %zu collections\n", missing.size(), scanner.stats.paths,
+	       scanner.stats.collections);
+	return missing.empty() ? 0 : 2;
+}
+
+static int Cleanup(const CliOptions &options)
+{
+	/* OBS is not running, so the temporary scene collection is never in use */
+	const auto orphans = FindOrphans(options.paths[0], options.backupDir, "");
+	uint64_t bytes = 0;
+	for (const auto &orphan : orphans) {
+		printf("%s (%llu bytes)\n", orphan.path.c_str(), (unsigned long long)orphan.bytes);
+		bytes += orphan.bytes;
+	}
+	if (!options.dryRun && !orphans.empty())
+		bytes = RemoveOrphans(orphans, (int64_t)time(nullptr) + 1);
+	printf("%zu orphans, %llu bytes %s\n", orphans.size(), (unsigned long long)bytes,
+	       options.dryRun ? "can be reclaimed" : "reclaimed");
+	return 0;
+}
+
+static int Backup(const CliOptions &options, bool save)
+{
+	const auto collections = EnumerateSceneCollections(options.paths[0]);
+	std::vector<std::string> files;
+	for (const auto &collection : collections)
+		files.push_back(collection.second);
+	const auto backupName = GenerateBackupName();
+	std::mutex output;
+	int failed = 0;
+	RunParallel(files.size(), options.jobs, [&](size_t i) {
+		const auto backupDir = GetBackupDirectory(files[i], options.backupDir);
+		const bool saved = !save || SaveBackup(files[i], backupDir, backupName);
+		const size_t removed = PruneBackups(backupDir, options.max);
+		std::lock_guard<std::mutex> lock(output);
+		if (save)
+			printf("%s %s\n", saved ? "backed up" : "failed to backup", files[i].c_str());
+		if (removed)
+			printf("removed %zu backups of %s\n", removed, files[i].c_str());
+		if (!saved)
+			failed++;
+	});
+	return failed ? 2 : 0;
+}
+
+/* -1 when the command or its paths are not valid */
+static int RunCommand(const CliOptions &options, const SourceTypeMappings &mappings)
+{
+	if (options.command == "import" && options.paths.size() > 1)
+		return Import(options, mappings);
+	if (options.command == "convert")
+		return Convert(options, mappings);
+	if (options.command == "export")
+		return Export(options);
+	if (options.command == "fix-paths" && options.paths.size() > 1)
+		return FixPaths(options);
+	if (options.command == "diff" && options.paths.size() == 2)
+		return Diff(options);
+	if (options.command == "scan")
+		return Scan(options);
+	if (options.command == "backup")
+		return Backup(options, true);
+	if (options.command == "prune")
+		return Backup(options, false);
+	if (options.command == "cleanup")
+		return Cleanup(options);
+	return -1;
+}
+
+/* the shipped mappings, copied next to the executable by the build, or the ones in the source tree */
+static bool LoadDefaultMappings(const char *argv0, SourceTypeMappings &mappings)
+{
+	const std::string executable = argv0;
+	const auto slash = executable.find_last_of("/\\");
+	if (slash != std::string::npos && mappings.Load((executable.substr(0, slash + 1) + "source-mappings.json").c_str()))
+		return true;
+#ifdef SOURCE_MAPPINGS_FILE
+	return mappings.Load(SOURCE_MAPPINGS_FILE);
+#else
+	return false;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	CliOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+	SourceTypeMappings mappings;
+	if (!LoadDefaultMappings(argv[0], mappings))
+		fprintf(stderr, "shipped source mappings not found, only text sources are converted without --mappings\n");
+	for (const auto &file : options.mappings) {
+		if (!mappings.Load(file.c_str())) {
+			fprintf(stderr, "failed to load mappings %s\n", file.c_str());
+			return 1;
+		}
+	}
+
+	if (!options.trace.empty())
+		SetTraceEnabled(true);
+	const int result = RunCommand(options, mappings);
+	if (result < 0) {
+		PrintUsage();
+		return 1;
+	}
+	if (!options.trace.empty() && !WriteTrace(options.trace)) {
+		fprintf(stderr, "failed to write trace %s\n", options.trace.c_str());
+		return 1;
+	}
+	return result;
+}
@@ -1,47 +1,95 @@
 #include "scene-collection-manager.hpp"
 
 #include <qabstractbutton.h>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDateTime>
 #include <QDesktopServices>
+#include <QDialogButtonBox>
 #include <QDir>
 #include <QFileDialog>
+#include <QFormLayout>
+#include <QHeaderView>
 #include <QMenu>
 #include <QMessageBox>
+#include <QPointer>
 #include <QInputDialog>
+#include <QLineEdit>
+#include <QLocale>
 #include <QUrl>
 #include <QSpinBox>
+#include <QThreadPool>
+#include <QTimer>
 #include <QWidgetAction>
-#include <wctype.h>
-#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <set>
 
 #include "obs-frontend-api.h"
 #include "obs-module.h"
 #include "obs.hpp"
 #include "version.h"
+#include "scene-collection-archive.hpp"
+#include "scene-collection-cleanup.hpp"
+#include "scene-collection-convert.hpp"
+#include "scene-collection-core.hpp"
+#include "scene-collection-diff.hpp"
+#include "scene-collection-dispatcher.hpp"
+#include "scene-collection-export.hpp"
+#include "scene-collection-merge.hpp"
+#include "scene-collection-metrics.hpp"
+#include "scene-collection-s3.hpp"
+#include "scene-collection-scan.hpp"
+#include "scene-collection-scheduler.hpp"
+#include "scene-collection-storage.hpp"
+#include "scene-collection-trace.hpp"
+#include "scene-collection-trash.hpp"
 #include "util/config-file.h"
 #include "util/platform.h"
 
-#if !defined(_WIN32) && !defined(__APPLE__)
-#include <obs-nix-platform.h>
-#endif
-
 OBS_DECLARE_MODULE()
 OBS_MODULE_AUTHOR("Exeldro");
 OBS_MODULE_USE_DEFAULT_LOCALE("scene-collection-manager", "en-US")
 
-#define MAX_PATH 260
-
 static obs_hotkey_id sceneCollectionManagerDialog_hotkey_id = OBS_INVALID_HOTKEY_ID;
 static obs_hotkey_id backup_hotkey_id = OBS_INVALID_HOTKEY_ID;
 static obs_hotkey_id load_last_backup_hotkey_id = OBS_INVALID_HOTKEY_ID;
 static obs_hotkey_id load_first_backup_hotkey_id = OBS_INVALID_HOTKEY_ID;
 SceneCollectionManagerDialog *sceneCollectionManagerDialog = nullptr;
 
+/* the settings are only used on the UI thread, hotkeys reach them through the operation dispatcher */
 static bool autoSaveBackup = false;
 static int autoSaveBackupMax = 30;
 static std::string customBackupDir;
+static int trashRetentionDays = 7;
+/* orphaned backups and leftover files are removed automatically after this many days, 0 only reports them */
+static int orphanRetentionDays = 0;
+static bool deferDuringShow = true;
+/* in KB/s, the write rate of backups that still happen while streaming or recording */
+static int backupRateLimit = 1024;
+static BackupScheduler backupScheduler;
+static OperationDispatcher operationDispatcher;
+static SourceTypeMappings sourceTypeMappings;
+/* kept between scans so a rescan only checks what changed, only used by one worker at a time */
+static MediaScanner mediaScanner;
+static std::mutex mediaScannerMutex;
+/* "local" or "s3" */
+static std::string backupStorageType = "local";
+/* replaced when the backup settings change, scheduled jobs keep the storage they were given */
+static std::shared_ptr<BackupStorage> backupStorage;
+static std::mutex backupStorageMutex;
+static Metrics metrics;
+/* in seconds, how often the metrics file is written while metrics are enabled */
+static int metricsInterval = 15;
+static QTimer *metricsTimer = nullptr;
 
 void ShowSceneCollectionManagerDialog()
 {
+	const uint64_t started = metrics.Start();
 	obs_frontend_push_ui_translation(obs_module_get_string);
 	if (sceneCollectionManagerDialog == nullptr)
 		sceneCollectionManagerDialog =
@@ -50,6 +98,52 @@ void ShowSceneCollectionManagerDialog()
 	sceneCollectionManagerDialog->setAttribute(Qt::WA_DeleteOnClose, true);
 	QAction::connect(sceneCollectionManagerDialog, &QDialog::finished, [] { sceneCollectionManagerDialog = nullptr; });
 	obs_frontend_pop_ui_translation();
+	metrics.ObserveSince(MetricHistogram::DialogOpen, started);
+}
+
+/* on the thread pool, or right away when the plugin is about to unload */
+static void WriteMetrics(bool now = false)
+{
+	char *path = obs_module_config_path("metrics.prom");
+	if (!path)
+		return;
+	const std::string file = path;
+	bfree(path);
+	const auto dir = file.substr(0, file.find_last_of("/\\") + 1);
+	const auto write = [dir, file] {
+		/* a write still running on the pool does not overwrite the last one */
+		static std::mutex writeMutex;
+		std::lock_guard<std::mutex> lock(writeMutex);
+		os_mkdirs(dir.c_str());
+		if (!metrics.Write(file))
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to write metrics to %s", file.c_str());
+	};
+	if (now)
+		write();
+	else
+		QThreadPool::globalInstance()->start(write);
+}
+
+/* starts or stops writing the metrics file to follow the setting */
+static void UpdateMetricsTimer()
+{
+	if (!metrics.Enabled()) {
+		if (metricsTimer)
+			metricsTimer->stop();
+		return;
+	}
+	if (!metricsTimer) {
+		metricsTimer = new QTimer(static_cast<QMainWindow *>(obs_frontend_get_main_window()));
+		QObject::connect(metricsTimer, &QTimer::timeout, [] { WriteMetrics(); });
+	}
+	metricsTimer->start(std::max(metricsInterval, 1) * 1000);
+}
+
+static void MetricsProc(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	const auto text = metrics.Enabled() ? metrics.Format() : std::string();
+	calldata_set_string(cd, "metrics", text.c_str());
 }
 
 void SceneCollectionManagerHotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -63,38 +157,98 @@ void SceneCollectionManagerHotkey(void *data, obs_hotkey_id id, obs_hotkey_t *ho
 	ShowSceneCollectionManagerDialog();
 }
 
-bool GetFileSafeName(const char *name, std::string &file)
+static std::shared_ptr<BackupStorage> GetBackupStorage()
 {
-	const size_t base_len = strlen(name);
-	size_t len = os_utf8_to_wcs(name, base_len, nullptr, 0);
-	std::wstring wfile;
+	std::lock_guard<std::mutex> lock(backupStorageMutex);
+	return backupStorage;
+}
 
-	if (!len)
-		return false;
+/* jobs of RunInParallel that have not finished, the module is only unloaded once they are done */
+static std::mutex parallelMutex;
+static std::condition_variable parallelIdle;
+static size_t parallelRunning = 0;
 
-	wfile.resize(len);
-	os_utf8_to_wcs(name, base_len, &wfile[0], len + 1);
+static void RunInParallel(std::vector<std::function<void()>> jobs, std::function<void()> done)
+{
+	if (jobs.empty()) {
+		done();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(parallelMutex);
+		parallelRunning += jobs.size();
+	}
+	auto pending = std::make_shared<std::atomic<size_t>>(jobs.size());
+	const auto main = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+	for (auto &job : jobs) {
+		QThreadPool::globalInstance()->start([job, pending, done, main] {
+			job();
+			if (pending->fetch_sub(1) == 1)
+				QMetaObject::invokeMethod(main, done, Qt::QueuedConnection);
+			std::lock_guard<std::mutex> lock(parallelMutex);
+			parallelRunning--;
+			parallelIdle.notify_all();
+		});
+	}
+}
 
-	for (size_t i = wfile.size(); i > 0; i--) {
-		size_t im1 = i - 1;
+static std::string GetBackupStorageSetting(config_t *config, const char *name)
+{
+	const char *value = config ? config_get_string(config, "SceneCollectionManager", name) : nullptr;
+	return value ? value : "";
+}
 
-		if (iswspace(wfile[im1])) {
-			wfile[im1] = '_';
-		} else if (wfile[im1] != '_' && !iswalnum(wfile[im1])) {
-			wfile.erase(im1, 1);
-		}
+static void SetBackupStorage(std::shared_ptr<BackupStorage> storage)
+{
+	std::shared_ptr<BackupStorage> previous;
+	{
+		std::lock_guard<std::mutex> lock(backupStorageMutex);
+		previous = std::move(backupStorage);
+		backupStorage = std::move(storage);
 	}
+	/* the previous storage finishes its uploads when released, not on the ui thread */
+	if (previous)
+		QThreadPool::globalInstance()->start([previous = std::move(previous)]() mutable { previous.reset(); });
+}
 
-	if (wfile.size() == 0)
-		wfile = L"characters_only";
-
-	len = os_wcs_to_utf8(wfile.c_str(), wfile.size(), nullptr, 0);
-	if (!len)
-		return false;
+/* from any thread, once the backups of filename changed */
+static void RefreshBackupsLater(const std::string &filename)
+{
+	const auto main = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+	QMetaObject::invokeMethod(
+		main,
+		[filename] {
+			if (sceneCollectionManagerDialog)
+				sceneCollectionManagerDialog->RefreshBackups(filename);
+		},
+		Qt::QueuedConnection);
+}
 
-	file.resize(len);
-	os_wcs_to_utf8(wfile.c_str(), wfile.size(), &file[0], len + 1);
-	return true;
+static void CreateBackupStorage()
+{
+	auto local = std::make_shared<LocalBackupStorage>(customBackupDir);
+	if (backupStorageType != "s3") {
+		SetBackupStorage(local);
+		return;
+	}
+	const auto config = obs_frontend_get_user_config();
+	S3Config s3;
+	s3.endpoint = GetBackupStorageSetting(config, "S3Endpoint");
+	s3.bucket = GetBackupStorageSetting(config, "S3Bucket");
+	const auto region = GetBackupStorageSetting(config, "S3Region");
+	if (!region.empty())
+		s3.region = region;
+	s3.accessKey = GetBackupStorageSetting(config, "S3AccessKey");
+	s3.secretKey = GetBackupStorageSetting(config, "S3SecretKey");
+	s3.prefix = GetBackupStorageSetting(config, "S3Prefix");
+	if (!s3.prefix.empty() && s3.prefix.back() != '/')
+		s3.prefix += '/';
+	if (s3.endpoint.empty() || s3.bucket.empty()) {
+		blog(LOG_WARNING, "[Scene Collection Manager] no S3 endpoint or bucket set, backups are stored locally");
+		SetBackupStorage(local);
+		return;
+	}
+	SetBackupStorage(std::make_shared<S3BackupStorage>(s3, local, RefreshBackupsLater));
 }
 
 static std::string _scene_collections_path;
@@ -159,7 +313,24 @@ static std::string SceneCollectionsPath()
 	return _scene_collections_path;
 }
 
-static void BackupSceneCollection()
+/* saves a backup, recording it in the metrics */
+static bool SaveBackupJob(BackupStorage &storage, obs_data_t *data, const std::string &filename, const std::string &name,
+			  IoThrottle *throttle)
+{
+	const uint64_t started = metrics.Start();
+	if (!storage.Save(filename, data, name, throttle))
+		return false;
+	if (started) {
+		metrics.ObserveSince(MetricHistogram::BackupWrite, started);
+		const char *json = obs_data_get_last_json(data);
+		metrics.Add(MetricCounter::Backups, filename);
+		metrics.Add(MetricCounter::BackupBytes, filename, json ? strlen(json) : 0);
+	}
+	return true;
+}
+
+/* urgent when asked for, automatic backups wait until the show is over */
+static void BackupSceneCollection(bool urgent = false)
 {
 	const auto currentSceneCollection = obs_frontend_get_current_scene_collection();
 	if (!currentSceneCollection || strlen(currentSceneCollection) < 1) {
@@ -167,7 +338,10 @@ static void BackupSceneCollection()
 		return;
 	}
 
-	obs_frontend_save();
+	{
+		TraceSpan span("obs_frontend_save");
+		obs_frontend_save();
+	}
 
 	std::string currentSafeName;
 	if (!GetFileSafeName(currentSceneCollection, currentSafeName)) {
@@ -175,83 +349,33 @@ static void BackupSceneCollection()
 		return;
 	}
 	bfree(currentSceneCollection);
-	char *fn = os_generate_formatted_filename("", true, "%CCYY-%MM-%DD %hh:%mm:%ss");
-
-	std::string backupName = fn;
-	bfree(fn);
-	if (backupName[backupName.size() - 1] == '.')
-		backupName.resize(backupName.length() - 1);
-
-	std::string safeName;
-	if (!GetFileSafeName(backupName.c_str(), safeName))
-		return;
 
 	std::string filename = SceneCollectionsPath();
-	std::string backupDir = filename;
-	if (!customBackupDir.empty()) {
-		backupDir = customBackupDir;
-	}
-	if (backupDir.back() != '/' && backupDir.back() != '\\') {
-		backupDir += "/";
-	}
-	backupDir += currentSafeName;
-	backupDir += "/";
-	os_mkdirs(backupDir.c_str());
-
 	filename += currentSafeName;
 	filename += ".json";
 
-	auto *data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
-	obs_data_set_string(data, "name", backupName.c_str());
-	const auto backupFile = backupDir + safeName + ".json";
-	obs_data_save_json(data, backupFile.c_str());
-	obs_data_release(data);
-
-	if (!autoSaveBackupMax)
+	/* the collection is read now so a deferred backup still has the collection as it was when asked for */
+	obs_data_t *data;
+	{
+		TraceSpan span("parse");
+		data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+	}
+	if (!data)
 		return;
-	int file_count = 0;
-	time_t time = 0;
-	do {
-
-		const auto f = backupDir + "*.json";
-		os_glob_t *glob;
-		if (os_glob(f.c_str(), 0, &glob) != 0) {
-			return;
-		}
-		std::string backupFile;
-		time = 0;
-		file_count = 0;
-		for (size_t i = 0; i < glob->gl_pathc; i++) {
-			const char *filePath = glob->gl_pathv[i].path;
-
-			if (glob->gl_pathv[i].directory)
-				continue;
-
-			const char *fn = filePath;
-			const char *slash = strrchr(filePath, '/');
-			const char *backslash = strrchr(filePath, '\\');
-			if (slash && (!backslash || backslash < slash)) {
-				fn = slash + 1;
-			} else if (backslash && (!slash || slash < backslash)) {
-				fn = backslash + 1;
-			}
-			int d, t;
-			if (sscanf(fn, "%d_%d.json", &d, &t) != 2)
-				continue;
-
-			file_count++;
-			struct stat stats{};
-			if (os_stat(filePath, &stats) == 0 && stats.st_size > 0 && (time == 0 || stats.st_ctime <= time)) {
-				backupFile = filePath;
-				time = stats.st_ctime;
-			}
-		}
-		os_globfree(glob);
-		if (time && file_count > autoSaveBackupMax) {
-			if (os_unlink(backupFile.c_str()) != 0)
+	const std::shared_ptr<obs_data_t> snapshot(data, obs_data_release);
+	const auto storage = GetBackupStorage();
+	if (!storage)
+		return;
+	const auto backupName = GenerateBackupName();
+	const int max = autoSaveBackupMax;
+	backupScheduler.Schedule(
+		[storage, snapshot, filename, backupName, max](IoThrottle *throttle) {
+			if (!SaveBackupJob(*storage, snapshot.get(), filename, backupName, throttle))
 				return;
-		}
-	} while (time && file_count > autoSaveBackupMax);
+			metrics.Add(MetricCounter::RetentionDeletions, filename, storage->Prune(filename, max));
+			RefreshBackupsLater(filename);
+		},
+		urgent, filename);
 }
 
 void BackupSceneCollectionHotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -262,42 +386,46 @@ void BackupSceneCollectionHotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hot
 	if (!pressed)
 		return;
 
-	BackupSceneCollection();
+	operationDispatcher.Dispatch("backup", [] { BackupSceneCollection(true); });
 }
 
-std::string GetFilenameFromPath(std::string path, bool with_extension)
+static std::string GetBackupDirectory(const std::string &filename)
 {
-	const auto slash = path.find_last_of("/\\");
-	if (slash != std::string::npos) {
-		path = path.substr(slash + 1);
-	}
-	if (!with_extension) {
-		const auto point = path.find_last_of('.');
-		if (point != std::string::npos) {
-			path = path.substr(0, point);
-		}
-	}
-	return path;
+	return GetBackupDirectory(filename, customBackupDir);
 }
 
-std::string GetBackupDirectory(std::string filename)
+/* keep is the last removal, so it can still be undone with a retention of 0 days until the next purge */
+static void PurgeTrashInBackground(const std::vector<TrashEntry> &keep = {})
 {
-	if (customBackupDir.empty()) {
-		auto l = filename.length();
-		if (filename.compare(l - 5, 5, ".json") == 0) {
-			filename.resize(l - 5);
-			filename.append("/");
-		}
-		return filename;
-	}
-	filename = GetFilenameFromPath(filename, false);
-	std::string dir = customBackupDir;
+	const auto trashDir = GetTrashDirectory(SceneCollectionsPath());
+	const int64_t retention = (int64_t)trashRetentionDays * 24 * 60 * 60;
+	std::vector<std::string> keepPaths;
+	for (const auto &entry : keep)
+		keepPaths.push_back(entry.path);
+	backupScheduler.Schedule([trashDir, retention, keepPaths](IoThrottle *) { PurgeTrash(trashDir, retention, keepPaths); });
+}
+
+static std::string CurrentSceneCollectionFile()
+{
+	const auto config = obs_frontend_get_user_config();
+	const char *filename = config ? config_get_string(config, "Basic", "SceneCollectionFile") : nullptr;
+	if (!filename)
+		return "";
+	return SceneCollectionsPath() + filename + ".json";
+}
 
-	if (dir.back() != '/' && dir.back() != '\\')
-		dir += "/";
-	dir += filename;
-	dir += "/";
-	return dir;
+static void RemoveOrphansInBackground()
+{
+	if (orphanRetentionDays <= 0)
+		return;
+	const auto scenesDir = SceneCollectionsPath();
+	const auto current = CurrentSceneCollectionFile();
+	const int64_t before = (int64_t)time(nullptr) - (int64_t)orphanRetentionDays * 24 * 60 * 60;
+	/* a custom backup directory can be shared with other instances whose collections are not here, so it is only
+	 * cleaned up by hand */
+	backupScheduler.Schedule([scenesDir, current, before](IoThrottle *) {
+		RemoveOrphans(FindOrphans(scenesDir, "", current), before);
+	});
 }
 
 bool activate_dshow_proc(void *p, obs_source_t *source)
@@ -321,19 +449,19 @@ bool activate_dshow_proc(void *p, obs_source_t *source)
 
 void activate_dshow(bool active)
 {
+	TraceSpan span("activate_dshow");
 	obs_enum_sources(activate_dshow_proc, &active);
 }
 
-void LoadBackupSceneCollection(const std::string sceneCollection, const std::string filename, const std::string backupFile)
+static void SetCurrentSceneCollection(const char *sceneCollection)
 {
-	if (!filename.length())
-		return;
+	TraceSpan span("obs_frontend_set_current_scene_collection");
+	obs_frontend_set_current_scene_collection(sceneCollection);
+}
 
-	const auto backupDir = GetBackupDirectory(filename);
-	auto *data = obs_data_create_from_json_file(backupFile.c_str());
-	obs_data_set_string(data, "name", sceneCollection.c_str());
-	obs_data_save_json_safe(data, filename.c_str(), "tmp", "bak");
-	obs_data_release(data);
+/* switches to the scene collection, the current one is loaded again from its file */
+static void OpenSceneCollection(const std::string &sceneCollection)
+{
 	activate_dshow(false);
 	if (strcmp(obs_frontend_get_current_scene_collection(), sceneCollection.c_str()) == 0) {
 		const auto obs_config = obs_frontend_get_user_config();
@@ -341,58 +469,87 @@ void LoadBackupSceneCollection(const std::string sceneCollection, const std::str
 			config_set_string(obs_config, "Basic", "SceneCollection", "Scene Collection Manager Temp");
 			config_set_string(obs_config, "Basic", "SceneCollectionFile", "scene_collection_manager_temp");
 		}
-		obs_frontend_set_current_scene_collection(sceneCollection.c_str());
+		SetCurrentSceneCollection(sceneCollection.c_str());
 		std::string path = SceneCollectionsPath() + "scene_collection_manager_temp.json";
 		os_unlink(path.c_str());
 	} else {
-		obs_frontend_set_current_scene_collection(sceneCollection.c_str());
+		SetCurrentSceneCollection(sceneCollection.c_str());
 	}
 	activate_dshow(true);
 }
 
-void LoadBackupSceneCollection(bool last)
+/* writes the backup over the collection and opens it, on the ui thread so nothing saves the collection in between */
+static void OpenBackup(const std::string &sceneCollection, const std::string &filename, obs_data_t *data)
+{
+	obs_data_set_string(data, "name", sceneCollection.c_str());
+	{
+		TraceSpan span("save");
+		obs_data_save_json_safe(data, filename.c_str(), "tmp", "bak");
+	}
+	OpenSceneCollection(sceneCollection);
+}
+
+/* the backup is read on the thread pool once the backups still being written or pruned are done, a remote storage can
+ * take a while, done is called on the ui thread */
+static void LoadBackupSceneCollection(const std::string &sceneCollection, const std::string &filename,
+				      const std::string &backupName, std::function<void()> done)
+{
+	const auto storage = GetBackupStorage();
+	if (!filename.length() || !storage) {
+		done();
+		return;
+	}
+	auto data = std::make_shared<std::shared_ptr<obs_data_t>>();
+	backupScheduler.WhenDone(filename, [storage, sceneCollection, filename, backupName, data, done] {
+		RunInParallel({[storage, filename, backupName, data] {
+				      TraceSpan span("parse");
+				      data->reset(storage->Load(filename, backupName), obs_data_release);
+			      }},
+			      [sceneCollection, filename, data, done] {
+				      if (*data)
+					      OpenBackup(sceneCollection, filename, data->get());
+				      done();
+			      });
+	});
+}
+
+static void LoadBackupSceneCollection(bool last, std::function<void()> done)
 {
 	const auto config = obs_frontend_get_user_config();
-	if (!config)
+	const auto storage = GetBackupStorage();
+	if (!config || !storage) {
+		done();
 		return;
+	}
 	const std::string sceneCollection = config_get_string(config, "Basic", "SceneCollection");
 	const std::string filename = config_get_string(config, "Basic", "SceneCollectionFile");
 	std::string path = SceneCollectionsPath();
 	path += filename;
 	path += ".json";
 
-	const auto backupDir = GetBackupDirectory(path);
-	const auto f = backupDir + "*.json";
-	os_glob_t *glob;
-	if (os_glob(f.c_str(), 0, &glob) != 0) {
-		return;
-	}
-	std::string backupFile;
-	time_t time = 0;
-	for (size_t i = 0; i < glob->gl_pathc; i++) {
-		const char *filePath = glob->gl_pathv[i].path;
-
-		if (glob->gl_pathv[i].directory)
-			continue;
-
-		struct stat stats{};
-		if (os_stat(filePath, &stats) == 0 && stats.st_size > 0) {
-			if (last) {
-				if (time == 0 || stats.st_ctime >= time) {
-					backupFile = filePath;
-					time = stats.st_ctime;
-				}
-			} else {
-				if (time == 0 || stats.st_ctime <= time) {
-					backupFile = filePath;
-					time = stats.st_ctime;
-				}
-			}
-		}
-	}
-	os_globfree(glob);
-	if (time != 0)
-		LoadBackupSceneCollection(sceneCollection, path, backupFile);
+	/* the newest backup is only known once the backup being written is done, and pruning may remove the oldest */
+	auto data = std::make_shared<std::shared_ptr<obs_data_t>>();
+	backupScheduler.WhenDone(path, [storage, sceneCollection, path, last, data, done] {
+		RunInParallel({[storage, sceneCollection, path, last, data] {
+				      /* restoring from a partial list would pick the wrong backup */
+				      if (!storage->Listed(path)) {
+					      blog(LOG_WARNING,
+						   "[Scene Collection Manager] the backups of '%s' are not read yet, try again shortly",
+						   sceneCollection.c_str());
+					      return;
+				      }
+				      BackupFile backup;
+				      if (!GetEdgeBackup(*storage, path, last, backup))
+					      return;
+				      TraceSpan span("parse");
+				      data->reset(storage->Load(path, backup.name), obs_data_release);
+			      }},
+			      [sceneCollection, path, data, done] {
+				      if (*data)
+					      OpenBackup(sceneCollection, path, data->get());
+				      done();
+			      });
+	});
 }
 
 void LoadLastBackupSceneCollectionHotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -402,8 +559,13 @@ void LoadLastBackupSceneCollectionHotkey(void *data, obs_hotkey_id id, obs_hotke
 	UNUSED_PARAMETER(hotkey);
 	if (!pressed)
 		return;
-	const auto main = static_cast<QMainWindow *>(obs_frontend_get_main_window());
-	QMetaObject::invokeMethod(main, [] { LoadBackupSceneCollection(true); }, Qt::QueuedConnection);
+	const uint64_t started = metrics.Start();
+	operationDispatcher.DispatchAsync("load last backup", [started](std::function<void()> finished) {
+		LoadBackupSceneCollection(true, [started, finished] {
+			metrics.ObserveSince(MetricHistogram::Switch, started);
+			finished();
+		});
+	});
 }
 
 void LoadFirstBackupSceneCollectionHotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -413,13 +575,33 @@ void LoadFirstBackupSceneCollectionHotkey(void *data, obs_hotkey_id id, obs_hotk
 	UNUSED_PARAMETER(hotkey);
 	if (!pressed)
 		return;
-	const auto main = static_cast<QMainWindow *>(obs_frontend_get_main_window());
-	QMetaObject::invokeMethod(main, [] { LoadBackupSceneCollection(false); }, Qt::QueuedConnection);
+	const uint64_t started = metrics.Start();
+	operationDispatcher.DispatchAsync("load first backup", [started](std::function<void()> finished) {
+		LoadBackupSceneCollection(false, [started, finished] {
+			metrics.ObserveSince(MetricHistogram::Switch, started);
+			finished();
+		});
+	});
 }
 
 static void frontend_event(obs_frontend_event event, void *)
 {
 	if (event == OBS_FRONTEND_EVENT_EXIT) {
+		operationDispatcher.Clear();
+		backupScheduler.Flush();
+		backupScheduler.Shutdown();
+		if (metricsTimer) {
+			metricsTimer->stop();
+			if (metrics.Enabled())
+				WriteMetrics(true);
+		}
+		std::shared_ptr<BackupStorage> storage;
+		{
+			std::lock_guard<std::mutex> lock(backupStorageMutex);
+			storage = std::move(backupStorage);
+		}
+		/* waits for the uploads that are still running */
+		storage.reset();
 		const auto save_data = obs_data_create();
 		obs_data_array_t *hotkey_save_array = obs_hotkey_save(sceneCollectionManagerDialog_hotkey_id);
 		obs_data_set_array(save_data, "sceneCollectionManagerHotkey", hotkey_save_array);
@@ -441,6 +623,14 @@ static void frontend_event(obs_frontend_event event, void *)
 		obs_data_release(save_data);
 	} else if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED) {
 		activate_dshow(true);
+	} else if (event == OBS_FRONTEND_EVENT_FINISHED_LOADING) {
+		PurgeTrashInBackground();
+		RemoveOrphansInBackground();
+	} else if (event == OBS_FRONTEND_EVENT_SCENE_CHANGED) {
+		backupScheduler.TransitionStarted(obs_frontend_get_transition_duration());
+	} else if (event == OBS_FRONTEND_EVENT_STREAMING_STOPPED || event == OBS_FRONTEND_EVENT_RECORDING_STOPPED ||
+		   event == OBS_FRONTEND_EVENT_TRANSITION_STOPPED) {
+		backupScheduler.Poll();
 	}
 }
 
@@ -448,7 +638,7 @@ static void frontend_save_load(obs_data_t *, bool saving, void *)
 {
 	if (!saving) {
 		if (autoSaveBackup)
-			BackupSceneCollection();
+			operationDispatcher.Dispatch("automatic backup", [] { BackupSceneCollection(); });
 		activate_dshow(true);
 	}
 }
@@ -472,12 +662,38 @@ bool obs_module_load()
 								   obs_module_text("LoadFirstBackupSceneCollection"),
 								   LoadFirstBackupSceneCollectionHotkey, nullptr);
 
+	char *mappings = obs_module_file("source-mappings.json");
+	sourceTypeMappings.Load(mappings);
+	bfree(mappings);
+	mappings = obs_module_config_path("source-mappings.json");
+	sourceTypeMappings.Load(mappings);
+	bfree(mappings);
+
 	const auto config = obs_frontend_get_user_config();
 	autoSaveBackup = config ? config_get_bool(config, "SceneCollectionManager", "AutoSaveBackup") : false;
 	autoSaveBackupMax = config ? (int)config_get_int(config, "SceneCollectionManager", "AutoSaveBackupMax") : 30;
 	auto *d = config ? config_get_string(config, "SceneCollectionManager", "BackupDir") : nullptr;
 	if (d)
 		customBackupDir = d;
+	if (config && config_has_user_value(config, "SceneCollectionManager", "TrashRetentionDays"))
+		trashRetentionDays = (int)config_get_int(config, "SceneCollectionManager", "TrashRetentionDays");
+	if (config)
+		orphanRetentionDays = (int)config_get_int(config, "SceneCollectionManager", "OrphanRetentionDays");
+	if (config && config_has_user_value(config, "SceneCollectionManager", "DeferDuringShow"))
+		deferDuringShow = config_get_bool(config, "SceneCollectionManager", "DeferDuringShow");
+	if (config && config_has_user_value(config, "SceneCollectionManager", "BackupRateLimit"))
+		backupRateLimit = (int)config_get_int(config, "SceneCollectionManager", "BackupRateLimit");
+	backupScheduler.SetDeferDuringShow(deferDuringShow);
+	backupScheduler.SetRateLimit((uint64_t)backupRateLimit * 1024);
+	metrics.SetEnabled(config && config_get_bool(config, "SceneCollectionManager", "Metrics"));
+	if (config && config_has_user_value(config, "SceneCollectionManager", "MetricsInterval"))
+		metricsInterval = (int)config_get_int(config, "SceneCollectionManager", "MetricsInterval");
+	UpdateMetricsTimer();
+	proc_handler_add(obs_get_proc_handler(), "void scene_collection_manager_metrics(out string metrics)", MetricsProc, nullptr);
+	backupStorageType = GetBackupStorageSetting(config, "BackupStorage");
+	if (backupStorageType.empty())
+		backupStorageType = "local";
+	CreateBackupStorage();
 	const auto *data = config ? config_get_string(config, "SceneCollectionManager", "HotkeyData") : nullptr;
 	if (data) {
 		QByteArray dataBytes = QByteArray::fromBase64(QByteArray(data));
@@ -517,6 +733,8 @@ void obs_module_unload()
 	obs_hotkey_unregister(backup_hotkey_id);
 	obs_hotkey_unregister(load_first_backup_hotkey_id);
 	obs_hotkey_unregister(load_last_backup_hotkey_id);
+	std::unique_lock<std::mutex> lock(parallelMutex);
+	parallelIdle.wait(lock, [] { return parallelRunning == 0; });
 }
 
 MODULE_EXPORT const char *obs_module_description(void)
@@ -571,583 +789,149 @@ void SceneCollectionManagerDialog::on_actionAddNewSceneCollection_triggered()
 	obs_frontend_add_scene_collection("");
 }
 
-void SceneCollectionManagerDialog::on_actionImportSceneCollection_triggered()
-{
-	auto files = QFileDialog::getOpenFileNames(this, obs_module_text("ImportSceneCollection"), "", "Scene Collection (*.json)");
-	if (files.isEmpty())
-		return;
-	char path_buffer[MAX_PATH];
-	auto scene_collections_ = scene_collections;
-	for (auto file : files) {
-
-		auto fu = file.toUtf8();
-
-		auto data = obs_data_create_from_json_file(fu.constData());
-		if (!data)
-			continue;
-
-		auto name = obs_data_get_string(data, "name");
-		auto n = QString::fromUtf8(name);
+struct ImportedSceneCollection {
+	obs_data_t *data = nullptr;
+	std::string name;
+	std::string path;
+};
 
-		bool replace_current = false;
-		if (scene_collections_.count(n) > 0) {
-			//TODO ask if replace
-			auto sc = obs_frontend_get_current_scene_collection();
-			if (strcmp(sc, name) == 0) {
-				replace_current = true;
-			} else {
-			}
-		} else {
-			if (!obs_frontend_add_scene_collection(name)) {
-				obs_data_release(data);
-				continue;
-			}
-			replace_current = true;
-		}
+static void LoadImport(const std::string &file, std::vector<ImportedSceneCollection> &imports)
+{
+	const auto mediaDir = SceneCollectionsPath() + IMPORTED_MEDIA_DIR;
+	for (obs_data_t *data : LoadImportFile(file, sourceTypeMappings, GetCurrentSourceTarget(), mediaDir)) {
+		const char *name = obs_data_get_string(data, "name");
 		std::string safeName;
 		if (!GetFileSafeName(name, safeName)) {
 			obs_data_release(data);
 			continue;
 		}
-		std::string dir = fu.constData();
-		std::size_t slash = dir.find_last_of("/\\");
-		if (slash != std::string::npos) {
-			auto point = dir.find_last_of('.');
-			if (point != std::string::npos && point > slash) {
-				dir = dir.substr(0, point);
-				dir += "/";
-				try_fix_paths(data, dir.c_str(), path_buffer);
-			}
-			dir = dir.substr(0, slash + 1);
-		}
-		import_parts(data, dir.c_str());
-		try_fix_paths(data, dir.c_str(), path_buffer);
-		replace_os_specific(data);
-
 		std::string path = SceneCollectionsPath();
 		path += safeName;
 		path += ".json";
 		auto path_abs = os_get_abs_path_ptr(path.c_str());
 		if (path_abs) {
-			obs_data_save_json_safe(data, path_abs, "tmp", "bak");
+			path = path_abs;
 			bfree(path_abs);
-		} else {
-			obs_data_save_json_safe(data, path.c_str(), "tmp", "bak");
 		}
-
-		if (replace_current) {
-			const auto config = obs_frontend_get_user_config();
-			if (config) {
-				config_set_string(config, "Basic", "SceneCollection", "Scene Collection Manager Temp");
-				config_set_string(config, "Basic", "SceneCollectionFile", "scene_collection_manager_temp");
-			}
-			obs_frontend_set_current_scene_collection(name);
-			std::string tempPath = ""; //path;
-			tempPath += "scene_collection_manager_temp.json";
-			os_unlink(tempPath.c_str());
-		}
-		obs_data_release(data);
-		BackupSceneCollection();
+		imports.push_back({data, name, path});
 	}
 }
 
-static bool replace(std::string &str, const char *from, const char *to)
+static bool IsCurrentSceneCollection(const std::string &sceneCollection)
 {
-	size_t start_pos = str.find(from);
-	if (start_pos == std::string::npos)
-		return false;
-	str.replace(start_pos, strlen(from), to);
-	return true;
+	char *current = obs_frontend_get_current_scene_collection();
+	const bool same = current && sceneCollection == current;
+	bfree(current);
+	return same;
 }
 
-void SceneCollectionManagerDialog::import_parts(obs_data_t *data, const char *dir)
+/* the one switch of an import. A collection written next to the others is not always listed by OBS yet, it is then
+ * added through the frontend, which opens it blank, and written again before it is opened */
+static void OpenImport(const std::string &sceneCollection, const std::string &path, obs_data_t *data)
 {
-	obs_data_array_t *a = obs_data_get_array(data, "imports");
-	if (!a)
-		return;
-	size_t count = obs_data_array_count(a);
-	for (size_t i = 0; i < count; i++) {
-		obs_data_t *item = obs_data_array_item(a, i);
-		if (!item)
-			continue;
-		const char *file = obs_data_get_string(item, "file");
-		obs_data_t *file_data = nullptr;
-		if (!file || !strlen(file)) {
-			obs_data_release(item);
-			continue;
-		}
-		if (os_file_exists(file)) {
-			file_data = obs_data_create_from_json_file(file);
-		}
-		if (!file_data) {
-			std::string newFile = dir;
-			newFile += file;
-			if (os_file_exists(newFile.c_str())) {
-				file_data = obs_data_create_from_json_file(newFile.c_str());
-			}
-		}
-		if (!file_data) {
-			obs_data_release(item);
-			continue;
-		}
-		obs_data_item_t *item2 = obs_data_first(file_data);
-		while (item2) {
-			if (obs_data_item_gettype(item2) != OBS_DATA_ARRAY) {
-				obs_data_item_next(&item2);
-				continue;
-			}
-			obs_data_array_t *fa = obs_data_item_get_array(item2);
-			obs_data_array_t *da = obs_data_get_array(data, obs_data_item_get_name(item2));
-			if (!da) {
-				da = obs_data_array_create();
-				obs_data_set_array(data, obs_data_item_get_name(item2), da);
-			}
-			size_t c = obs_data_array_count(fa);
-			for (size_t j = 0; j < c; j++) {
-				obs_data_t *fi = obs_data_array_item(fa, j);
-				if (!fi)
-					continue;
-				const char *name = obs_data_get_string(fi, "name");
-				if (!name || !strlen(name)) {
-					obs_data_release(fi);
-					continue;
-				}
-				bool found = false;
-				size_t c2 = obs_data_array_count(da);
-				for (size_t k = 0; k < c2; k++) {
-					obs_data_t *di = obs_data_array_item(da, k);
-					if (!di)
-						continue;
-					if (strcmp(obs_data_get_string(di, "name"), name) == 0) {
-						obs_data_array_erase(da, k);
-						obs_data_array_insert(da, k, fi);
-						found = true;
-						break;
-					}
-
-					obs_data_release(di);
-				}
-				if (!found) {
-					obs_data_array_push_back(da, fi);
-				}
-				obs_data_release(fi);
-			}
-			obs_data_item_next(&item2);
+	if (IsCurrentSceneCollection(sceneCollection)) {
+		TraceSpan span("save");
+		obs_data_save_json_safe(data, path.c_str(), "tmp", "bak");
+	}
+	OpenSceneCollection(sceneCollection);
+	if (!IsCurrentSceneCollection(sceneCollection)) {
+		os_unlink(path.c_str());
+		if (!obs_frontend_add_scene_collection(sceneCollection.c_str()))
+			return;
+		{
+			TraceSpan span("save");
+			obs_data_save_json_safe(data, path.c_str(), "tmp", "bak");
 		}
-		obs_data_release(file_data);
-		obs_data_release(item);
+		OpenSceneCollection(sceneCollection);
 	}
+	/* an automatic backup already follows the load */
+	if (!autoSaveBackup)
+		BackupSceneCollection();
 }
 
-void SceneCollectionManagerDialog::try_fix_paths(obs_data_t *data, const char *dir, char *path_buffer)
+static void SaveImports(std::shared_ptr<std::vector<std::vector<ImportedSceneCollection>>> imports, uint64_t started)
 {
-	obs_data_item_t *item = obs_data_first(data);
-	while (item) {
-		const enum obs_data_type type = obs_data_item_gettype(item);
-		if (type == OBS_DATA_STRING) {
-			std::string str = obs_data_item_get_string(item);
-			bool edit = false;
-			if (replace(str, "[U_COMBOBULATOR_PATH]", dir)) {
-				obs_data_item_set_string(&item, str.c_str());
-				edit = true;
-			}
-			bool local_url = false;
-			if (str.substr(0, 7) == "file://") {
-				str = str.substr(7);
-				local_url = true;
-			}
-			std::size_t found = str.find_last_of("/\\");
-			if (str.length() < MAX_PATH && found != std::string::npos && !os_file_exists(str.c_str())) {
-				while (found != std::string::npos) {
-					auto file = found == 0 && str[0] != '/' && str[0] != '\\' ? str : str.substr(found + 1);
-					if (file.find('.') == std::string::npos)
-						break;
-					auto oldDir = str.substr(0, found + 1);
-					std::string newFile = dir;
-					newFile += file;
-					if (os_file_exists(newFile.c_str())) {
-						if (local_url) {
-							str = "file://";
-							if (os_get_abs_path(newFile.c_str(), path_buffer, MAX_PATH)) {
-								for (auto i = 0; path_buffer[i] != '\0'; i++)
-									if (path_buffer[i] == '\\')
-										path_buffer[i] = '/';
-								str += path_buffer;
-							}
-						} else {
-							if (os_get_abs_path(newFile.c_str(), path_buffer, MAX_PATH)) {
-								for (auto i = 0; path_buffer[i] != '\0'; i++)
-									if (path_buffer[i] == '\\')
-										path_buffer[i] = '/';
-								str = path_buffer;
-							} else {
-								str = "";
-							}
-						}
-						obs_data_item_set_string(&item, str.c_str());
-						edit = true;
-						break;
-					}
-					if (found == 0) {
-						found = std::string::npos;
-					} else {
-						found = str.find_last_of("/\\", found - 1);
-						if (found == std::string::npos) {
-							found = 0;
-						}
-					}
-				}
-			}
-			if (edit) {
-				item = obs_data_first(data);
+	char *csc = obs_frontend_get_current_scene_collection();
+	const std::string current = csc ? csc : "";
+	bfree(csc);
+
+	std::set<std::string> existing;
+	char **names = obs_frontend_get_scene_collections();
+	for (char **name = names; name && *name; name++)
+		existing.emplace(*name);
+	bfree(names);
+
+	/* the collections are written next to the others without opening them, the last one is switched to */
+	std::map<std::string, ImportedSceneCollection *> saves;
+	ImportedSceneCollection *target = nullptr;
+	for (auto &file : *imports) {
+		for (auto &imported : file) {
+			if (!imported.data)
+				continue;
+			auto &save = saves[imported.path];
+			const bool replaced = save && save->name == imported.name;
+			//TODO ask if replace
+			if ((existing.count(imported.name) && imported.name != current && !replaced) ||
+			    (!save && !existing.count(imported.name) && os_file_exists(imported.path.c_str()))) {
+				obs_data_release(imported.data);
+				imported.data = nullptr;
 				continue;
 			}
-		} else if (type == OBS_DATA_OBJECT) {
-			if (obs_data_t *obj = obs_data_item_get_obj(item)) {
-				try_fix_paths(obj, dir, path_buffer);
-				obs_data_release(obj);
-			}
-		} else if (type == OBS_DATA_ARRAY) {
-			const auto array = obs_data_item_get_array(item);
-			const auto count = obs_data_array_count(array);
-			for (size_t i = 0; i < count; i++) {
-				if (obs_data_t *obj = obs_data_array_item(array, i)) {
-					try_fix_paths(obj, dir, path_buffer);
-					obs_data_release(obj);
-				}
+			if (save) {
+				obs_data_release(save->data);
+				save->data = nullptr;
 			}
+			save = &imported;
+			target = &imported;
 		}
-		obs_data_item_next(&item);
 	}
-}
 
-bool SceneCollectionManagerDialog::replace_source(obs_data_t *s, const char *id, const char *find, const char *replace, bool cs)
-{
-	if (strcmp(id, find) != 0)
-		return false;
-	obs_data_set_string(s, "id", replace);
-	const char *vid = obs_get_latest_input_type_id(replace);
-	obs_data_set_string(s, "versioned_id", vid ? vid : id);
-	if (cs) {
-		obs_data_t *c = obs_data_create();
-		obs_data_set_obj(s, "settings", c);
-		obs_data_release(c);
+	/* the open collection is only written right before it is opened again, so OBS does not save over it */
+	std::vector<std::function<void()>> jobs;
+	for (auto &save : saves) {
+		auto &imported = *save.second;
+		if (!imported.data || (&imported == target && imported.name == current))
+			continue;
+		const bool keep = &imported == target;
+		jobs.emplace_back([&imported, keep] {
+			TraceSpan span("save");
+			obs_data_save_json_safe(imported.data, imported.path.c_str(), "tmp", "bak");
+			if (keep)
+				return;
+			obs_data_release(imported.data);
+			imported.data = nullptr;
+		});
 	}
 
-	return true;
-}
-
-void SceneCollectionManagerDialog::make_source_mac(obs_data_t *s)
-{
-	char *id = bstrdup(obs_data_get_string(s, "id"));
-	replace_source(s, id, "game_capture", "syphon-input");
-	replace_source(s, id, "window_capture", "screen_capture");
-	replace_source(s, id, "monitor_capture", "screen_capture");
-	replace_source(s, id, "wasapi_input_capture", "coreaudio_input_capture");
-	replace_source(s, id, "wasapi_output_capture", "sck_audio_capture");
-	replace_source(s, id, "pulse_input_capture", "coreaudio_input_capture");
-	replace_source(s, id, "pulse_output_capture", "sck_audio_capture");
-	replace_source(s, id, "jack_output_capture", "sck_audio_capture");
-	replace_source(s, id, "alsa_input_capture", "coreaudio_input_capture");
-	replace_source(s, id, "dshow_input", "macos-avcapture");
-	replace_source(s, id, "v4l2_input", "macos-avcapture");
-	replace_source(s, id, "xcomposite_input", "screen_capture");
-	replace_source(s, id, "xshm_input", "monitor_capture", false);
-	bfree(id);
-}
-void SceneCollectionManagerDialog::make_source_windows(obs_data_t *s)
-{
-	char *id = bstrdup(obs_data_get_string(s, "id"));
-	replace_source(s, id, "syphon-input", "game_capture");
-	replace_source(s, id, "screen_capture", "monitor_capture");
-	replace_source(s, id, "coreaudio_input_capture", "wasapi_input_capture");
-	replace_source(s, id, "coreaudio_output_capture", "wasapi_output_capture");
-	replace_source(s, id, "sck_audio_capture", "wasapi_output_capture");
-	replace_source(s, id, "pulse_input_capture", "wasapi_input_capture");
-	replace_source(s, id, "pulse_output_capture", "wasapi_output_capture");
-	replace_source(s, id, "jack_output_capture", "wasapi_output_capture");
-	replace_source(s, id, "alsa_input_capture", "wasapi_input_capture");
-	replace_source(s, id, "av_capture_input", "dshow_input");
-	replace_source(s, id, "macos-avcapture", "dshow_input");
-	replace_source(s, id, "v4l2_input", "dshow_input");
-	replace_source(s, id, "xcomposite_input", "window_capture");
-	bfree(id);
-}
-void SceneCollectionManagerDialog::make_source_linux(obs_data_t *s)
-{
-	char *id = bstrdup(obs_data_get_string(s, "id"));
-	replace_source(s, id, "coreaudio_input_capture", "pulse_input_capture");
-	replace_source(s, id, "coreaudio_output_capture", "pulse_output_capture");
-	replace_source(s, id, "sck_audio_capture", "pulse_output_capture");
-	replace_source(s, id, "wasapi_input_capture", "pulse_input_capture");
-	replace_source(s, id, "wasapi_output_capture", "pulse_output_capture");
-	replace_source(s, id, "av_capture_input", "v4l2_input");
-	replace_source(s, id, "macos-avcapture", "v4l2_input");
-	replace_source(s, id, "dshow_input", "v4l2_input");
-#if !defined(_WIN32) && !defined(__APPLE__)
-	if (obs_get_nix_platform() == OBS_NIX_PLATFORM_X11_EGL) {
-		replace_source(s, id, "screen_capture", "xcomposite_input");
-		replace_source(s, id, "monitor_capture", "xcomposite_input");
-		replace_source(s, id, "window_capture", "xcomposite_input");
-		replace_source(s, id, "game_capture", "xcomposite_input");
-	} else {
-		replace_source(s, id, "screen_capture", "pipewire-screen-capture-source");
-		replace_source(s, id, "monitor_capture", "pipewire-screen-capture-source");
-		replace_source(s, id, "window_capture", "pipewire-screen-capture-source");
-		replace_source(s, id, "game_capture", "pipewire-screen-capture-source");
-	}
-#endif
-	bfree(id);
+	RunInParallel(jobs, [imports, target, started] {
+		metrics.ObserveSince(MetricHistogram::Import, started);
+		if (!target)
+			return;
+		const std::shared_ptr<obs_data_t> data(target->data, obs_data_release);
+		target->data = nullptr;
+		const std::string sceneCollection = target->name;
+		const std::string path = target->path;
+		/* in line with the other switches, a restore queued before does not run on the imported collection */
+		operationDispatcher.Dispatch("switch to " + sceneCollection,
+					     [sceneCollection, path, data] { OpenImport(sceneCollection, path, data.get()); });
+	});
 }
 
-void SceneCollectionManagerDialog::replace_gdi_sceneitem_transform(obs_data_t *item,
-								   std::map<std::string, obs_data_t *> gdi_sources)
+void SceneCollectionManagerDialog::on_actionImportSceneCollection_triggered()
 {
-	const char *name = obs_data_get_string(item, "name");
-	auto gdi = gdi_sources.find(name);
-	if (gdi == gdi_sources.end())
+	auto files = QFileDialog::getOpenFileNames(this, obs_module_text("ImportSceneCollection"), "",
+						   "Scene Collection (*.json *.zip)");
+	if (files.isEmpty())
 		return;
-	struct vec2 scale;
-	obs_data_get_vec2(item, "scale", &scale);
-	scale.x *= 9.0f / 11.0f;
-	scale.y *= 9.0f / 11.0f;
-	if (obs_data_get_bool(gdi->second, "extents_wrap")) {
-		obs_data_set_int(item, "bounds_type", OBS_BOUNDS_MAX_ONLY);
-		struct vec2 bounds;
-		bounds.x = obs_data_get_double(gdi->second, "extents_cx");
-		bounds.y = obs_data_get_double(gdi->second, "extents_cy");
-		if (bounds.y < 2.0) {
-			auto font = obs_data_get_obj(gdi->second, "font");
-			auto font_size = obs_data_get_double(font, "size");
-			obs_data_release(font);
-			bounds.y = font_size;
-		}
-		obs_data_set_vec2(item, "bounds", &bounds);
-	} else {
-		obs_data_set_vec2(item, "scale", &scale);
-	}
-	const char *align_str = obs_data_get_string(gdi->second, "align");
-	const char *valign_str = obs_data_get_string(gdi->second, "valign");
-	int bounds_align = 0;
-	if (strcmp(align_str, "center") == 0) {
-		bounds_align += OBS_ALIGN_CENTER;
-		obs_data_set_int(gdi->second, "custom_width", 0);
-	} else if (strcmp(align_str, "right") == 0) {
-
-		bounds_align += OBS_ALIGN_RIGHT;
-	} else {
-
-		bounds_align += OBS_ALIGN_LEFT;
-	}
-
-	if (strcmp(valign_str, "center") == 0)
-		bounds_align += OBS_ALIGN_CENTER;
-	else if (strcmp(valign_str, "bottom") == 0)
-		bounds_align += OBS_ALIGN_BOTTOM;
-	else
-		bounds_align += OBS_ALIGN_TOP;
-	obs_data_set_int(item, "bounds_align", bounds_align);
-}
-
-void SceneCollectionManagerDialog::replace_os_specific(obs_data_t *data)
-{
-	obs_data_array_t *sources = obs_data_get_array(data, "sources");
-	if (!sources)
-		return;
-	std::map<std::string, obs_data_t *> gdi_sources;
-	auto count = obs_data_array_count(sources);
-	for (size_t i = 0; i < count; i++) {
-		obs_data_t *s = obs_data_array_item(sources, i);
-		if (!s)
-			continue;
-#ifdef WIN32
-		make_source_windows(s);
-#elif __APPLE__
-		make_source_mac(s);
-#else
-		make_source_linux(s);
-#endif
-#ifndef WIN32
-		if (strcmp(obs_data_get_string(s, "id"), "text_gdiplus") == 0) {
-			obs_data_set_string(s, "id", "text_ft2_source");
-			obs_data_set_string(s, "versioned_id", "text_ft2_source_v2");
-			obs_data_t *settings = obs_data_get_obj(s, "settings");
-			if (settings) {
-				obs_data_set_default_int(settings, "color", 0xFFFFFF);
-				long long color = obs_data_get_int(settings, "color");
-				color = color & 0xFFFFFF;
-				obs_data_set_default_int(settings, "opacity", 100);
-				long long opacity = obs_data_get_int(settings, "opacity");
-				color |= ((opacity * 255 / 100) & 0xFF) << 24;
-				obs_data_set_int(settings, "color1", color);
-				obs_data_set_int(settings, "color2", color);
-				obs_data_set_default_bool(settings, "extents_wrap", true);
-				if (obs_data_get_bool(settings, "extents_wrap")) {
-					obs_data_set_default_int(settings, "extents_cx", 100);
-					obs_data_set_int(settings, "custom_width", obs_data_get_int(settings, "extents_cx"));
-					obs_data_set_bool(settings, "word_wrap", true);
-				}
-				gdi_sources.emplace(obs_data_get_string(s, "name"), settings);
-			}
-		}
-#endif
-		obs_data_release(s);
-	}
-#ifndef WIN32
-	for (size_t i = 0; i < count; i++) {
-		obs_data_t *s = obs_data_array_item(sources, i);
-		if (!s)
-			continue;
-		if (strcmp(obs_data_get_string(s, "id"), "scene") != 0 && strcmp(obs_data_get_string(s, "id"), "group") != 0) {
-			obs_data_release(s);
-			continue;
-		}
-
-		obs_data_t *settings = obs_data_get_obj(s, "settings");
-		obs_data_array_t *items = obs_data_get_array(settings, "items");
-		obs_data_release(settings);
-		auto item_count = obs_data_array_count(items);
-		for (size_t j = 0; j < item_count; j++) {
-			obs_data_t *item = obs_data_array_item(items, j);
-			if (!item)
-				continue;
-			replace_gdi_sceneitem_transform(item, gdi_sources);
-			obs_data_release(item);
-		}
-		obs_data_array_release(items);
-		obs_data_release(s);
-	}
-	obs_data_array_release(sources);
-
-	sources = obs_data_get_array(data, "groups");
-	count = obs_data_array_count(sources);
-	for (size_t i = 0; i < count; i++) {
-		obs_data_t *s = obs_data_array_item(sources, i);
-		if (!s)
-			continue;
-		obs_data_t *settings = obs_data_get_obj(s, "settings");
-		obs_data_array_t *items = obs_data_get_array(settings, "items");
-		obs_data_release(settings);
-		auto item_count = obs_data_array_count(items);
-		for (size_t j = 0; j < item_count; j++) {
-			obs_data_t *item = obs_data_array_item(items, j);
-			if (!item)
-				continue;
-			replace_gdi_sceneitem_transform(item, gdi_sources);
-			obs_data_release(item);
-		}
-		obs_data_array_release(items);
-		obs_data_release(s);
-	}
-	obs_data_array_release(sources);
-#endif
-	for (const auto &kv : gdi_sources) {
-		obs_data_release(kv.second);
-	}
-	auto globalAudio = {"DesktopAudioDevice1", "DesktopAudioDevice2", "AuxAudioDevice1",
-			    "AuxAudioDevice2",     "AuxAudioDevice3",     "AuxAudioDevice4"};
-	for (auto ga : globalAudio) {
-		obs_data_t *s = obs_data_get_obj(data, ga);
-		if (!s)
-			continue;
-#ifdef WIN32
-		make_source_windows(s);
-#elif __APPLE__
-		make_source_mac(s);
-#else
-		make_source_linux(s);
-#endif
-		obs_data_release(s);
-	}
-}
-
-void SceneCollectionManagerDialog::export_local_files(obs_data_t *data, std::string dir, std::string subdir)
-{
-	obs_data_item_t *item = obs_data_first(data);
-	while (item) {
-		const enum obs_data_type type = obs_data_item_gettype(item);
-		if (type == OBS_DATA_STRING) {
-			std::string str = obs_data_item_get_string(item);
-			bool local_url = false;
-			if (str.substr(0, 7) == "file://") {
-				str = str.substr(7);
-				local_url = true;
-			}
-			auto slash = str.find('\\');
-			while (slash != std::string::npos) {
-				str.replace(slash, slash + 1, "/");
-				slash = str.find('\\');
-			}
-			std::size_t found = str.find_last_of("/\\");
-			if (found != std::string::npos && os_file_exists(str.c_str()) &&
-			    (str.length() < dir.length() || str.substr(0, dir.length()) != dir)) {
-				//todo move file to dir and update item
-				auto filename = GetFilenameFromPath(str, true);
-				std::string newDir = subdir;
-				std::string safe;
-				auto n = obs_data_item_get_name(item);
-				if (n && GetFileSafeName(n, safe)) {
-					newDir += safe;
-					newDir += "/";
-				}
-				auto fullNewDir = dir + newDir;
-				os_mkdirs(fullNewDir.c_str());
-				auto newFile = fullNewDir + filename;
-				if (os_file_exists(newFile.c_str())) {
-					os_unlink(newFile.c_str());
-				}
-				if (os_copyfile(str.c_str(), newFile.c_str()) == 0) {
-					newFile = newDir + filename;
-					if (local_url) {
-						str = "file://";
-						str += newFile.c_str();
-					} else {
-						str = newFile.c_str();
-					}
-					obs_data_item_set_string(&item, str.c_str());
-					item = obs_data_first(data);
-					continue;
-				}
-			}
-		} else if (type == OBS_DATA_OBJECT) {
-			if (obs_data_t *obj = obs_data_item_get_obj(item)) {
-				std::string newDir = subdir;
-				std::string safe;
-				auto n = obs_data_item_get_name(item);
-				if (n && GetFileSafeName(n, safe)) {
-					newDir += safe;
-					newDir += "/";
-				}
-				export_local_files(obj, dir, newDir);
-				obs_data_release(obj);
-			}
-		} else if (type == OBS_DATA_ARRAY) {
-			std::string newDir = dir;
-			newDir += obs_data_item_get_name(item);
-			newDir += "/";
-			const auto array = obs_data_item_get_array(item);
-			const auto count = obs_data_array_count(array);
-			for (size_t i = 0; i < count; i++) {
-				if (obs_data_t *obj = obs_data_array_item(array, i)) {
-					std::string newDir = subdir;
-					std::string safe;
-					auto n = obs_data_item_get_name(item);
-					if (n && GetFileSafeName(n, safe)) {
-						newDir += safe;
-						newDir += "/";
-					}
-					n = obs_data_get_string(obj, "name");
-					if (n && GetFileSafeName(n, safe)) {
-						newDir += safe;
-						newDir += "/";
-					}
-					export_local_files(obj, dir, newDir);
-					obs_data_release(obj);
-				}
-			}
-		}
-		obs_data_item_next(&item);
+	SceneCollectionsPath();
+	const uint64_t started = metrics.Start();
+	auto imports = std::make_shared<std::vector<std::vector<ImportedSceneCollection>>>(files.size());
+	std::vector<std::function<void()>> jobs;
+	for (qsizetype i = 0; i < files.size(); i++) {
+		std::string file = files[i].toUtf8().constData();
+		jobs.emplace_back([imports, i, file] { LoadImport(file, imports->at(i)); });
 	}
+	RunInParallel(jobs, [imports, started] { SaveImports(imports, started); });
 }
 
 void SceneCollectionManagerDialog::on_actionDuplicateSceneCollection_triggered()
@@ -1188,7 +972,7 @@ void SceneCollectionManagerDialog::on_actionDuplicateSceneCollection_triggered()
 			config_set_string(config, "Basic", "SceneCollection", "");
 			config_set_string(config, "Basic", "SceneCollectionFile", "scene_collection_manager_temp");
 		}
-		obs_frontend_set_current_scene_collection(c);
+		SetCurrentSceneCollection(c);
 		std::string tempPath = path;
 		tempPath += "scene_collection_manager_temp.json";
 		os_unlink(tempPath.c_str());
@@ -1215,6 +999,8 @@ void SceneCollectionManagerDialog::on_actionRemoveSceneCollection_triggered()
 
 	if (reinterpret_cast<QAbstractButton *>(yes) != remove.clickedButton())
 		return;
+	const auto trashDir = GetTrashDirectory(SceneCollectionsPath());
+	std::vector<TrashEntry> removed;
 	for (auto &item : items) {
 		auto filePath = scene_collections.at(item->text());
 		if (filePath.length() == 0)
@@ -1224,23 +1010,27 @@ void SceneCollectionManagerDialog::on_actionRemoveSceneCollection_triggered()
 			filePath = absolute;
 			bfree(absolute);
 		}
-		os_unlink(filePath.c_str());
-		auto backupDir = GetBackupDirectory(filePath);
-		const auto f = backupDir + "*.json";
-		os_glob_t *glob;
-		if (os_glob(f.c_str(), 0, &glob) == 0) {
-			for (size_t i = 0; i < glob->gl_pathc; i++) {
-				const char *backupFilePath = glob->gl_pathv[i].path;
-
-				if (glob->gl_pathv[i].directory)
-					continue;
-				os_unlink(backupFilePath);
-			}
-			os_globfree(glob);
+		TrashEntry entry;
+		if (!MoveToTrash(trashDir, item->text().toUtf8().constData(), filePath, GetBackupDirectory(filePath), entry)) {
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to move '%s' to the trash", filePath.c_str());
+			continue;
 		}
-		os_rmdir(backupDir.c_str());
+		removed.push_back(entry);
 		scene_collections.erase(item->text());
 	}
+	if (!removed.empty())
+		lastRemoved = removed;
+	RefreshSceneCollections();
+	PurgeTrashInBackground(lastRemoved);
+}
+
+void SceneCollectionManagerDialog::RestoreSceneCollections(const std::vector<TrashEntry> &entries)
+{
+	for (const auto &entry : entries) {
+		if (!RestoreFromTrash(entry))
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to restore '%s' from the trash", entry.name.c_str());
+	}
+	ReadSceneCollections();
 	RefreshSceneCollections();
 }
 
@@ -1251,6 +1041,55 @@ void SceneCollectionManagerDialog::on_actionConfigSceneCollection_triggered()
 	connect(a, SIGNAL(triggered()), this, SLOT(on_actionRenameSceneCollection_triggered()));
 	a = m.addAction(QString::fromUtf8(obs_module_text("Export")));
 	connect(a, SIGNAL(triggered()), this, SLOT(on_actionExportSceneCollection_triggered()));
+	a = m.addAction(QString::fromUtf8(obs_module_text("ConversionPreview")));
+	connect(a, SIGNAL(triggered()), this, SLOT(on_actionConversionPreview_triggered()));
+	a = m.addAction(QString::fromUtf8(obs_module_text("MergeInto")));
+	connect(a, SIGNAL(triggered()), this, SLOT(on_actionMergeSceneCollection_triggered()));
+	a = m.addAction(QString::fromUtf8(obs_module_text("FindMissingMedia")));
+	connect(a, SIGNAL(triggered()), this, SLOT(on_actionFindMissingMedia_triggered()));
+	m.addSeparator();
+
+	if (!lastRemoved.empty()) {
+		a = m.addAction(QString::fromUtf8(obs_module_text("UndoRemove")));
+		connect(a, &QAction::triggered, [this] {
+			const auto entries = lastRemoved;
+			lastRemoved.clear();
+			RestoreSceneCollections(entries);
+		});
+	}
+
+	auto trashMenu = m.addMenu(QString::fromUtf8(obs_module_text("Trash")));
+	for (const auto &entry : ListTrash(GetTrashDirectory(SceneCollectionsPath()))) {
+		const auto deleted = QDateTime::fromSecsSinceEpoch(entry.deleted).toString(Qt::ISODate).replace('T', ' ');
+		a = trashMenu->addAction(QString::fromUtf8(entry.name.c_str()) + " (" + deleted + ")");
+		connect(a, &QAction::triggered, [this, entry] {
+			lastRemoved.clear();
+			RestoreSceneCollections({entry});
+		});
+	}
+	if (trashMenu->isEmpty())
+		trashMenu->addAction(QString::fromUtf8(obs_module_text("TrashEmpty")))->setEnabled(false);
+	trashMenu->addSeparator();
+
+	QWidget *daysRow = new QWidget(trashMenu);
+	auto hl = new QHBoxLayout;
+	daysRow->setLayout(hl);
+	QSpinBox *daysSpin = new QSpinBox(trashMenu);
+	daysSpin->setMinimum(0);
+	daysSpin->setMaximum(365);
+	daysSpin->setSingleStep(1);
+	daysSpin->setValue(trashRetentionDays);
+	hl->addWidget(daysSpin);
+	QWidgetAction *daysAction = new QWidgetAction(trashMenu);
+	daysAction->setDefaultWidget(daysRow);
+	connect(daysSpin, (void (QSpinBox::*)(int))&QSpinBox::valueChanged, [](int val) {
+		trashRetentionDays = val;
+		auto config = obs_frontend_get_user_config();
+		if (config)
+			config_set_int(config, "SceneCollectionManager", "TrashRetentionDays", trashRetentionDays);
+	});
+	trashMenu->addMenu(QString::fromUtf8(obs_module_text("TrashRetentionDays")))->addAction(daysAction);
+
 	m.exec(QCursor::pos());
 }
 
@@ -1286,7 +1125,14 @@ void SceneCollectionManagerDialog::on_actionRenameSceneCollection_triggered()
 
 		obs_data_save_json(data, filePath.c_str());
 		obs_data_release(data);
-		os_rename(GetBackupDirectory(filename).c_str(), GetBackupDirectory(filePath).c_str());
+		/* the backups would be left behind under the old name */
+		const auto storage = GetBackupStorage();
+		if (storage && !storage->Move(filename, filePath)) {
+			os_unlink(filePath.c_str());
+			QMessageBox::warning(this, QString::fromUtf8(obs_module_text("RenameSceneCollection")),
+					     QString::fromUtf8(obs_module_text("MoveBackupsFailed")));
+			return;
+		}
 		os_unlink(filename.c_str());
 		const QString currentSceneCollection = QString::fromUtf8(obs_frontend_get_current_scene_collection());
 		if (currentSceneCollection == item->text()) {
@@ -1306,8 +1152,65 @@ void SceneCollectionManagerDialog::on_actionRenameSceneCollection_triggered()
 	}
 }
 
+/* exporting into an earlier export only copies what changed, the user picks how changes are found and whether
+ * files that are no longer used are removed, false when cancelled */
+static bool GetExportOptions(QWidget *parent, const std::string &dir, ExportOptions &options)
+{
+	if (!HasExportManifest(dir))
+		return true;
+	QDialog dialog(parent);
+	dialog.setWindowTitle(QString::fromUtf8(obs_module_text("Export")));
+	auto layout = new QVBoxLayout(&dialog);
+	auto verify = new QCheckBox(QString::fromUtf8(obs_module_text("ExportVerifyHash")), &dialog);
+	verify->setChecked(true);
+	layout->addWidget(verify);
+	auto prune = new QCheckBox(QString::fromUtf8(obs_module_text("ExportPrune")), &dialog);
+	layout->addWidget(prune);
+	auto buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+	QObject::connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+	QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+	layout->addWidget(buttons);
+	if (dialog.exec() != QDialog::Accepted)
+		return false;
+	options.verify_hash = verify->isChecked();
+	options.prune = prune->isChecked();
+	return true;
+}
+
 void SceneCollectionManagerDialog::on_actionExportSceneCollection_triggered()
 {
+	const auto exported = [](uint64_t started) { return [started] { metrics.ObserveSince(MetricHistogram::Export, started); }; };
+	const auto items = ui->sceneCollectionList->selectedItems();
+	if (items.size() > 1) {
+		const QString folder = QFileDialog::getExistingDirectory(this, obs_module_text("ExportSceneCollection"));
+		if (folder.isEmpty())
+			return;
+		std::vector<std::string> files;
+		for (auto &selected : items) {
+			const auto filename = scene_collections.at(selected->text());
+			if (filename.length())
+				files.push_back(filename);
+		}
+		std::string exportDir = QDir::fromNativeSeparators(folder).toUtf8().constData();
+		if (exportDir.back() != '/')
+			exportDir += "/";
+		ExportOptions options;
+		if (!GetExportOptions(this, exportDir, options))
+			return;
+		RunInParallel({[files, exportDir, options] {
+				      std::vector<obs_data_t *> collections;
+				      for (const auto &file : files) {
+					      if (auto data = obs_data_create_from_json_file_safe(file.c_str(), "bak"))
+						      collections.push_back(data);
+				      }
+				      ExportSceneCollections(collections, exportDir, options);
+				      for (auto data : collections)
+					      obs_data_release(data);
+			      }},
+			      exported(metrics.Start()));
+		return;
+	}
+
 	const auto item = ui->sceneCollectionList->currentItem();
 	if (!item)
 		return;
@@ -1315,12 +1218,24 @@ void SceneCollectionManagerDialog::on_actionExportSceneCollection_triggered()
 	if (!filename.length())
 		return;
 	const QString file =
-		QFileDialog::getSaveFileName(this, obs_module_text("ExportSceneCollection"), "", "Scene Collection (*.json)");
+		QFileDialog::getSaveFileName(this, obs_module_text("ExportSceneCollection"), "",
+					     "Scene Collection (*.json);;Scene Collection Archive (*.zip)");
 	if (file.isEmpty())
 		return;
 
-	auto data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
 	auto f = file.toUtf8();
+	if (IsArchiveFile(f.constData())) {
+		std::string archive = f.constData();
+		RunInParallel({[filename, archive] {
+				      auto data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+				      if (!data)
+					      return;
+				      ExportSceneCollectionArchive(data, archive);
+				      obs_data_release(data);
+			      }},
+			      exported(metrics.Start()));
+		return;
+	}
 	std::string dir = f.constData();
 	auto slash = dir.find_last_of("/\\");
 	if (slash != std::string::npos) {
@@ -1337,19 +1252,186 @@ void SceneCollectionManagerDialog::on_actionExportSceneCollection_triggered()
 		dir.replace(slash, slash + 1, "/");
 		slash = dir.find('\\');
 	}
-	export_local_files(data, dir, "");
-	obs_data_save_json(data, f.constData());
+	ExportOptions options;
+	if (!GetExportOptions(this, dir, options))
+		return;
+	std::string exportFile = f.constData();
+	RunInParallel({[filename, dir, exportFile, options] { ExportSceneCollectionFile(filename, exportFile, dir, "", options); }},
+		      exported(metrics.Start()));
+}
+
+void SceneCollectionManagerDialog::on_actionConversionPreview_triggered()
+{
+	const auto item = ui->sceneCollectionList->currentItem();
+	if (!item)
+		return;
+	const auto filename = scene_collections.at(item->text());
+	if (!filename.length())
+		return;
+	auto report = std::make_shared<std::vector<SourceConversion>>();
+	QPointer<SceneCollectionManagerDialog> dialog(this);
+	RunInParallel({[filename, report] {
+			      auto data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+			      if (!data)
+				      return;
+			      *report = ConvertSceneCollection(data, sourceTypeMappings, GetCurrentSourceTarget(), true);
+			      obs_data_release(data);
+		      }},
+		      [dialog, report] {
+			      if (!dialog)
+				      return;
+			      QMessageBox box(dialog);
+			      box.setIcon(QMessageBox::Information);
+			      box.setWindowTitle(QString::fromUtf8(obs_module_text("ConversionPreview")));
+			      if (report->empty()) {
+				      box.setText(QString::fromUtf8(obs_module_text("NoConversionNeeded")));
+			      } else {
+				      box.setText(QString::fromUtf8(obs_module_text("SourcesToConvert")).arg((qulonglong)report->size()));
+				      box.setDetailedText(QString::fromUtf8(FormatConversionReport(*report).c_str()));
+			      }
+			      box.exec();
+		      });
+}
+
+static void MergeIntoFile(obs_data_t *source, const std::string &targetFile, const std::vector<std::string> &scenes,
+			  MergeConflict conflict)
+{
+	obs_data_t *data = obs_data_create_from_json_file_safe(targetFile.c_str(), "bak");
+	if (!data)
+		return;
+	MergeSceneCollection(data, source, scenes, conflict);
+	if (!obs_data_save_json_safe(data, targetFile.c_str(), "tmp", "bak"))
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to save '%s'", targetFile.c_str());
 	obs_data_release(data);
 }
 
+void SceneCollectionManagerDialog::on_actionMergeSceneCollection_triggered()
+{
+	const auto item = ui->sceneCollectionList->currentItem();
+	if (!item)
+		return;
+	const auto filename = scene_collections.at(item->text());
+	if (!filename.length())
+		return;
+	QStringList targets;
+	for (const auto &collection : scene_collections) {
+		if (collection.first != item->text())
+			targets.append(collection.first);
+	}
+	bool ok;
+	const QString targetName = QInputDialog::getItem(this, QString::fromUtf8(obs_module_text("MergeInto")),
+							 QString::fromUtf8(obs_module_text("SceneCollection")), targets, 0, false, &ok);
+	if (!ok || targetName.isEmpty())
+		return;
+	const auto targetFile = scene_collections.at(targetName);
+
+	/* the open collection only reaches its file when OBS saves it */
+	auto csc = obs_frontend_get_current_scene_collection();
+	const auto current = csc ? QString::fromUtf8(csc) : QString();
+	bfree(csc);
+	if (current == item->text())
+		obs_frontend_save();
+
+	obs_data_t *data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+	if (!data)
+		return;
+	const std::shared_ptr<obs_data_t> source(data, obs_data_release);
+	QDialog select(this);
+	select.setWindowTitle(QString::fromUtf8(obs_module_text("MergeInto")) + " " + targetName);
+	auto layout = new QVBoxLayout(&select);
+	auto sceneList = new QListWidget(&select);
+	for (const auto &scene : GetSceneNames(source.get())) {
+		auto sceneItem = new QListWidgetItem(QString::fromUtf8(scene.c_str()), sceneList);
+		sceneItem->setFlags(sceneItem->flags() | Qt::ItemIsUserCheckable);
+		sceneItem->setCheckState(Qt::Unchecked);
+	}
+	layout->addWidget(sceneList);
+	auto conflictCombo = new QComboBox(&select);
+	conflictCombo->addItem(QString::fromUtf8(obs_module_text("MergeRename")), (int)MergeConflict::Rename);
+	conflictCombo->addItem(QString::fromUtf8(obs_module_text("MergeSkip")), (int)MergeConflict::Skip);
+	conflictCombo->addItem(QString::fromUtf8(obs_module_text("MergeOverwrite")), (int)MergeConflict::Overwrite);
+	layout->addWidget(conflictCombo);
+	auto buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &select);
+	connect(buttons, &QDialogButtonBox::accepted, &select, &QDialog::accept);
+	connect(buttons, &QDialogButtonBox::rejected, &select, &QDialog::reject);
+	layout->addWidget(buttons);
+	std::vector<std::string> scenes;
+	if (select.exec() == QDialog::Accepted) {
+		for (int row = 0; row < sceneList->count(); row++) {
+			if (sceneList->item(row)->checkState() == Qt::Checked)
+				scenes.emplace_back(sceneList->item(row)->text().toUtf8().constData());
+		}
+	}
+	if (scenes.empty())
+		return;
+	const auto conflict = (MergeConflict)conflictCombo->currentData().toInt();
+	const std::string target = targetName.toUtf8().constData();
+	if (current != targetName) {
+		RunInParallel({[source, targetFile, scenes, conflict] { MergeIntoFile(source.get(), targetFile, scenes, conflict); }},
+			      [] {});
+		return;
+	}
+	/* OBS saves the open collection on the UI thread, so saving, merging and loading it again is one step there,
+	 * a save in between would lose either the merge or the latest changes */
+	operationDispatcher.Dispatch("merge into " + target, [source, targetFile, scenes, conflict, target] {
+		auto csc = obs_frontend_get_current_scene_collection();
+		const bool open = csc && target == csc;
+		bfree(csc);
+		if (open)
+			obs_frontend_save();
+		MergeIntoFile(source.get(), targetFile, scenes, conflict);
+		if (open)
+			OpenSceneCollection(target);
+	});
+}
+
+void SceneCollectionManagerDialog::on_actionFindMissingMedia_triggered()
+{
+	std::map<std::string, std::string> collections;
+	for (const auto &collection : scene_collections)
+		collections[collection.first.toUtf8().constData()] = collection.second;
+	auto missing = std::make_shared<std::vector<MissingMedia>>();
+	QPointer<SceneCollectionManagerDialog> dialog(this);
+	RunInParallel({[collections, missing] {
+			      std::lock_guard<std::mutex> lock(mediaScannerMutex);
+			      *missing = mediaScanner.Scan(collections);
+		      }},
+		      [dialog, missing] {
+			      if (!dialog)
+				      return;
+			      QMessageBox box(dialog);
+			      box.setIcon(missing->empty() ? QMessageBox::Information : QMessageBox::Warning);
+			      box.setWindowTitle(QString::fromUtf8(obs_module_text("FindMissingMedia")));
+			      if (missing->empty()) {
+				      box.setText(QString::fromUtf8(obs_module_text("NoMissingMedia")));
+			      } else {
+				      std::set<std::string> affected;
+				      QString details;
+				      for (const auto &media : *missing) {
+					      affected.insert(media.collection);
+					      const auto line = media.collection + ": " + media.source + "\n    " + media.path + "\n";
+					      details += QString::fromUtf8(line.c_str());
+				      }
+				      box.setText(QString::fromUtf8(obs_module_text("MissingMediaFound"))
+							  .arg((qulonglong)missing->size())
+							  .arg((qulonglong)affected.size()));
+				      box.setDetailedText(details);
+			      }
+			      box.exec();
+		      });
+}
+
 void SceneCollectionManagerDialog::on_actionSwitchSceneCollection_triggered()
 {
 	if (const auto item = ui->sceneCollectionList->currentItem()) {
-		auto t = item->text().toUtf8();
-		auto c = t.constData();
-		activate_dshow(false);
-		obs_frontend_set_current_scene_collection(c);
-		activate_dshow(true);
+		const std::string sceneCollection = item->text().toUtf8().constData();
+		const uint64_t started = metrics.Start();
+		operationDispatcher.Dispatch("switch to " + sceneCollection, [sceneCollection, started] {
+			activate_dshow(false);
+			SetCurrentSceneCollection(sceneCollection.c_str());
+			activate_dshow(true);
+			metrics.ObserveSince(MetricHistogram::Switch, started);
+		});
 	}
 }
 
@@ -1376,19 +1458,25 @@ void SceneCollectionManagerDialog::on_actionAddBackup_triggered()
 		if (!ok || text.isEmpty())
 			return;
 
-		const auto backupDir = GetBackupDirectory(filename);
-		os_mkdirs(backupDir.c_str());
-
+		const auto storage = GetBackupStorage();
 		std::string safeName;
-		if (!GetFileSafeName(text.toUtf8().constData(), safeName))
+		if (!storage || !GetFileSafeName(text.toUtf8().constData(), safeName))
 			return;
 
-		auto *data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
-		obs_data_set_string(data, "name", text.toUtf8().constData());
-		const auto backupFile = backupDir + safeName + ".json";
-		obs_data_save_json(data, backupFile.c_str());
-		obs_data_release(data);
-		ui->backupList->addItem(text);
+		const std::string name = text.toUtf8().constData();
+		operationDispatcher.Dispatch("backup " + name, [storage, filename, name] {
+			auto *data = obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+			if (!data)
+				return;
+			const std::shared_ptr<obs_data_t> snapshot(data, obs_data_release);
+			backupScheduler.Schedule(
+				[storage, snapshot, filename, name](IoThrottle *throttle) {
+					if (SaveBackupJob(*storage, snapshot.get(), filename, name, throttle))
+						RefreshBackupsLater(filename);
+				},
+				true, filename);
+		});
+		backupModel->AddBackup(name);
 	}
 }
 
@@ -1399,13 +1487,9 @@ void SceneCollectionManagerDialog::on_actionRemoveBackup_triggered()
 		if (!filename.length())
 			return;
 
-		auto backupItems = ui->backupList->selectedItems();
-		if (backupItems.isEmpty()) {
-			if (const auto backupItem = ui->backupList->currentItem())
-				backupItems.append(backupItem);
-			else
-				return;
-		}
+		const auto backupRows = SelectedBackupRows();
+		if (backupRows.empty())
+			return;
 		QMessageBox remove(this);
 		remove.setText(QString::fromUtf8(obs_module_text("DoYouWantToRemoveBackup")));
 		QPushButton *yes = remove.addButton(QString::fromUtf8(obs_module_text("Yes")), QMessageBox::YesRole);
@@ -1417,18 +1501,13 @@ void SceneCollectionManagerDialog::on_actionRemoveBackup_triggered()
 
 		if (reinterpret_cast<QAbstractButton *>(yes) != remove.clickedButton())
 			return;
-		for (auto &backupItem : backupItems) {
-			const auto backupDir = GetBackupDirectory(filename);
-			auto itemName = backupItem->text();
-			auto itemNameUtf8 = itemName.toUtf8();
-			std::string safeName;
-			if (!GetFileSafeName(itemNameUtf8.constData(), safeName))
-				continue;
-
-			const auto backupFile = backupDir + safeName + ".json";
-			os_unlink(backupFile.c_str());
-		}
-		on_sceneCollectionList_currentRowChanged(ui->sceneCollectionList->currentRow());
+		const auto storage = GetBackupStorage();
+		if (!storage)
+			return;
+		for (const int row : backupRows)
+			storage->Remove(filename, backupModel->GetName(row));
+		RefreshBackups(filename);
+		RequestSceneCollectionInfo(filename);
 	}
 }
 
@@ -1437,6 +1516,10 @@ void SceneCollectionManagerDialog::on_actionConfigBackup_triggered()
 	QMenu m;
 	auto a = m.addAction(QString::fromUtf8(obs_module_text("Rename")));
 	connect(a, SIGNAL(triggered()), this, SLOT(on_actionRenameBackup_triggered()));
+	a = m.addAction(QString::fromUtf8(obs_module_text("Compare")));
+	connect(a, SIGNAL(triggered()), this, SLOT(on_actionCompareBackup_triggered()));
+	a = m.addAction(QString::fromUtf8(obs_module_text("CleanUp")));
+	connect(a, SIGNAL(triggered()), this, SLOT(on_actionCleanUpBackups_triggered()));
 	m.addSeparator();
 
 	a = m.addAction(QString::fromUtf8(obs_module_text("AutoBackup")));
@@ -1473,6 +1556,109 @@ void SceneCollectionManagerDialog::on_actionConfigBackup_triggered()
 
 	m.addMenu(QString::fromUtf8(obs_module_text("Max")))->addAction(maxAction);
 
+	QWidget *orphanRow = new QWidget(&m);
+	auto orphanLayout = new QHBoxLayout;
+	orphanRow->setLayout(orphanLayout);
+	QSpinBox *orphanSpin = new QSpinBox(&m);
+	orphanSpin->setMinimum(0);
+	orphanSpin->setMaximum(365);
+	orphanSpin->setSingleStep(1);
+	orphanSpin->setSpecialValueText(QString::fromUtf8(obs_module_text("Never")));
+	orphanSpin->setValue(orphanRetentionDays);
+	orphanLayout->addWidget(orphanSpin);
+	QWidgetAction *orphanAction = new QWidgetAction(&m);
+	orphanAction->setDefaultWidget(orphanRow);
+	connect(orphanSpin, (void (QSpinBox::*)(int))&QSpinBox::valueChanged, [](int val) {
+		orphanRetentionDays = val;
+		auto config = obs_frontend_get_user_config();
+		if (config)
+			config_set_int(config, "SceneCollectionManager", "OrphanRetentionDays", orphanRetentionDays);
+	});
+	m.addMenu(QString::fromUtf8(obs_module_text("CleanUpDays")))->addAction(orphanAction);
+
+	a = m.addAction(QString::fromUtf8(obs_module_text("WriteMetrics")));
+	a->setCheckable(true);
+	a->setChecked(metrics.Enabled());
+	connect(a, &QAction::triggered, [] {
+		metrics.SetEnabled(!metrics.Enabled());
+		UpdateMetricsTimer();
+		auto config = obs_frontend_get_user_config();
+		if (config)
+			config_set_bool(config, "SceneCollectionManager", "Metrics", metrics.Enabled());
+	});
+
+	a = m.addAction(QString::fromUtf8(obs_module_text("RecordTrace")));
+	a->setCheckable(true);
+	a->setChecked(IsTraceEnabled());
+	connect(a, &QAction::triggered, [this] {
+		if (!IsTraceEnabled()) {
+			SetTraceEnabled(true);
+			return;
+		}
+		/* stopping writes what was recorded, recording again starts a new timeline */
+		SetTraceEnabled(false);
+		char *dir = obs_module_config_path("");
+		char *name = os_generate_formatted_filename("json", true, "trace-%CCYY-%MM-%DD-%hh-%mm-%ss");
+		if (!dir || !name) {
+			bfree(dir);
+			bfree(name);
+			return;
+		}
+		const std::string traceDir = dir;
+		const std::string file = traceDir + name;
+		bfree(dir);
+		bfree(name);
+		auto success = std::make_shared<bool>(false);
+		QPointer<SceneCollectionManagerDialog> dialog(this);
+		RunInParallel({[traceDir, file, success] {
+				      os_mkdirs(traceDir.c_str());
+				      *success = WriteTrace(file);
+			      }},
+			      [dialog, file, success] {
+				      if (!dialog)
+					      return;
+				      QMessageBox box(dialog);
+				      box.setIcon(*success ? QMessageBox::Information : QMessageBox::Warning);
+				      box.setWindowTitle(QString::fromUtf8(obs_module_text("RecordTrace")));
+				      box.setText(QString::fromUtf8(obs_module_text(*success ? "TraceWritten" : "TraceFailed"))
+							  .arg(QString::fromUtf8(file.c_str())));
+				      box.exec();
+			      });
+	});
+
+	a = m.addAction(QString::fromUtf8(obs_module_text("DeferDuringShow")));
+	a->setCheckable(true);
+	a->setChecked(deferDuringShow);
+	connect(a, &QAction::triggered, [] {
+		deferDuringShow = !deferDuringShow;
+		backupScheduler.SetDeferDuringShow(deferDuringShow);
+		auto config = obs_frontend_get_user_config();
+		if (config)
+			config_set_bool(config, "SceneCollectionManager", "DeferDuringShow", deferDuringShow);
+	});
+
+	QWidget *rateRow = new QWidget(&m);
+	auto rateLayout = new QHBoxLayout;
+	rateRow->setLayout(rateLayout);
+	QSpinBox *rateSpin = new QSpinBox(&m);
+	rateSpin->setMinimum(0);
+	rateSpin->setMaximum(1024 * 1024);
+	rateSpin->setSingleStep(256);
+	rateSpin->setSuffix(" KB/s");
+	rateSpin->setSpecialValueText(QString::fromUtf8(obs_module_text("Unlimited")));
+	rateSpin->setValue(backupRateLimit);
+	rateLayout->addWidget(rateSpin);
+	QWidgetAction *rateAction = new QWidgetAction(&m);
+	rateAction->setDefaultWidget(rateRow);
+	connect(rateSpin, (void (QSpinBox::*)(int))&QSpinBox::valueChanged, [](int val) {
+		backupRateLimit = val;
+		backupScheduler.SetRateLimit((uint64_t)backupRateLimit * 1024);
+		auto config = obs_frontend_get_user_config();
+		if (config)
+			config_set_int(config, "SceneCollectionManager", "BackupRateLimit", backupRateLimit);
+	});
+	m.addMenu(QString::fromUtf8(obs_module_text("RateLimitDuringShow")))->addAction(rateAction);
+
 	m.addSeparator();
 
 	auto dirMenu = m.addMenu(QString::fromUtf8(obs_module_text("BackupDir")));
@@ -1491,17 +1677,21 @@ void SceneCollectionManagerDialog::on_actionConfigBackup_triggered()
 	dirMenu->addSeparator();
 	a = dirMenu->addAction(QString::fromUtf8(obs_module_text("Default")));
 	a->setCheckable(true);
-	a->setChecked(customBackupDir.empty());
+	a->setChecked(backupStorageType != "s3" && customBackupDir.empty());
 	connect(a, &QAction::triggered, [this] {
 		customBackupDir = "";
+		backupStorageType = "local";
 		auto config = obs_frontend_get_user_config();
-		if (config)
+		if (config) {
 			config_set_string(config, "SceneCollectionManager", "BackupDir", customBackupDir.c_str());
+			config_set_string(config, "SceneCollectionManager", "BackupStorage", backupStorageType.c_str());
+		}
+		CreateBackupStorage();
 		on_sceneCollectionList_currentRowChanged(ui->sceneCollectionList->currentRow());
 	});
 	a = dirMenu->addAction(QString::fromUtf8(obs_module_text("Custom")));
 	a->setCheckable(true);
-	a->setChecked(!customBackupDir.empty());
+	a->setChecked(backupStorageType != "s3" && !customBackupDir.empty());
 	connect(a, &QAction::triggered, [this] {
 		const QString dir = QFileDialog::getExistingDirectory(this, QString::fromUtf8(obs_module_text("BackupDir")),
 								      QString::fromUtf8(customBackupDir.c_str()),
@@ -1510,15 +1700,103 @@ void SceneCollectionManagerDialog::on_actionConfigBackup_triggered()
 			return;
 		auto d = dir.toUtf8();
 		customBackupDir = d.constData();
+		backupStorageType = "local";
 		auto config = obs_frontend_get_user_config();
-		if (config)
+		if (config) {
 			config_set_string(config, "SceneCollectionManager", "BackupDir", customBackupDir.c_str());
+			config_set_string(config, "SceneCollectionManager", "BackupStorage", backupStorageType.c_str());
+		}
+		CreateBackupStorage();
+		on_sceneCollectionList_currentRowChanged(ui->sceneCollectionList->currentRow());
+	});
+	a = dirMenu->addAction(QString::fromUtf8(obs_module_text("ObjectStorage")));
+	a->setCheckable(true);
+	a->setChecked(backupStorageType == "s3");
+	connect(a, &QAction::triggered, [this] {
+		auto config = obs_frontend_get_user_config();
+		if (!config)
+			return;
+		QDialog settings(this);
+		settings.setWindowTitle(QString::fromUtf8(obs_module_text("ObjectStorage")));
+		auto layout = new QFormLayout(&settings);
+		const std::vector<std::pair<const char *, const char *>> fields = {
+			{"S3Endpoint", "Endpoint"},
+			{"S3Bucket", "Bucket"},
+			{"S3Region", "Region"},
+			{"S3AccessKey", "AccessKey"},
+			{"S3SecretKey", "SecretKey"},
+			{"S3Prefix", "Prefix"},
+		};
+		std::vector<QLineEdit *> edits;
+		for (const auto &field : fields) {
+			auto edit = new QLineEdit(QString::fromUtf8(GetBackupStorageSetting(config, field.first).c_str()));
+			if (strcmp(field.first, "S3SecretKey") == 0)
+				edit->setEchoMode(QLineEdit::Password);
+			layout->addRow(QString::fromUtf8(obs_module_text(field.second)), edit);
+			edits.push_back(edit);
+		}
+		edits[0]->setPlaceholderText("https://s3.us-east-1.amazonaws.com");
+		edits[2]->setPlaceholderText("us-east-1");
+		auto buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+		connect(buttons, &QDialogButtonBox::accepted, &settings, &QDialog::accept);
+		connect(buttons, &QDialogButtonBox::rejected, &settings, &QDialog::reject);
+		layout->addRow(buttons);
+		if (settings.exec() != QDialog::Accepted)
+			return;
+		for (size_t i = 0; i < fields.size(); i++)
+			config_set_string(config, "SceneCollectionManager", fields[i].first,
+					  edits[i]->text().trimmed().toUtf8().constData());
+		backupStorageType = "s3";
+		config_set_string(config, "SceneCollectionManager", "BackupStorage", backupStorageType.c_str());
+		CreateBackupStorage();
 		on_sceneCollectionList_currentRowChanged(ui->sceneCollectionList->currentRow());
 	});
 
 	m.exec(QCursor::pos());
 }
 
+void SceneCollectionManagerDialog::on_actionCleanUpBackups_triggered()
+{
+	const auto scenesDir = SceneCollectionsPath();
+	const auto backupDir = customBackupDir;
+	const auto current = CurrentSceneCollectionFile();
+	auto orphans = std::make_shared<std::vector<OrphanEntry>>();
+	QPointer<SceneCollectionManagerDialog> dialog(this);
+	RunInParallel({[scenesDir, backupDir, current, orphans] { *orphans = FindOrphans(scenesDir, backupDir, current); }},
+		      [dialog, orphans] {
+			      if (!dialog)
+				      return;
+			      QMessageBox box(dialog);
+			      box.setWindowTitle(QString::fromUtf8(obs_module_text("CleanUp")));
+			      if (orphans->empty()) {
+				      box.setIcon(QMessageBox::Information);
+				      box.setText(QString::fromUtf8(obs_module_text("NoOrphans")));
+				      box.exec();
+				      return;
+			      }
+			      uint64_t bytes = 0;
+			      QString details;
+			      for (const auto &orphan : *orphans) {
+				      bytes += orphan.bytes;
+				      details += QString::fromUtf8(orphan.path.c_str()) + " (" +
+						 QLocale().formattedDataSize((qint64)orphan.bytes) + ")\n";
+			      }
+			      box.setIcon(QMessageBox::Question);
+			      box.setText(QString::fromUtf8(obs_module_text("OrphansFound"))
+						  .arg((qulonglong)orphans->size())
+						  .arg(QLocale().formattedDataSize((qint64)bytes)));
+			      box.setDetailedText(details);
+			      QPushButton *yes = box.addButton(QString::fromUtf8(obs_module_text("Yes")), QMessageBox::YesRole);
+			      box.setDefaultButton(yes);
+			      box.addButton(QString::fromUtf8(obs_module_text("No")), QMessageBox::NoRole);
+			      box.exec();
+			      if (box.clickedButton() != yes)
+				      return;
+			      const int64_t now = (int64_t)time(nullptr) + 1;
+			      QThreadPool::globalInstance()->start([orphans, now] { RemoveOrphans(*orphans, now); });
+		      });
+}
+
 void SceneCollectionManagerDialog::on_actionRenameBackup_triggered()
 {
 	if (const auto item = ui->sceneCollectionList->currentItem()) {
@@ -1526,47 +1804,90 @@ void SceneCollectionManagerDialog::on_actionRenameBackup_triggered()
 		if (!filename.length())
 			return;
 
-		if (auto backupItem = ui->backupList->currentItem()) {
-			const auto backupDir = GetBackupDirectory(filename);
-			std::string safeName;
-			if (!GetFileSafeName(backupItem->text().toUtf8().constData(), safeName))
+		const auto backupIndex = ui->backupList->currentIndex();
+		if (backupIndex.isValid()) {
+			const auto storage = GetBackupStorage();
+			if (!storage)
 				return;
 
-			const auto backupFile = backupDir + safeName + ".json";
-
+			const auto backupName = QString::fromUtf8(backupModel->GetName(backupIndex.row()).c_str());
 			bool ok;
 			QString text = QInputDialog::getText(this, QString::fromUtf8(obs_module_text("RenameBackup")),
 							     QString::fromUtf8(obs_module_text("NewName")), QLineEdit::Normal,
-							     backupItem->text(), &ok);
-			if (!ok || text.isEmpty() || text == backupItem->text())
-				return;
-
-			auto t = text.toUtf8();
-			auto c = t.constData();
-
-			std::string newSafeName;
-			if (!GetFileSafeName(c, newSafeName))
-				return;
-
-			std::string filePath = backupDir;
-			filePath += newSafeName;
-			filePath += ".json";
-
-			if (os_file_exists(filePath.c_str()))
+							     backupName, &ok);
+			if (!ok || text.isEmpty() || text == backupName)
 				return;
 
-			auto *data = obs_data_create_from_json_file(backupFile.c_str());
-
-			obs_data_set_string(data, "name", c);
-
-			obs_data_save_json(data, filePath.c_str());
-			obs_data_release(data);
-			os_unlink(backupFile.c_str());
-			on_sceneCollectionList_currentRowChanged(ui->sceneCollectionList->currentRow());
+			/* a remote storage downloads and uploads the backup again */
+			const std::string from = backupName.toUtf8().constData();
+			const std::string to = text.toUtf8().constData();
+			QPointer<SceneCollectionManagerDialog> dialog(this);
+			RunInParallel({[storage, filename, from, to] { storage->Rename(filename, from, to); }}, [dialog, filename] {
+				if (dialog)
+					dialog->RefreshBackups(filename);
+			});
 		}
 	}
 }
 
+void SceneCollectionManagerDialog::on_actionCompareBackup_triggered()
+{
+	const auto item = ui->sceneCollectionList->currentItem();
+	if (!item)
+		return;
+	const auto filename = scene_collections.at(item->text());
+	if (!filename.length())
+		return;
+	const auto storage = GetBackupStorage();
+	if (!storage)
+		return;
+	/* one backup is compared with the current state, two with each other from the older to the newer one */
+	auto rows = SelectedBackupRows();
+	if (rows.empty())
+		return;
+	if (rows.size() > 2)
+		rows.resize(2);
+	std::vector<BackupFile> backups;
+	for (const int row : rows)
+		backups.push_back(backupModel->GetBackup(row));
+
+	auto diff = std::make_shared<SceneCollectionDiff>();
+	QPointer<SceneCollectionManagerDialog> dialog(this);
+	RunInParallel({[storage, filename, backups, diff]() mutable {
+			      /* rows the view did not load yet have no time, so the order is taken from the backups themselves */
+			      if (backups.size() == 2) {
+				      for (auto &backup : backups) {
+					      if (backup.modified == 0 && backup.size == 0)
+						      storage->Stat(filename, backup, false);
+				      }
+				      if (backups[0].modified > backups[1].modified)
+					      std::swap(backups[0], backups[1]);
+			      }
+			      obs_data_t *from = storage->Load(filename, backups[0].name);
+			      obs_data_t *to = backups.size() > 1 ? storage->Load(filename, backups[1].name)
+								   : obs_data_create_from_json_file_safe(filename.c_str(), "bak");
+			      *diff = DiffSceneCollections(from, to);
+			      obs_data_release(from);
+			      obs_data_release(to);
+		      }},
+		      [dialog, diff] {
+			      if (!dialog)
+				      return;
+			      QMessageBox box(dialog);
+			      box.setIcon(diff->loaded ? QMessageBox::Information : QMessageBox::Warning);
+			      box.setWindowTitle(QString::fromUtf8(obs_module_text("Compare")));
+			      if (!diff->loaded) {
+				      box.setText(QString::fromUtf8(obs_module_text("CompareFailed")));
+			      } else if (diff->changes.empty()) {
+				      box.setText(QString::fromUtf8(obs_module_text("NoDifferences")));
+			      } else {
+				      box.setText(QString::fromUtf8(obs_module_text("Differences")).arg((qulonglong)diff->changes.size()));
+				      box.setDetailedText(QString::fromUtf8(FormatSceneCollectionDiff(*diff).c_str()));
+			      }
+			      box.exec();
+		      });
+}
+
 void SceneCollectionManagerDialog::on_actionSwitchBackup_triggered()
 {
 
@@ -1575,52 +1896,123 @@ void SceneCollectionManagerDialog::on_actionSwitchBackup_triggered()
 		if (!filename.length())
 			return;
 
-		if (auto backupItem = ui->backupList->currentItem()) {
-			const auto backupDir = GetBackupDirectory(filename);
-			std::string safeName;
-			if (!GetFileSafeName(backupItem->text().toUtf8().constData(), safeName))
-				return;
-
-			const auto backupFile = backupDir + safeName + ".json";
-			LoadBackupSceneCollection(item->text().toUtf8().constData(), filename, backupFile);
-		}
+		const auto backupIndex = ui->backupList->currentIndex();
+		if (!backupIndex.isValid())
+			return;
+		const std::string sceneCollection = item->text().toUtf8().constData();
+		const auto backupName = backupModel->GetName(backupIndex.row());
+		const uint64_t started = metrics.Start();
+		const auto load = [sceneCollection, filename, backupName, started](std::function<void()> finished) {
+			LoadBackupSceneCollection(sceneCollection, filename, backupName, [started, finished] {
+				metrics.ObserveSince(MetricHistogram::Switch, started);
+				finished();
+			});
+		};
+		operationDispatcher.DispatchAsync("load backup " + backupName, load);
 	}
 }
 
 void SceneCollectionManagerDialog::on_sceneCollectionList_currentRowChanged(int currentRow)
 {
-	ui->backupList->clear();
+	backupModel->Clear();
+	infoRequest->fetch_add(1);
+	ShowSceneCollectionInfo(nullptr);
 	if (currentRow <= -1)
 		return;
 	if (const auto item = ui->sceneCollectionList->currentItem()) {
 		const auto filename = scene_collections.at(item->text());
 		if (!filename.length())
 			return;
-		auto backupDir = GetBackupDirectory(filename);
-		auto f = backupDir + "*.json";
-		os_glob_t *glob;
-		if (os_glob(f.c_str(), 0, &glob) != 0) {
-			return;
-		}
-		for (size_t i = 0; i < glob->gl_pathc; i++) {
-			const char *filePath = glob->gl_pathv[i].path;
+		RefreshBackups(filename);
+		RequestSceneCollectionInfo(filename);
+	}
+}
 
-			if (glob->gl_pathv[i].directory)
-				continue;
-			auto *data = obs_data_create_from_json_file_safe(filePath, "bak");
-			std::string name = obs_data_get_string(data, "name");
-			obs_data_release(data);
+void SceneCollectionManagerDialog::RefreshBackups(const std::string &filename)
+{
+	const auto item = ui->sceneCollectionList->currentItem();
+	if (!item)
+		return;
+	const auto collection = scene_collections.find(item->text());
+	if (collection == scene_collections.end() || collection->second != filename)
+		return;
+	const auto storage = GetBackupStorage();
+	if (!storage)
+		return;
+	const auto currentIndex = ui->backupList->currentIndex();
+	const auto current = currentIndex.isValid() ? backupModel->GetName(currentIndex.row()) : std::string();
+	backupModel->SetBackups(storage, filename);
+	const int row = current.empty() ? -1 : backupModel->FindRow(current);
+	if (row >= 0)
+		ui->backupList->setCurrentIndex(backupModel->index(row, BackupListModel::Name));
+}
 
-			/* if no name found, use the file name as the name
-			 * (this only happens when switching to the new version) */
-			if (name.empty()) {
-				name = strrchr(filePath, '/') + 1;
-				name.resize(name.size() - 5);
-			}
-			ui->backupList->addItem(QString::fromUtf8(name.c_str()));
-		}
-		os_globfree(glob);
+std::vector<int> SceneCollectionManagerDialog::SelectedBackupRows() const
+{
+	std::vector<int> rows;
+	for (const auto &index : ui->backupList->selectionModel()->selectedRows())
+		rows.push_back(index.row());
+	if (rows.empty() && ui->backupList->currentIndex().isValid())
+		rows.push_back(ui->backupList->currentIndex().row());
+	std::sort(rows.begin(), rows.end());
+	return rows;
+}
+
+void SceneCollectionManagerDialog::RequestSceneCollectionInfo(const std::string &filename)
+{
+	const auto backupDir = GetBackupDirectory(filename);
+	const auto cached = infoCache.find(filename);
+	if (cached != infoCache.end() && cached->second.modified == GetModifiedTime(filename) &&
+	    cached->second.backups_modified == GetModifiedTime(backupDir)) {
+		ShowSceneCollectionInfo(&cached->second);
+		return;
+	}
+	const auto request = infoRequest;
+	const uint64_t generation = request->load();
+	auto info = std::make_shared<SceneCollectionInfo>();
+	auto success = std::make_shared<bool>(false);
+	QPointer<SceneCollectionManagerDialog> dialog(this);
+	RunInParallel({[filename, backupDir, request, generation, info, success] {
+			      *success = GetSceneCollectionInfo(filename, backupDir, *info,
+								[request, generation] { return request->load() != generation; });
+		      }},
+		      [dialog, filename, request, generation, info, success] {
+			      if (!dialog || !*success)
+				      return;
+			      auto &cached = dialog->infoCache[filename];
+			      cached = *info;
+			      if (request->load() == generation)
+				      dialog->ShowSceneCollectionInfo(&cached);
+		      });
+}
+
+void SceneCollectionManagerDialog::ShowSceneCollectionInfo(const SceneCollectionInfo *info)
+{
+	if (!info) {
+		ui->sceneCollectionInfo->clear();
+		return;
 	}
+	const QLocale locale;
+	std::vector<std::pair<std::string, size_t>> types(info->source_types.begin(), info->source_types.end());
+	std::sort(types.begin(), types.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+	QStringList typeList;
+	for (const auto &type : types)
+		typeList.append(QString::fromUtf8(type.first.c_str()) + " " + QString::number(type.second));
+	QStringList lines;
+	lines.append(QString::fromUtf8(obs_module_text("InfoSize"))
+			     .arg(locale.formattedDataSize((qint64)info->size),
+				  locale.toString(QDateTime::fromSecsSinceEpoch(info->modified), QLocale::ShortFormat)));
+	lines.append(QString::fromUtf8(obs_module_text("InfoCounts"))
+			     .arg((qulonglong)info->scenes)
+			     .arg((qulonglong)info->sources)
+			     .arg((qulonglong)info->filters)
+			     .arg((qulonglong)info->files));
+	lines.append(QString::fromUtf8(obs_module_text("InfoBackups"))
+			     .arg((qulonglong)info->backups)
+			     .arg(locale.formattedDataSize((qint64)info->backup_bytes)));
+	if (!typeList.isEmpty())
+		lines.append(typeList.join(", "));
+	ui->sceneCollectionInfo->setText(lines.join("\n"));
 }
 
 void SceneCollectionManagerDialog::on_sceneCollectionList_itemDoubleClicked(QListWidgetItem *item)
@@ -1629,62 +2021,41 @@ void SceneCollectionManagerDialog::on_sceneCollectionList_itemDoubleClicked(QLis
 	QMetaObject::invokeMethod(this, "on_actionSwitchSceneCollection_triggered", Qt::QueuedConnection);
 }
 
-void SceneCollectionManagerDialog::on_backupList_itemDoubleClicked(QListWidgetItem *item)
+void SceneCollectionManagerDialog::on_backupList_doubleClicked(const QModelIndex &index)
 {
-	UNUSED_PARAMETER(item);
+	UNUSED_PARAMETER(index);
 	QMetaObject::invokeMethod(this, "on_actionSwitchBackup_triggered", Qt::QueuedConnection);
 }
 
 void SceneCollectionManagerDialog::ReadSceneCollections()
 {
-	std::string path = SceneCollectionsPath() + "*.json";
+	std::string path = SceneCollectionsPath();
 	if (path.empty()) {
 		blog(LOG_WARNING, "Failed to get scene collections path");
 		return;
 	}
-	os_glob_t *glob;
-	if (os_glob(path.c_str(), 0, &glob) != 0) {
-		blog(LOG_WARNING, "Failed to glob scene collections in:%s", path.c_str());
-		return;
-	}
 	scene_collections.clear();
-
-	for (size_t i = 0; i < glob->gl_pathc; i++) {
-		const char *filePath = glob->gl_pathv[i].path;
-
-		if (glob->gl_pathv[i].directory)
-			continue;
-
-		auto *data = obs_data_create_from_json_file_safe(filePath, "bak");
-		if (!data)
-			continue;
-		std::string name = obs_data_get_string(data, "name");
-		obs_data_release(data);
-
-		/* if no name found, use the file name as the name
-		 * (this only happens when switching to the new version) */
-		if (name.empty()) {
-			auto p = strrchr(filePath, '/');
-			if (!p)
-				p = strrchr(filePath, '\\');
-			if (p)
-				name = p + 1;
-			else
-				name = filePath;
-			if (name.size() > 5)
-				name.resize(name.size() - 5);
-		}
-		scene_collections[QString::fromUtf8(name.c_str())] = filePath;
-	}
-	os_globfree(glob);
+	const uint64_t started = metrics.Start();
+	const auto collections = EnumerateSceneCollections(path);
+	metrics.ObserveSince(MetricHistogram::Enumeration, started);
+	for (const auto &collection : collections)
+		scene_collections[QString::fromUtf8(collection.first.c_str())] = collection.second;
 }
 
 SceneCollectionManagerDialog::SceneCollectionManagerDialog(QMainWindow *parent)
 	: QDialog(parent),
-	  ui(new Ui::SceneCollectionManagerDialog)
+	  ui(new Ui::SceneCollectionManagerDialog),
+	  infoRequest(std::make_shared<std::atomic<uint64_t>>(0)),
+	  backupModel(new BackupListModel(this))
 {
 	ui->setupUi(this);
 
+	ui->backupList->setModel(backupModel);
+	ui->backupList->sortByColumn(BackupListModel::Name, Qt::AscendingOrder);
+	ui->backupList->horizontalHeader()->setSectionResizeMode(BackupListModel::Name, QHeaderView::Stretch);
+	/* rows all have the same height so the view never measures the rows it does not show */
+	ui->backupList->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+
 	auto title = QString::fromUtf8(obs_module_text("SceneCollectionManager"));
 	title += " " PROJECT_VERSION;
 	setWindowTitle(title);
@@ -1734,4 +2105,7 @@ SceneCollectionManagerDialog::SceneCollectionManagerDialog(QMainWindow *parent)
 	RefreshSceneCollections();
 }
 
-SceneCollectionManagerDialog::~SceneCollectionManagerDialog() {}
+SceneCollectionManagerDialog::~SceneCollectionManagerDialog()
+{
+	infoRequest->fetch_add(1);
+}
@@ -5,29 +5,30 @@
 #include <QDialog>
 #include <QWidget>
 #include <QMainWindow>
+#include <atomic>
 #include <memory>
 #include "obs.h"
+#include "scene-collection-backup-model.hpp"
+#include "scene-collection-info.hpp"
+#include "scene-collection-trash.hpp"
 
 class SceneCollectionManagerDialog : public QDialog {
 	Q_OBJECT
 private:
 	std::unique_ptr<Ui::SceneCollectionManagerDialog> ui;
 	std::map<QString, std::string> scene_collections;
+	std::vector<TrashEntry> lastRemoved;
+	/* bumped on every selection change so a running info request can stop */
+	std::shared_ptr<std::atomic<uint64_t>> infoRequest;
+	std::map<std::string, SceneCollectionInfo> infoCache;
+	BackupListModel *backupModel;
 	void ReadSceneCollections();
 	void RefreshSceneCollections();
-	void import_parts(obs_data_t *data, const char *dir);
-	void try_fix_paths(obs_data_t *data, const char *dir,
-			   char *path_buffer);
-	bool replace_source(obs_data_t *s, const char *id, const char *find,
-			    const char *replace, bool cs = true);
-	void replace_os_specific(obs_data_t *data);
-	void replace_gdi_sceneitem_transform(obs_data_t *item,
-					 std::map<std::string, obs_data_t *> gdi_sources);
-	void make_source_mac(obs_data_t *data);
-	void make_source_windows(obs_data_t *data);
-	void make_source_linux(obs_data_t *data);
-	void export_local_files(obs_data_t *data, std::string dir,
-				std::string subdir);
+	void RestoreSceneCollections(const std::vector<TrashEntry> &entries);
+	void RequestSceneCollectionInfo(const std::string &filename);
+	void ShowSceneCollectionInfo(const SceneCollectionInfo *info);
+	/* the rows of the selected backups from top to bottom, or the current one when none are selected */
+	std::vector<int> SelectedBackupRows() const;
 private slots:
 	void on_searchSceneCollectionEdit_textChanged(const QString &text);
 
@@ -39,20 +40,27 @@ private slots:
 	void on_actionConfigSceneCollection_triggered();
 	void on_actionRenameSceneCollection_triggered();
 	void on_actionExportSceneCollection_triggered();
+	void on_actionConversionPreview_triggered();
+	void on_actionFindMissingMedia_triggered();
+	void on_actionMergeSceneCollection_triggered();
 	void on_actionSwitchSceneCollection_triggered();
 
 	void on_actionAddBackup_triggered();
 	void on_actionRemoveBackup_triggered();
 	void on_actionConfigBackup_triggered();
 	void on_actionRenameBackup_triggered();
+	void on_actionCompareBackup_triggered();
+	void on_actionCleanUpBackups_triggered();
 	void on_actionSwitchBackup_triggered();
 
 	void on_sceneCollectionList_currentRowChanged(int currentRow);
 	void on_sceneCollectionList_itemDoubleClicked(QListWidgetItem *item);
 
-	void on_backupList_itemDoubleClicked(QListWidgetItem *item);
+	void on_backupList_doubleClicked(const QModelIndex &index);
 
 public:
 	SceneCollectionManagerDialog(QMainWindow *parent = nullptr);
 	~SceneCollectionManagerDialog();
+	/* lists the backups again when filename is the selected scene collection */
+	void RefreshBackups(const std::string &filename);
 };
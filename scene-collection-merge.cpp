@@ -0,0 +1,346 @@
+#include "scene-collection-merge.hpp"
+
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "util/base.h"
+#include "util/bmem.h"
+#include "util/platform.h"
+
+struct MergeTarget {
+	/* "sources", "groups" or "transitions" */
+	const char *array;
+	size_t index;
+	std::string uuid;
+};
+
+struct MergeName {
+	std::string name;
+	std::string uuid;
+	/* only copied when it does not exist in the target or replaces it there */
+	bool copy = true;
+	bool overwrite = false;
+};
+
+static std::string NewUuid()
+{
+	char *uuid = os_generate_uuid();
+	std::string str = uuid;
+	bfree(uuid);
+	return str;
+}
+
+static bool IsSceneOrGroup(obs_data_t *source)
+{
+	const char *id = obs_data_get_string(source, "id");
+	return strcmp(id, "scene") == 0 || strcmp(id, "group") == 0;
+}
+
+/* calls fn with every object in the array, the object is only valid during the call */
+template<typename F> static void ForEachObject(obs_data_t *data, const char *name, F fn)
+{
+	obs_data_array_t *array = obs_data_get_array(data, name);
+	const size_t count = obs_data_array_count(array);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_array_item(array, i);
+		if (obj)
+			fn(obj, i);
+		obs_data_release(obj);
+	}
+	obs_data_array_release(array);
+}
+
+/* settings keys that name another source in OBS and common plugins, other strings like the content of a text source are
+ * left alone even when they happen to be the name of a source */
+static bool IsSourceReferenceKey(const char *key)
+{
+	static const char *keys[] = {"source",          "sidechain_source", "audio_source", "clone",
+				     "source_name",     "scene",            "mask_source",  "background_source",
+				     "target_source",   "filter_source",    "replay_source"};
+	for (const char *k : keys) {
+		if (strcmp(key, k) == 0)
+			return true;
+	}
+	return false;
+}
+
+/* the settings of the source and its filters that reference another source by name */
+template<typename F> static void ForEachSourceReference(obs_data_t *source, F fn)
+{
+	auto strings = [&fn](obs_data_t *owner) {
+		obs_data_t *settings = obs_data_get_obj(owner, "settings");
+		std::vector<std::string> keys;
+		obs_data_item_t *item = obs_data_first(settings);
+		for (; item; obs_data_item_next(&item)) {
+			if (obs_data_item_gettype(item) == OBS_DATA_STRING && IsSourceReferenceKey(obs_data_item_get_name(item)))
+				keys.emplace_back(obs_data_item_get_name(item));
+		}
+		/* fn may change the value, which is not safe while iterating the items */
+		for (const auto &key : keys)
+			fn(settings, key.c_str());
+		obs_data_release(settings);
+	};
+	strings(source);
+	ForEachObject(source, "filters", [&strings](obs_data_t *filter, size_t) { strings(filter); });
+}
+
+class SceneCollectionMerger {
+public:
+	SceneCollectionMerger(obs_data_t *target, obs_data_t *source, MergeConflict conflict)
+		: target(target),
+		  source(source),
+		  conflict(conflict)
+	{
+	}
+	~SceneCollectionMerger()
+	{
+		for (auto &it : sources)
+			obs_data_release(it.second);
+		for (auto &it : transitions)
+			obs_data_release(it.second);
+	}
+
+	MergeStats Merge(const std::vector<std::string> &scenes);
+
+private:
+	obs_data_t *target;
+	obs_data_t *source;
+	MergeConflict conflict;
+	MergeStats stats;
+
+	std::unordered_map<std::string, obs_data_t *> sources;
+	std::unordered_map<std::string, obs_data_t *> transitions;
+	std::unordered_map<std::string, MergeTarget> targetSources;
+	std::unordered_map<std::string, MergeTarget> targetTransitions;
+	std::unordered_set<std::string> targetUuids;
+	std::unordered_map<std::string, MergeName> sourceNames;
+	std::unordered_map<std::string, MergeName> transitionNames;
+
+	void Index();
+	void Resolve(const std::string &name, bool group, const std::unordered_map<std::string, MergeTarget> &existing,
+		     std::unordered_set<std::string> &taken, std::unordered_map<std::string, MergeName> &names, obs_data_t *data);
+	obs_data_t *Copy(obs_data_t *data, const MergeName &name);
+	void Insert(obs_data_t *copy, const char *array, const MergeName &name, std::unordered_map<std::string, MergeTarget> &existing,
+		    const std::string &original);
+};
+
+void SceneCollectionMerger::Index()
+{
+	auto add = [this](const char *array, std::unordered_map<std::string, obs_data_t *> *from,
+			  std::unordered_map<std::string, MergeTarget> *to) {
+		if (from) {
+			ForEachObject(source, array, [from](obs_data_t *obj, size_t) {
+				obs_data_addref(obj);
+				auto &slot = (*from)[obs_data_get_string(obj, "name")];
+				obs_data_release(slot);
+				slot = obj;
+			});
+		}
+		ForEachObject(target, array, [this, array, to](obs_data_t *obj, size_t i) {
+			const char *uuid = obs_data_get_string(obj, "uuid");
+			(*to)[obs_data_get_string(obj, "name")] = {array, i, uuid};
+			targetUuids.insert(uuid);
+			ForEachObject(obj, "filters",
+				      [this](obs_data_t *filter, size_t) { targetUuids.insert(obs_data_get_string(filter, "uuid")); });
+		});
+	};
+	add("sources", &sources, &targetSources);
+	add("groups", &sources, &targetSources);
+	add("transitions", &transitions, &targetTransitions);
+	targetUuids.erase("");
+}
+
+/* taken has the names of everything that is merged, so a new name does not clash with one of those either */
+void SceneCollectionMerger::Resolve(const std::string &name, bool group, const std::unordered_map<std::string, MergeTarget> &existing,
+				    std::unordered_set<std::string> &taken, std::unordered_map<std::string, MergeName> &names,
+				    obs_data_t *data)
+{
+	MergeName resolved{name, obs_data_get_string(data, "uuid")};
+	const auto it = existing.find(name);
+	/* a source and a group with the same name can not replace each other */
+	const bool sameKind = it != existing.end() && (strcmp(it->second.array, "groups") == 0) == group;
+	if (it != existing.end() && conflict == MergeConflict::Skip) {
+		resolved.uuid = it->second.uuid;
+		resolved.copy = false;
+		stats.skipped++;
+	} else if (it != existing.end() && conflict == MergeConflict::Overwrite && sameKind) {
+		resolved.uuid = it->second.uuid;
+		resolved.overwrite = true;
+		stats.overwritten++;
+	} else if (it != existing.end()) {
+		for (int n = 2;; n++) {
+			resolved.name = name + " " + std::to_string(n);
+			if (!existing.count(resolved.name) && !taken.count(resolved.name))
+				break;
+		}
+		taken.insert(resolved.name);
+		stats.renamed++;
+	} else {
+		stats.added++;
+	}
+	if (resolved.copy && !resolved.overwrite && !resolved.uuid.empty() && targetUuids.count(resolved.uuid))
+		resolved.uuid = NewUuid();
+	names[name] = resolved;
+}
+
+obs_data_t *SceneCollectionMerger::Copy(obs_data_t *data, const MergeName &name)
+{
+	obs_data_t *copy = obs_data_create_from_json(obs_data_get_json(data));
+	obs_data_set_string(copy, "name", name.name.c_str());
+	if (!name.uuid.empty())
+		obs_data_set_string(copy, "uuid", name.uuid.c_str());
+
+	/* scene items point at their source by name and uuid */
+	if (IsSceneOrGroup(copy)) {
+		obs_data_t *settings = obs_data_get_obj(copy, "settings");
+		ForEachObject(settings, "items", [this](obs_data_t *item, size_t) {
+			const auto it = sourceNames.find(obs_data_get_string(item, "name"));
+			if (it == sourceNames.end())
+				return;
+			obs_data_set_string(item, "name", it->second.name.c_str());
+			if (obs_data_has_user_value(item, "source_uuid"))
+				obs_data_set_string(item, "source_uuid", it->second.uuid.c_str());
+		});
+		obs_data_release(settings);
+	}
+	ForEachSourceReference(copy, [this](obs_data_t *settings, const char *key) {
+		const auto it = sourceNames.find(obs_data_get_string(settings, key));
+		if (it != sourceNames.end() && it->second.name != it->first)
+			obs_data_set_string(settings, key, it->second.name.c_str());
+	});
+	ForEachObject(copy, "filters", [this](obs_data_t *filter, size_t) {
+		if (targetUuids.count(obs_data_get_string(filter, "uuid")))
+			obs_data_set_string(filter, "uuid", NewUuid().c_str());
+	});
+
+	obs_data_t *privateSettings = obs_data_get_obj(copy, "private_settings");
+	const auto transition = transitionNames.find(obs_data_get_string(privateSettings, "transition"));
+	if (transition != transitionNames.end())
+		obs_data_set_string(privateSettings, "transition", transition->second.name.c_str());
+	obs_data_release(privateSettings);
+	return copy;
+}
+
+void SceneCollectionMerger::Insert(obs_data_t *copy, const char *array, const MergeName &name,
+				   std::unordered_map<std::string, MergeTarget> &existing, const std::string &original)
+{
+	obs_data_array_t *a = obs_data_get_array(target, array);
+	if (!a) {
+		a = obs_data_array_create();
+		obs_data_set_array(target, array, a);
+	}
+	if (name.overwrite) {
+		const auto &replaced = existing.at(original);
+		obs_data_array_release(a);
+		a = obs_data_get_array(target, replaced.array);
+		obs_data_array_erase(a, replaced.index);
+		obs_data_array_insert(a, replaced.index, copy);
+	} else {
+		existing[name.name] = {array, obs_data_array_count(a), name.uuid};
+		obs_data_array_push_back(a, copy);
+	}
+	obs_data_array_release(a);
+}
+
+MergeStats SceneCollectionMerger::Merge(const std::vector<std::string> &scenes)
+{
+	Index();
+
+	/* dependency closure of the selected scenes, breadth first */
+	std::vector<std::string> closure;
+	std::unordered_set<std::string> seen;
+	std::unordered_set<std::string> neededTransitions;
+	std::deque<std::string> queue(scenes.begin(), scenes.end());
+	while (!queue.empty()) {
+		const std::string name = queue.front();
+		queue.pop_front();
+		const auto it = sources.find(name);
+		if (it == sources.end() || !seen.insert(name).second)
+			continue;
+		closure.push_back(name);
+		obs_data_t *data = it->second;
+		if (IsSceneOrGroup(data)) {
+			obs_data_t *settings = obs_data_get_obj(data, "settings");
+			ForEachObject(settings, "items",
+				      [&queue](obs_data_t *item, size_t) { queue.emplace_back(obs_data_get_string(item, "name")); });
+			obs_data_release(settings);
+		}
+		ForEachSourceReference(data, [this, &queue, &name](obs_data_t *settings, const char *key) {
+			const char *value = obs_data_get_string(settings, key);
+			if (name != value && sources.count(value))
+				queue.emplace_back(value);
+		});
+		obs_data_t *privateSettings = obs_data_get_obj(data, "private_settings");
+		const char *transition = obs_data_get_string(privateSettings, "transition");
+		if (transitions.count(transition))
+			neededTransitions.insert(transition);
+		obs_data_release(privateSettings);
+	}
+
+	/* names are resolved before copying so every reference can be pointed at its final name */
+	std::unordered_set<std::string> taken(closure.begin(), closure.end());
+	for (const auto &name : closure) {
+		obs_data_t *data = sources.at(name);
+		Resolve(name, strcmp(obs_data_get_string(data, "id"), "group") == 0, targetSources, taken, sourceNames, data);
+	}
+	taken = std::unordered_set<std::string>(neededTransitions.begin(), neededTransitions.end());
+	for (const auto &name : neededTransitions)
+		Resolve(name, false, targetTransitions, taken, transitionNames, transitions.at(name));
+
+	for (const auto &name : neededTransitions) {
+		const auto &resolved = transitionNames.at(name);
+		if (!resolved.copy)
+			continue;
+		obs_data_t *copy = Copy(transitions.at(name), resolved);
+		Insert(copy, "transitions", resolved, targetTransitions, name);
+		obs_data_release(copy);
+	}
+	obs_data_array_t *sceneOrder = obs_data_get_array(target, "scene_order");
+	if (!sceneOrder) {
+		sceneOrder = obs_data_array_create();
+		obs_data_set_array(target, "scene_order", sceneOrder);
+	}
+	for (const auto &name : closure) {
+		const auto &resolved = sourceNames.at(name);
+		if (!resolved.copy)
+			continue;
+		obs_data_t *data = sources.at(name);
+		const bool group = strcmp(obs_data_get_string(data, "id"), "group") == 0;
+		obs_data_t *copy = Copy(data, resolved);
+		Insert(copy, group ? "groups" : "sources", resolved, targetSources, name);
+		obs_data_release(copy);
+		if (!resolved.overwrite && strcmp(obs_data_get_string(data, "id"), "scene") == 0) {
+			obs_data_t *order = obs_data_create();
+			obs_data_set_string(order, "name", resolved.name.c_str());
+			obs_data_array_push_back(sceneOrder, order);
+			obs_data_release(order);
+		}
+	}
+	obs_data_array_release(sceneOrder);
+	return stats;
+}
+
+std::vector<std::string> GetSceneNames(obs_data_t *data)
+{
+	std::vector<std::string> names;
+	ForEachObject(data, "scene_order", [&names](obs_data_t *order, size_t) { names.emplace_back(obs_data_get_string(order, "name")); });
+	if (!names.empty())
+		return names;
+	ForEachObject(data, "sources", [&names](obs_data_t *source, size_t) {
+		if (strcmp(obs_data_get_string(source, "id"), "scene") == 0)
+			names.emplace_back(obs_data_get_string(source, "name"));
+	});
+	return names;
+}
+
+MergeStats MergeSceneCollection(obs_data_t *target, obs_data_t *source, const std::vector<std::string> &scenes,
+				MergeConflict conflict)
+{
+	SceneCollectionMerger merger(target, source, conflict);
+	const auto stats = merger.Merge(scenes);
+	blog(LOG_INFO, "[Scene Collection Manager] merged %zu scenes, %zu added, %zu renamed, %zu skipped, %zu overwritten",
+	     scenes.size(), stats.added, stats.renamed, stats.skipped, stats.overwritten);
+	return stats;
+}
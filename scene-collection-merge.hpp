@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "obs.h"
+
+enum class MergeConflict { Rename, Skip, Overwrite };
+
+struct MergeStats {
+	size_t added = 0;
+	size_t renamed = 0;
+	size_t skipped = 0;
+	size_t overwritten = 0;
+};
+
+/* the scenes of a scene collection in scene order */
+std::vector<std::string> GetSceneNames(obs_data_t *data);
+
+/* copies the scenes from source into target together with everything they need: nested scenes, groups, sources,
+ * sources named in settings and scene transitions, filters come with their source. A name that already exists in
+ * target is renamed, skipped or overwritten, references inside the merged objects follow the chosen name and uuid */
+MergeStats MergeSceneCollection(obs_data_t *target, obs_data_t *source, const std::vector<std::string> &scenes,
+				MergeConflict conflict);
@@ -0,0 +1,125 @@
+#include "scene-collection-metrics.hpp"
+
+#include <cstdio>
+#include "scene-collection-core.hpp"
+#include "util/platform.h"
+
+/* upper bounds in seconds, the last bucket is +Inf */
+static const double histogramBounds[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0};
+static_assert(sizeof(histogramBounds) / sizeof(histogramBounds[0]) + 1 == 11, "one bucket per bound and +Inf");
+
+struct MetricInfo {
+	const char *name;
+	const char *help;
+};
+
+static const MetricInfo counterInfo[] = {
+	{"scene_collection_manager_backups_total", "Backups written"},
+	{"scene_collection_manager_backup_bytes_total", "Bytes of backups written"},
+	{"scene_collection_manager_retention_deletions_total", "Automatic backups removed by retention"},
+};
+
+static const MetricInfo histogramInfo[] = {
+	{"scene_collection_manager_backup_write_seconds", "Time to write a backup"},
+	{"scene_collection_manager_dialog_open_seconds", "Time to open the scene collection manager"},
+	{"scene_collection_manager_enumeration_seconds", "Time to list the scene collections"},
+	{"scene_collection_manager_import_seconds", "Time to import scene collections"},
+	{"scene_collection_manager_export_seconds", "Time to export scene collections"},
+	{"scene_collection_manager_switch_seconds", "Time from asking for a scene collection or backup until it is loaded"},
+};
+
+static std::string EscapeLabel(const std::string &value)
+{
+	std::string escaped;
+	for (const char c : value) {
+		if (c == '\\' || c == '"')
+			escaped += '\\';
+		if (c == '\n') {
+			escaped += "\\n";
+			continue;
+		}
+		escaped += c;
+	}
+	return escaped;
+}
+
+static std::string FormatNumber(double value)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.9g", value);
+	return buffer;
+}
+
+void Metrics::Add(MetricCounter counter, const std::string &collection, uint64_t value)
+{
+	if (!Enabled())
+		return;
+	const auto label = collection.empty() ? collection : GetFilenameFromPath(collection, false);
+	std::lock_guard<std::mutex> lock(mutex);
+	counters[(size_t)counter][label] += value;
+}
+
+uint64_t Metrics::Start() const
+{
+	return Enabled() ? os_gettime_ns() : 0;
+}
+
+void Metrics::ObserveSince(MetricHistogram histogram, uint64_t start)
+{
+	if (start == 0 || !Enabled())
+		return;
+	Observe(histogram, (double)(os_gettime_ns() - start) / 1000000000.0);
+}
+
+void Metrics::Observe(MetricHistogram histogram, double seconds)
+{
+	if (!Enabled())
+		return;
+	size_t bucket = 0;
+	while (bucket < sizeof(histogramBounds) / sizeof(histogramBounds[0]) && seconds > histogramBounds[bucket])
+		bucket++;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto &h = histograms[(size_t)histogram];
+	h.buckets[bucket]++;
+	h.count++;
+	h.sum += seconds;
+}
+
+std::string Metrics::Format() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string text;
+	for (size_t i = 0; i < (size_t)MetricCounter::Count; i++) {
+		const auto &info = counterInfo[i];
+		text += std::string("# HELP ") + info.name + " " + info.help + "\n";
+		text += std::string("# TYPE ") + info.name + " counter\n";
+		for (const auto &value : counters[i]) {
+			text += info.name;
+			if (!value.first.empty())
+				text += "{collection=\"" + EscapeLabel(value.first) + "\"}";
+			text += " " + std::to_string(value.second) + "\n";
+		}
+	}
+	for (size_t i = 0; i < (size_t)MetricHistogram::Count; i++) {
+		const auto &info = histogramInfo[i];
+		const auto &h = histograms[i];
+		text += std::string("# HELP ") + info.name + " " + info.help + "\n";
+		text += std::string("# TYPE ") + info.name + " histogram\n";
+		uint64_t cumulative = 0;
+		for (size_t b = 0; b < sizeof(h.buckets) / sizeof(h.buckets[0]); b++) {
+			cumulative += h.buckets[b];
+			const bool last = b == sizeof(histogramBounds) / sizeof(histogramBounds[0]);
+			text += std::string(info.name) + "_bucket{le=\"" + (last ? "+Inf" : FormatNumber(histogramBounds[b])) +
+				"\"} " + std::to_string(cumulative) + "\n";
+		}
+		text += std::string(info.name) + "_sum " + FormatNumber(h.sum) + "\n";
+		text += std::string(info.name) + "_count " + std::to_string(h.count) + "\n";
+	}
+	return text;
+}
+
+bool Metrics::Write(const std::string &file) const
+{
+	const auto text = Format();
+	return os_quick_write_utf8_file_safe(file.c_str(), text.c_str(), text.size(), false, "tmp", nullptr);
+}
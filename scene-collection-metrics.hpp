@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+enum class MetricCounter { Backups, BackupBytes, RetentionDeletions, Count };
+enum class MetricHistogram { BackupWrite, DialogOpen, Enumeration, Import, Export, Switch, Count };
+
+/* counters per scene collection and duration histograms, formatted as Prometheus text. While disabled nothing is
+ * recorded and Start returns 0, so an instrumented operation costs one atomic load */
+class Metrics {
+public:
+	void SetEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+	bool Enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	/* collection is the scene collection file or empty */
+	void Add(MetricCounter counter, const std::string &collection, uint64_t value = 1);
+	/* the start of a duration for ObserveSince, 0 while disabled */
+	uint64_t Start() const;
+	void ObserveSince(MetricHistogram histogram, uint64_t start);
+	void Observe(MetricHistogram histogram, double seconds);
+
+	std::string Format() const;
+	/* replaces file with the current metrics */
+	bool Write(const std::string &file) const;
+
+private:
+	struct Histogram {
+		uint64_t buckets[11] = {};
+		uint64_t count = 0;
+		double sum = 0.0;
+	};
+
+	std::atomic<bool> enabled{false};
+	mutable std::mutex mutex;
+	std::map<std::string, uint64_t> counters[(size_t)MetricCounter::Count];
+	Histogram histograms[(size_t)MetricHistogram::Count];
+};
@@ -0,0 +1,702 @@
+#include "scene-collection-s3.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <curl/curl.h>
+
+#include "scene-collection-throttle.hpp"
+#include "util/base.h"
+
+#define S3_INDEX ".index.json"
+#define S3_CONNECT_TIMEOUT 10L
+#define S3_TIMEOUT 120L
+#define S3_MAX_BACKOFF_SECONDS 60
+
+static std::string EncodeKey(const std::string &key)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	std::string encoded;
+	for (const unsigned char c : key) {
+		if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/') {
+			encoded += (char)c;
+		} else {
+			encoded += '%';
+			encoded += hex[c >> 4];
+			encoded += hex[c & 15];
+		}
+	}
+	return encoded;
+}
+
+static std::string EncodeQueryValue(const std::string &value)
+{
+	std::string encoded = EncodeKey(value);
+	std::string result;
+	for (const char c : encoded)
+		result += c == '/' ? std::string("%2F") : std::string(1, c);
+	return result;
+}
+
+static std::string XmlUnescape(std::string str)
+{
+	static const std::pair<const char *, char> entities[] = {
+		{"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}, {"&amp;", '&'}};
+	for (const auto &entity : entities) {
+		const size_t l = strlen(entity.first);
+		for (size_t pos = str.find(entity.first); pos != std::string::npos; pos = str.find(entity.first, pos + 1))
+			str.replace(pos, l, 1, entity.second);
+	}
+	return str;
+}
+
+/* the text of the first tag element between from and to, ListObjectsV2 responses are flat enough for this */
+static std::string GetXmlValue(const std::string &xml, const char *tag, size_t from = 0, size_t to = std::string::npos)
+{
+	const std::string open = std::string("<") + tag + ">";
+	const std::string close = std::string("</") + tag + ">";
+	const size_t start = xml.find(open, from);
+	if (start == std::string::npos || start >= to)
+		return "";
+	const size_t end = xml.find(close, start);
+	if (end == std::string::npos || end > to)
+		return "";
+	return XmlUnescape(xml.substr(start + open.length(), end - start - open.length()));
+}
+
+static int64_t ParseIsoTime(const std::string &str)
+{
+	struct tm tm {};
+	if (sscanf(str.c_str(), "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+		return 0;
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+#ifdef _WIN32
+	return (int64_t)_mkgmtime(&tm);
+#else
+	return (int64_t)timegm(&tm);
+#endif
+}
+
+static bool IsAutomaticBackup(const std::string &key)
+{
+	int d, t;
+	return sscanf(GetFilenameFromPath(key, true).c_str(), "%d_%d.json", &d, &t) == 2;
+}
+
+static size_t WriteResponse(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	static_cast<std::string *>(userdata)->append(ptr, size * nmemb);
+	return size * nmemb;
+}
+
+/* also called about once a second while connecting, so an abort does not wait for the connect timeout */
+static int AbortTransfer(void *aborting, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+	return static_cast<std::atomic<bool> *>(aborting)->load() ? 1 : 0;
+}
+
+S3BackupStorage::S3BackupStorage(S3Config config_, std::shared_ptr<BackupStorage> fallback_,
+				 std::function<void(const std::string &)> changed_)
+	: config(std::move(config_)),
+	  fallback(std::move(fallback_)),
+	  changed(std::move(changed_))
+{
+	static std::once_flag curlInit;
+	std::call_once(curlInit, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+	while (!config.endpoint.empty() && config.endpoint.back() == '/')
+		config.endpoint.pop_back();
+	if (!config.prefix.empty() && config.prefix.back() != '/')
+		config.prefix += "/";
+	for (size_t i = 0; i < std::max(config.uploads, (size_t)1); i++)
+		workers.emplace_back([this] { Worker(); });
+}
+
+S3BackupStorage::~S3BackupStorage()
+{
+	/* nothing is sent anymore and running transfers are aborted, so exiting does not wait on the network. Uploads that
+	 * did not finish are saved to the fallback storage and listed from there */
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		aborting = true;
+	}
+	cv.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+}
+
+std::string S3BackupStorage::GetPrefix(const std::string &collectionFile) const
+{
+	return config.prefix + GetFilenameFromPath(collectionFile, false) + "/";
+}
+
+bool S3BackupStorage::GetKey(const std::string &collectionFile, const std::string &name, std::string &key) const
+{
+	std::string safeName;
+	if (!GetFileSafeName(name.c_str(), safeName))
+		return false;
+	key = GetPrefix(collectionFile) + safeName + ".json";
+	return true;
+}
+
+long S3BackupStorage::Request(const char *method, const std::string &key, const std::string &query, const std::string *body,
+			      std::string *response, uint64_t maxSpeed, const std::string &header)
+{
+	CURL *curl = curl_easy_init();
+	if (!curl)
+		return 0;
+	std::string url = config.endpoint + "/" + EncodeKey(config.bucket) + "/" + EncodeKey(key);
+	if (!query.empty())
+		url += "?" + query;
+	/* curl signs the request with AWS Signature Version 4 */
+	const std::string sigv4 = "aws:amz:" + config.region + ":s3";
+	const std::string credentials = config.accessKey + ":" + config.secretKey;
+	std::string sink;
+	curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(curl, CURLOPT_AWS_SIGV4, sigv4.c_str());
+	curl_easy_setopt(curl, CURLOPT_USERPWD, credentials.c_str());
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, S3_CONNECT_TIMEOUT);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, S3_TIMEOUT);
+	curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, AbortTransfer);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &aborting);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteResponse);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, response ? response : &sink);
+	struct curl_slist *headers = curl_slist_append(nullptr, "Expect:");
+	/* S3 and MinIO need the payload hash header, curl signs with the value given here */
+	headers = curl_slist_append(headers, "x-amz-content-sha256: UNSIGNED-PAYLOAD");
+	if (!header.empty())
+		headers = curl_slist_append(headers, header.c_str());
+	if (body) {
+		headers = curl_slist_append(headers, "Content-Type: application/json");
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body->data());
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)body->size());
+	}
+	if (maxSpeed)
+		curl_easy_setopt(curl, CURLOPT_MAX_SEND_SPEED_LARGE, (curl_off_t)maxSpeed);
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+	long code = 0;
+	const CURLcode result = curl_easy_perform(curl);
+	if (result == CURLE_OK)
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+	else
+		blog(LOG_WARNING, "[Scene Collection Manager] %s '%s' failed: %s", method, key.c_str(), curl_easy_strerror(result));
+	curl_slist_free_all(headers);
+	curl_easy_cleanup(curl);
+	return code;
+}
+
+bool S3BackupStorage::ListObjects(const std::string &prefix, std::vector<BackupFile> &backups)
+{
+	std::string token;
+	do {
+		std::string query = "list-type=2&prefix=" + EncodeQueryValue(prefix);
+		if (!token.empty())
+			query = "continuation-token=" + EncodeQueryValue(token) + "&" + query;
+		std::string xml;
+		const long code = Request("GET", "", query, nullptr, &xml);
+		if (code != 200) {
+			blog(LOG_WARNING, "[Scene Collection Manager] listing '%s' failed with %ld", prefix.c_str(), code);
+			return false;
+		}
+		for (size_t pos = xml.find("<Contents>"); pos != std::string::npos; pos = xml.find("<Contents>", pos + 1)) {
+			const size_t end = xml.find("</Contents>", pos);
+			BackupFile backup;
+			backup.path = GetXmlValue(xml, "Key", pos, end);
+			if (backup.path.empty() || GetFilenameFromPath(backup.path, true) == S3_INDEX)
+				continue;
+			/* the name is only in the backup itself, the file name is close enough until the index is written */
+			backup.name = GetFilenameFromPath(backup.path, false);
+			backup.modified = ParseIsoTime(GetXmlValue(xml, "LastModified", pos, end));
+			backup.size = strtoull(GetXmlValue(xml, "Size", pos, end).c_str(), nullptr, 10);
+			backups.push_back(backup);
+		}
+		token = GetXmlValue(xml, "IsTruncated") == "true" ? GetXmlValue(xml, "NextContinuationToken") : "";
+	} while (!token.empty());
+	return true;
+}
+
+bool S3BackupStorage::LoadIndex(const std::string &collectionFile)
+{
+	const auto prefix = GetPrefix(collectionFile);
+	std::string json;
+	const long code = Request("GET", prefix + S3_INDEX, "", nullptr, &json);
+	std::vector<BackupFile> backups;
+	if (code == 200) {
+		obs_data_t *index = obs_data_create_from_json(json.c_str());
+		obs_data_array_t *array = obs_data_get_array(index, "backups");
+		const size_t count = obs_data_array_count(array);
+		for (size_t i = 0; i < count; i++) {
+			obs_data_t *item = obs_data_array_item(array, i);
+			backups.push_back({obs_data_get_string(item, "name"), obs_data_get_string(item, "key"),
+					   obs_data_get_int(item, "modified"), (uint64_t)obs_data_get_int(item, "size")});
+			obs_data_release(item);
+		}
+		obs_data_array_release(array);
+		obs_data_release(index);
+	} else if (code != 404 || !ListObjects(prefix, backups)) {
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &collection = collections[collectionFile];
+		/* backups saved while the index was read are not in it yet */
+		for (const auto &backup : collection.backups) {
+			if (collection.pending.count(backup.path) &&
+			    std::none_of(backups.begin(), backups.end(), [&](const BackupFile &b) { return b.path == backup.path; }))
+				backups.push_back(backup);
+		}
+		std::sort(backups.begin(), backups.end(), [](const BackupFile &a, const BackupFile &b) { return a.path < b.path; });
+		collection.backups = std::move(backups);
+		collection.loaded = true;
+		collection.loading = false;
+	}
+	cv.notify_all();
+	if (code == 404)
+		QueueIndex(collectionFile);
+	if (changed)
+		changed(collectionFile);
+	return true;
+}
+
+bool S3BackupStorage::SaveIndex(const std::string &collectionFile)
+{
+	obs_data_t *index = obs_data_create();
+	obs_data_array_t *array = obs_data_array_create();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &collection = collections[collectionFile];
+		/* changes from here on queue the index again */
+		collection.indexQueued = false;
+		for (const auto &backup : collection.backups) {
+			if (collection.pending.count(backup.path))
+				continue;
+			obs_data_t *item = obs_data_create();
+			obs_data_set_string(item, "name", backup.name.c_str());
+			obs_data_set_string(item, "key", backup.path.c_str());
+			obs_data_set_int(item, "modified", backup.modified);
+			obs_data_set_int(item, "size", (long long)backup.size);
+			obs_data_array_push_back(array, item);
+			obs_data_release(item);
+		}
+	}
+	obs_data_set_array(index, "backups", array);
+	obs_data_array_release(array);
+	const std::string json = obs_data_get_json(index);
+	obs_data_release(index);
+	const long code = Request("PUT", GetPrefix(collectionFile) + S3_INDEX, "", &json, nullptr);
+	return code >= 200 && code < 300;
+}
+
+void S3BackupStorage::EnsureLoaded(const std::string &collectionFile, bool wait)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto &collection = collections[collectionFile];
+	if (!collection.loaded && !collection.loading) {
+		collection.loading = true;
+		Task task;
+		task.run = [this, collectionFile] { return LoadIndex(collectionFile); };
+		task.failed = [this, collectionFile] {
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to read the backups of '%s'", collectionFile.c_str());
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				collections[collectionFile].loading = false;
+			}
+			cv.notify_all();
+		};
+		tasks.push_back(std::move(task));
+		cv.notify_all();
+	}
+	if (wait)
+		cv.wait(lock, [&] { return collection.loaded || !collection.loading; });
+}
+
+void S3BackupStorage::QueueIndex(const std::string &collectionFile)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &collection = collections[collectionFile];
+		if (collection.indexQueued)
+			return;
+		collection.indexQueued = true;
+	}
+	Task task;
+	task.run = [this, collectionFile] { return SaveIndex(collectionFile); };
+	task.failed = [collectionFile] {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to write the backup index of '%s'", collectionFile.c_str());
+	};
+	Queue(std::move(task));
+}
+
+void S3BackupStorage::QueueDelete(const std::string &collectionFile, const std::string &key)
+{
+	Task task;
+	task.run = [this, collectionFile, key] {
+		const long code = Request("DELETE", key, "", nullptr, nullptr);
+		if ((code < 200 || code >= 300) && code != 404)
+			return false;
+		QueueIndex(collectionFile);
+		return true;
+	};
+	task.failed = [key] { blog(LOG_WARNING, "[Scene Collection Manager] failed to remove backup '%s'", key.c_str()); };
+	Queue(std::move(task));
+}
+
+void S3BackupStorage::Queue(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	cv.notify_all();
+}
+
+void S3BackupStorage::Worker()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		if (tasks.empty()) {
+			if (stopping)
+				return;
+			cv.wait(lock);
+			continue;
+		}
+		auto next = std::min_element(tasks.begin(), tasks.end(), [](const Task &a, const Task &b) { return a.due < b.due; });
+		if (!stopping && next->due > std::chrono::steady_clock::now()) {
+			cv.wait_until(lock, next->due);
+			continue;
+		}
+		Task task = std::move(*next);
+		tasks.erase(next);
+		running++;
+		const bool run = !stopping;
+		lock.unlock();
+		const bool success = run && task.run();
+		lock.lock();
+		running--;
+		if (!success && ++task.attempt < config.retries && !stopping) {
+			const int backoff = std::min(1 << std::min(task.attempt, 6), S3_MAX_BACKOFF_SECONDS);
+			task.due = std::chrono::steady_clock::now() + std::chrono::seconds(backoff);
+			tasks.push_back(std::move(task));
+		} else if (!success && task.failed) {
+			lock.unlock();
+			task.failed();
+			lock.lock();
+		}
+		cv.notify_all();
+	}
+}
+
+void S3BackupStorage::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	cv.wait(lock, [this] { return tasks.empty() && running == 0; });
+}
+
+std::vector<BackupFile> S3BackupStorage::List(const std::string &collectionFile, bool metadata)
+{
+	/* the index has the metadata of every backup */
+	EnsureLoaded(collectionFile, false);
+	std::vector<BackupFile> backups;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		backups = collections[collectionFile].backups;
+	}
+	/* backups that could not be uploaded */
+	if (fallback) {
+		for (auto &backup : fallback->List(collectionFile, metadata)) {
+			if (std::none_of(backups.begin(), backups.end(), [&](const BackupFile &b) { return b.name == backup.name; }))
+				backups.push_back(std::move(backup));
+		}
+	}
+	return backups;
+}
+
+bool S3BackupStorage::Stat(const std::string &collectionFile, BackupFile &backup, bool name)
+{
+	/* only the backups that could not be uploaded are listed without metadata */
+	if (fallback && backup.modified == 0 && backup.size == 0)
+		return fallback->Stat(collectionFile, backup, name);
+	return true;
+}
+
+bool S3BackupStorage::Listed(const std::string &collectionFile)
+{
+	EnsureLoaded(collectionFile, false);
+	std::lock_guard<std::mutex> lock(mutex);
+	return collections[collectionFile].loaded;
+}
+
+bool S3BackupStorage::Save(const std::string &collectionFile, obs_data_t *data, const std::string &name, IoThrottle *throttle)
+{
+	std::string key;
+	if (!data || !GetKey(collectionFile, name, key))
+		return false;
+	obs_data_set_string(data, "name", name.c_str());
+	const char *json = obs_data_get_json(data);
+	if (!json || !*json)
+		return false;
+	EnsureLoaded(collectionFile, false);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &collection = collections[collectionFile];
+		collection.pending[key] = json;
+		BackupFile backup{name, key, (int64_t)time(nullptr), strlen(json)};
+		auto it = std::find_if(collection.backups.begin(), collection.backups.end(),
+				       [&](const BackupFile &b) { return b.path == key; });
+		if (it != collection.backups.end())
+			*it = backup;
+		else
+			collection.backups.insert(std::upper_bound(collection.backups.begin(), collection.backups.end(), backup,
+								   [](const BackupFile &a, const BackupFile &b) { return a.path < b.path; }),
+						  backup);
+	}
+	/* the upload is paced like a local write would have been */
+	const uint64_t maxSpeed = throttle ? throttle->GetRate() : 0;
+	Task task;
+	task.run = [this, collectionFile, key, maxSpeed] {
+		std::string body;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			const auto &pending = collections[collectionFile].pending;
+			const auto it = pending.find(key);
+			/* removed or uploaded with a later save of the same name */
+			if (it == pending.end())
+				return true;
+			body = it->second;
+		}
+		const long code = Request("PUT", key, "", &body, nullptr, maxSpeed);
+		if (code < 200 || code >= 300)
+			return false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto &pending = collections[collectionFile].pending;
+			const auto it = pending.find(key);
+			if (it != pending.end() && it->second == body)
+				pending.erase(it);
+		}
+		QueueIndex(collectionFile);
+		return true;
+	};
+	task.failed = [this, collectionFile, key, name] {
+		std::string body;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto &collection = collections[collectionFile];
+			const auto it = collection.pending.find(key);
+			if (it == collection.pending.end())
+				return;
+			body = std::move(it->second);
+			collection.pending.erase(it);
+			collection.backups.erase(std::remove_if(collection.backups.begin(), collection.backups.end(),
+								[&](const BackupFile &b) { return b.path == key; }),
+						 collection.backups.end());
+		}
+		obs_data_t *backup = obs_data_create_from_json(body.c_str());
+		const bool saved = fallback && fallback->Save(collectionFile, backup, name);
+		obs_data_release(backup);
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to upload backup '%s', %s", key.c_str(),
+		     saved ? "saved it locally instead" : "it is lost");
+		if (changed)
+			changed(collectionFile);
+	};
+	Queue(std::move(task));
+	return true;
+}
+
+obs_data_t *S3BackupStorage::Load(const std::string &collectionFile, const std::string &name)
+{
+	std::string key;
+	if (!GetKey(collectionFile, name, key))
+		return nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto &pending = collections[collectionFile].pending;
+		const auto it = pending.find(key);
+		if (it != pending.end())
+			return obs_data_create_from_json(it->second.c_str());
+	}
+	std::string json;
+	const long code = Request("GET", key, "", nullptr, &json);
+	if (code == 404 && fallback)
+		return fallback->Load(collectionFile, name);
+	if (code != 200)
+		return nullptr;
+	return obs_data_create_from_json(json.c_str());
+}
+
+bool S3BackupStorage::Rename(const std::string &collectionFile, const std::string &from, const std::string &to)
+{
+	std::string fromKey, toKey;
+	if (!GetKey(collectionFile, from, fromKey) || !GetKey(collectionFile, to, toKey) || fromKey == toKey)
+		return false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto &backups = collections[collectionFile].backups;
+		if (std::any_of(backups.begin(), backups.end(), [&](const BackupFile &b) { return b.path == toKey; }))
+			return false;
+	}
+	obs_data_t *data = Load(collectionFile, from);
+	if (!data)
+		return false;
+	const bool success = Save(collectionFile, data, to) && Remove(collectionFile, from);
+	obs_data_release(data);
+	return success;
+}
+
+bool S3BackupStorage::Remove(const std::string &collectionFile, const std::string &name)
+{
+	std::string key;
+	if (!GetKey(collectionFile, name, key))
+		return false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &collection = collections[collectionFile];
+		collection.pending.erase(key);
+		collection.backups.erase(std::remove_if(collection.backups.begin(), collection.backups.end(),
+							[&](const BackupFile &b) { return b.path == key; }),
+					 collection.backups.end());
+	}
+	QueueDelete(collectionFile, key);
+	if (fallback)
+		fallback->Remove(collectionFile, name);
+	return true;
+}
+
+size_t S3BackupStorage::Prune(const std::string &collectionFile, int max)
+{
+	if (max <= 0)
+		return 0;
+	/* never waits on the network, also not when OBS exits, what is left over is pruned after a later backup */
+	EnsureLoaded(collectionFile, false);
+	std::vector<std::string> keys;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &collection = collections[collectionFile];
+		if (!collection.loaded)
+			return 0;
+		std::vector<std::pair<int64_t, std::string>> candidates;
+		for (const auto &backup : collection.backups) {
+			if (IsAutomaticBackup(backup.path))
+				candidates.emplace_back(backup.modified, backup.path);
+		}
+		std::sort(candidates.begin(), candidates.end());
+		for (size_t i = 0; i + (size_t)max < candidates.size(); i++) {
+			keys.push_back(candidates[i].second);
+			collection.pending.erase(candidates[i].second);
+		}
+		collection.backups.erase(std::remove_if(collection.backups.begin(), collection.backups.end(),
+							[&](const BackupFile &b) {
+								return std::find(keys.begin(), keys.end(), b.path) != keys.end();
+							}),
+					 collection.backups.end());
+	}
+	for (const auto &key : keys)
+		QueueDelete(collectionFile, key);
+	return keys.size();
+}
+
+bool S3BackupStorage::CopyObject(const std::string &fromKey, const std::string &toKey)
+{
+	const std::string empty;
+	std::string xml;
+	const long code = Request("PUT", toKey, "", &empty, &xml, 0,
+				  "x-amz-copy-source: /" + EncodeKey(config.bucket) + "/" + EncodeKey(fromKey));
+	/* a copy that fails after it started still answers 200, with an error instead of the result */
+	return code == 200 && xml.find("<CopyObjectResult") != std::string::npos;
+}
+
+/* runs on an upload thread and is retried, every backup is taken off the old collection once it is copied */
+bool S3BackupStorage::MoveBackups(const std::string &fromFile, const std::string &toFile)
+{
+	bool fromLoaded, toLoaded;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		fromLoaded = collections[fromFile].loaded;
+		toLoaded = collections[toFile].loaded;
+	}
+	if ((!fromLoaded && !LoadIndex(fromFile)) || (!toLoaded && !LoadIndex(toFile)))
+		return false;
+	std::vector<BackupFile> backups;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		backups = collections[fromFile].backups;
+	}
+	const auto prefix = GetPrefix(toFile);
+	for (const auto &backup : backups) {
+		BackupFile moved = backup;
+		moved.path = prefix + GetFilenameFromPath(backup.path, true);
+		if (!CopyObject(backup.path, moved.path))
+			return false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto &from = collections[fromFile].backups;
+			from.erase(std::remove_if(from.begin(), from.end(), [&](const BackupFile &b) { return b.path == backup.path; }),
+				   from.end());
+			auto &to = collections[toFile].backups;
+			to.erase(std::remove_if(to.begin(), to.end(), [&](const BackupFile &b) { return b.path == moved.path; }),
+				 to.end());
+			to.insert(std::upper_bound(to.begin(), to.end(), moved,
+						   [](const BackupFile &a, const BackupFile &b) { return a.path < b.path; }),
+				  moved);
+		}
+		/* the old index goes away below, so the copy is not deleted through QueueDelete which writes it again */
+		const long code = Request("DELETE", backup.path, "", nullptr, nullptr);
+		if ((code < 200 || code >= 300) && code != 404)
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to remove backup '%s' after moving it", backup.path.c_str());
+	}
+	QueueIndex(toFile);
+	Request("DELETE", GetPrefix(fromFile) + S3_INDEX, "", nullptr, nullptr);
+	if (changed)
+		changed(toFile);
+	return true;
+}
+
+bool S3BackupStorage::Move(const std::string &fromFile, const std::string &toFile)
+{
+	if (fallback && !fallback->Move(fromFile, toFile))
+		return false;
+	/* backups that are not uploaded yet are saved again under the new collection */
+	std::vector<std::pair<std::string, std::string>> pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &from = collections[fromFile];
+		for (auto &upload : from.pending) {
+			const auto it = std::find_if(from.backups.begin(), from.backups.end(),
+						     [&](const BackupFile &b) { return b.path == upload.first; });
+			if (it != from.backups.end())
+				pending.emplace_back(it->name, std::move(upload.second));
+		}
+		from.backups.erase(std::remove_if(from.backups.begin(), from.backups.end(),
+						  [&](const BackupFile &b) { return from.pending.count(b.path) != 0; }),
+				   from.backups.end());
+		from.pending.clear();
+		/* the move reads the index itself, a read queued now could list the new collection half moved */
+		auto &to = collections[toFile];
+		if (!to.loaded)
+			to.loading = true;
+	}
+	for (const auto &upload : pending) {
+		obs_data_t *data = obs_data_create_from_json(upload.second.c_str());
+		Save(toFile, data, upload.first);
+		obs_data_release(data);
+	}
+	Task task;
+	task.run = [this, fromFile, toFile] { return MoveBackups(fromFile, toFile); };
+	task.failed = [this, fromFile, toFile] {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to move the backups of '%s' to '%s'", fromFile.c_str(),
+		     toFile.c_str());
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			collections[toFile].loading = false;
+		}
+		cv.notify_all();
+	};
+	Queue(std::move(task));
+	return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "scene-collection-storage.hpp"
+
+struct S3Config {
+	/* http(s)://host[:port], the bucket is addressed in the path so MinIO and other stand-ins work as is */
+	std::string endpoint;
+	std::string bucket;
+	std::string region = "us-east-1";
+	std::string accessKey;
+	std::string secretKey;
+	/* the backups of a collection are stored under prefix/<collection file name>/ */
+	std::string prefix;
+	size_t uploads = 4;
+	int retries = 5;
+};
+
+/* backups in an S3-compatible object store. Saving only queues the upload, uploads run in parallel on their own threads
+ * and are retried with backoff, a backup that can not be uploaded is saved to fallback instead and listed from there.
+ * The backups of a collection are listed from an index object that is read once and then kept up to date, not with a
+ * request per list */
+class S3BackupStorage : public BackupStorage {
+public:
+	/* changed is called from the upload threads when the backups of a collection were read or failed to upload */
+	S3BackupStorage(S3Config config, std::shared_ptr<BackupStorage> fallback,
+			std::function<void(const std::string &collectionFile)> changed = {});
+	~S3BackupStorage() override;
+
+	std::vector<BackupFile> List(const std::string &collectionFile, bool metadata = true) override;
+	bool Stat(const std::string &collectionFile, BackupFile &backup, bool name = true) override;
+	/* starts reading the index when it was not read yet */
+	bool Listed(const std::string &collectionFile) override;
+	bool Save(const std::string &collectionFile, obs_data_t *data, const std::string &name,
+		  IoThrottle *throttle = nullptr) override;
+	obs_data_t *Load(const std::string &collectionFile, const std::string &name) override;
+	bool Rename(const std::string &collectionFile, const std::string &from, const std::string &to) override;
+	bool Remove(const std::string &collectionFile, const std::string &name) override;
+	/* prunes nothing until the index is read */
+	size_t Prune(const std::string &collectionFile, int max) override;
+	/* only queues the move, the backups are listed under the new collection right away */
+	bool Move(const std::string &fromFile, const std::string &toFile) override;
+
+	/* blocks until every queued request is done */
+	void Wait();
+
+private:
+	struct Collection {
+		bool loaded = false;
+		bool loading = false;
+		bool indexQueued = false;
+		/* path is the object key */
+		std::vector<BackupFile> backups;
+		/* json of the backups that are not uploaded yet, by key */
+		std::map<std::string, std::string> pending;
+	};
+
+	struct Task {
+		std::function<bool()> run;
+		std::function<void()> failed;
+		int attempt = 0;
+		std::chrono::steady_clock::time_point due;
+	};
+
+	std::string GetPrefix(const std::string &collectionFile) const;
+	bool GetKey(const std::string &collectionFile, const std::string &name, std::string &key) const;
+	long Request(const char *method, const std::string &key, const std::string &query, const std::string *body,
+		     std::string *response, uint64_t maxSpeed = 0, const std::string &header = "");
+	/* a copy on the server, the backup is not downloaded */
+	bool CopyObject(const std::string &fromKey, const std::string &toKey);
+	bool MoveBackups(const std::string &fromFile, const std::string &toFile);
+	bool LoadIndex(const std::string &collectionFile);
+	bool ListObjects(const std::string &prefix, std::vector<BackupFile> &backups);
+	bool SaveIndex(const std::string &collectionFile);
+	void EnsureLoaded(const std::string &collectionFile, bool wait);
+	void QueueIndex(const std::string &collectionFile);
+	void QueueDelete(const std::string &collectionFile, const std::string &key);
+	void Queue(Task task);
+	void Worker();
+
+	S3Config config;
+	std::shared_ptr<BackupStorage> fallback;
+	std::function<void(const std::string &)> changed;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::map<std::string, Collection> collections;
+	std::deque<Task> tasks;
+	size_t running = 0;
+	bool stopping = false;
+	/* read by the transfers without the lock, so a shutdown does not wait for them */
+	std::atomic<bool> aborting{false};
+	std::vector<std::thread> workers;
+};
@@ -0,0 +1,137 @@
+#include "scene-collection-scan.hpp"
+
+#include <atomic>
+#include <unordered_set>
+#include <sys/stat.h>
+
+#include "scene-collection-core.hpp"
+#include "scene-collection-info.hpp"
+#include "scene-collection-json-stream.hpp"
+#include "util/base.h"
+#include "util/platform.h"
+
+void MediaScanner::Parse(const std::string &file, Collection &collection)
+{
+	/* the name of a source can come after its settings, so names are resolved once the whole file is read */
+	struct Candidate {
+		uint64_t source;
+		uint64_t filter;
+		std::string path;
+	};
+	std::vector<Candidate> candidates;
+	std::unordered_map<uint64_t, std::string> names;
+	auto collect = [&](const std::vector<JsonStreamFrame> &frames, const std::string &key, size_t, std::string &value) {
+		if (key == "name")
+			names[frames.back().id] = value;
+		std::string path;
+		if (!GetReferencedPath(value, path))
+			return false;
+		Candidate candidate{0, 0, path};
+		if (frames.size() >= 3 && (frames[1].key == "sources" || frames[1].key == "groups")) {
+			candidate.source = frames[2].id;
+			if (frames.size() >= 5 && frames[3].key == "filters")
+				candidate.filter = frames[4].id;
+		}
+		candidates.push_back(std::move(candidate));
+		return false;
+	};
+	collection.references.clear();
+	if (!TransformJsonFile(file, "", collect)) {
+		/* read again on the next scan, the file may have been caught while it was being saved */
+		collection.modified = -1;
+		return;
+	}
+	for (auto &candidate : candidates) {
+		std::string source = names[candidate.source];
+		if (candidate.filter)
+			source += " / " + names[candidate.filter];
+		collection.references.push_back({source, std::move(candidate.path)});
+	}
+}
+
+std::vector<MissingMedia> MediaScanner::Scan(const std::map<std::string, std::string> &files, size_t jobs)
+{
+	stats = MediaScanStats();
+	stats.collections = files.size();
+
+	/* only collections that changed since the last scan are read again */
+	std::unordered_map<std::string, Collection> current;
+	std::vector<std::pair<std::string, Collection *>> parse;
+	for (const auto &file : files) {
+		struct stat st {};
+		const bool exists = os_stat(file.second.c_str(), &st) == 0;
+		auto it = collections.find(file.second);
+		Collection &collection = current[file.second];
+		if (it != collections.end())
+			collection = std::move(it->second);
+		if (!exists) {
+			collection = Collection();
+		} else if (collection.modified != (int64_t)st.st_mtime || collection.size != (int64_t)st.st_size) {
+			collection.modified = (int64_t)st.st_mtime;
+			collection.size = (int64_t)st.st_size;
+			parse.emplace_back(file.second, &collection);
+		}
+	}
+	collections = std::move(current);
+	stats.parsed = parse.size();
+	RunParallel(parse.size(), jobs, [&](size_t i) { Parse(parse[i].first, *parse[i].second); });
+
+	/* every path is checked once no matter how many collections use it, grouped by directory so an unchanged
+	 * directory answers for all its files without touching them */
+	std::unordered_map<std::string, std::unordered_set<std::string>> paths;
+	for (const auto &collection : collections) {
+		for (const auto &reference : collection.second.references) {
+			const auto slash = reference.path.find_last_of("/\\");
+			paths[reference.path.substr(0, slash + 1)].insert(reference.path.substr(slash + 1));
+		}
+	}
+	std::unordered_map<std::string, Directory> used;
+	std::vector<std::pair<const std::string *, Directory *>> check;
+	for (const auto &path : paths) {
+		stats.paths += path.second.size();
+		auto it = directories.find(path.first);
+		Directory &directory = used[path.first];
+		if (it != directories.end())
+			directory = std::move(it->second);
+		check.emplace_back(&path.first, &directory);
+	}
+	directories = std::move(used);
+	stats.directories = check.size();
+
+	std::atomic<size_t> checked{0};
+	RunParallel(check.size(), jobs, [&](size_t i) {
+		const auto &dir = *check[i].first;
+		Directory &directory = *check[i].second;
+		const int64_t modified = GetModifiedTime(dir);
+		if (modified != directory.modified) {
+			directory.files.clear();
+			directory.modified = modified;
+		}
+		for (const auto &name : paths.at(dir)) {
+			if (directory.files.count(name))
+				continue;
+			directory.files[name] = modified && os_file_exists((dir + name).c_str());
+			checked++;
+		}
+	});
+	stats.checked = checked;
+
+	std::vector<MissingMedia> missing;
+	for (const auto &file : files) {
+		std::unordered_set<std::string> reported;
+		for (const auto &reference : collections[file.second].references) {
+			const auto slash = reference.path.find_last_of("/\\");
+			const auto &directory = directories[reference.path.substr(0, slash + 1)];
+			const auto exists = directory.files.find(reference.path.substr(slash + 1));
+			if (exists != directory.files.end() && exists->second)
+				continue;
+			if (reported.insert(reference.source + "\n" + reference.path).second)
+				missing.push_back({file.first, reference.source, reference.path});
+		}
+	}
+	stats.missing = missing.size();
+	blog(LOG_INFO,
+	     "[Scene Collection Manager] scanned %zu collections (%zu read) with %zu paths in %zu directories, %zu checked, %zu missing",
+	     stats.collections, stats.parsed, stats.paths, stats.directories, stats.checked, stats.missing);
+	return missing;
+}
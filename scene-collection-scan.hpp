@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MissingMedia {
+	std::string collection;
+	/* the source referencing the file, "source / filter" for a filter */
+	std::string source;
+	std::string path;
+};
+
+struct MediaScanStats {
+	size_t collections = 0;
+	size_t parsed = 0;
+	size_t paths = 0;
+	size_t directories = 0;
+	size_t checked = 0;
+	size_t missing = 0;
+};
+
+/* finds local files referenced by scene collections that do not exist anymore, a scanner remembers what it found so
+ * scanning again only reads the collections and checks the directories that changed since */
+class MediaScanner {
+public:
+	/* collections maps the scene collection name to its file */
+	std::vector<MissingMedia> Scan(const std::map<std::string, std::string> &collections, size_t jobs = 0);
+
+	MediaScanStats stats;
+
+private:
+	struct Reference {
+		std::string source;
+		std::string path;
+	};
+	struct Collection {
+		int64_t modified = -1;
+		int64_t size = -1;
+		std::vector<Reference> references;
+	};
+	struct Directory {
+		int64_t modified = -1;
+		/* file name to whether it exists, only valid while the directory is not modified */
+		std::unordered_map<std::string, bool> files;
+	};
+
+	std::unordered_map<std::string, Collection> collections;
+	std::unordered_map<std::string, Directory> directories;
+
+	void Parse(const std::string &file, Collection &collection);
+};
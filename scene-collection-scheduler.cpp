@@ -0,0 +1,175 @@
+#include "scene-collection-scheduler.hpp"
+
+#include <algorithm>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "obs-frontend-api.h"
+#include "util/platform.h"
+
+/* the transition is only treated as over a little after its duration */
+#define SCHEDULER_TRANSITION_MARGIN_MS 500
+
+BackupScheduler::BackupScheduler() = default;
+
+BackupScheduler::~BackupScheduler()
+{
+	Shutdown();
+}
+
+bool BackupScheduler::IsLive()
+{
+	if (obs_frontend_streaming_active() || obs_frontend_recording_active())
+		return true;
+	std::lock_guard<std::mutex> lock(mutex);
+	return os_gettime_ns() < transitionEnd;
+}
+
+void BackupScheduler::Schedule(Job job, bool urgent, const std::string &key)
+{
+	if (!key.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending[key]++;
+		}
+		job = [this, key, job = std::move(job)](IoThrottle *throttle) {
+			job(throttle);
+			Finished(key);
+		};
+	}
+	const bool live = IsLive();
+	if (live && !urgent && defer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!stopped) {
+			deferred.emplace_back(key, std::move(job));
+			return;
+		}
+	}
+	Start({std::move(job)}, live);
+}
+
+void BackupScheduler::WhenDone(const std::string &key, std::function<void()> done)
+{
+	std::vector<Job> jobs;
+	bool wait;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		wait = pending.count(key) != 0;
+		if (wait) {
+			waiting[key].push_back(std::move(done));
+			for (auto it = deferred.begin(); it != deferred.end();) {
+				if (it->first == key) {
+					jobs.push_back(std::move(it->second));
+					it = deferred.erase(it);
+				} else {
+					it++;
+				}
+			}
+		}
+	}
+	if (!wait) {
+		done();
+		return;
+	}
+	if (!jobs.empty())
+		Start(std::move(jobs), IsLive());
+}
+
+void BackupScheduler::Finished(const std::string &key)
+{
+	std::vector<std::function<void()>> done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto it = pending.find(key);
+		if (it == pending.end() || --it->second > 0)
+			return;
+		pending.erase(it);
+		const auto waiter = waiting.find(key);
+		if (waiter != waiting.end()) {
+			done = std::move(waiter->second);
+			waiting.erase(waiter);
+		}
+	}
+	for (auto &callback : done)
+		callback();
+}
+
+void BackupScheduler::Poll()
+{
+	if (IsLive())
+		return;
+	std::vector<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto &job : deferred)
+			jobs.push_back(std::move(job.second));
+		deferred.clear();
+	}
+	if (!jobs.empty())
+		Start(std::move(jobs), false);
+}
+
+void BackupScheduler::Flush()
+{
+	std::vector<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto &job : deferred)
+			jobs.push_back(std::move(job.second));
+		deferred.clear();
+	}
+	for (auto &job : jobs)
+		job(nullptr);
+}
+
+void BackupScheduler::TransitionStarted(int durationMs)
+{
+	const int wait = std::max(durationMs, 0) + SCHEDULER_TRANSITION_MARGIN_MS;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		transitionEnd = std::max(transitionEnd, os_gettime_ns() + (uint64_t)wait * 1000000);
+	}
+	if (stopped)
+		return;
+	if (!context)
+		context = std::make_unique<QObject>();
+	QTimer::singleShot(wait, context.get(), [this] { Poll(); });
+}
+
+void BackupScheduler::Shutdown()
+{
+	context.reset();
+	std::unique_lock<std::mutex> lock(mutex);
+	stopped = true;
+	idle.wait(lock, [this] { return running == 0; });
+}
+
+void BackupScheduler::Start(std::vector<Job> jobs, bool live)
+{
+	bool stopping;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = stopped;
+		if (!stopping)
+			running++;
+	}
+	if (stopping) {
+		/* the thread pool may outlive this, so what comes in after the shutdown runs here */
+		for (auto &job : jobs)
+			job(nullptr);
+		return;
+	}
+	QThreadPool::globalInstance()->start([this, jobs, live] {
+		if (!live) {
+			for (auto &job : jobs)
+				job(nullptr);
+		} else {
+			BackgroundIo background;
+			for (auto &job : jobs)
+				job(&throttle);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		running--;
+		idle.notify_all();
+	});
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "scene-collection-throttle.hpp"
+
+class QObject;
+
+/* runs backup, prune and cleanup work on the thread pool. While streaming, recording or during a transition work that
+ * is not urgent waits until the show is over, urgent work is written at the throttled rate with a lowered disk priority */
+class BackupScheduler {
+public:
+	/* throttle is nullptr when the work can write at full speed */
+	using Job = std::function<void(IoThrottle *throttle)>;
+
+	BackupScheduler();
+	~BackupScheduler();
+
+	/* key groups the work of one scene collection for WhenDone */
+	void Schedule(Job job, bool urgent = false, const std::string &key = "");
+	/* calls done once the work scheduled under key is done, right away when there is none. Deferred work under key
+	 * starts now, at the throttled rate while live. done is called from the thread that finished the work */
+	void WhenDone(const std::string &key, std::function<void()> done);
+	/* starts the deferred work when nothing is live anymore */
+	void Poll();
+	/* runs the deferred work on the calling thread, before OBS exits */
+	void Flush();
+	/* cancels the pending transition poll and waits for the work on the thread pool, work scheduled afterwards runs
+	 * on the calling thread */
+	void Shutdown();
+	void TransitionStarted(int durationMs);
+
+	void SetRateLimit(uint64_t bytesPerSecond) { throttle.SetRate(bytesPerSecond); }
+	void SetDeferDuringShow(bool enabled) { defer = enabled; }
+
+private:
+	bool IsLive();
+	void Start(std::vector<Job> jobs, bool live);
+	void Finished(const std::string &key);
+
+	std::mutex mutex;
+	std::condition_variable idle;
+	/* with the key they were scheduled under */
+	std::vector<std::pair<std::string, Job>> deferred;
+	/* scheduled and not done yet, by key */
+	std::map<std::string, size_t> pending;
+	std::map<std::string, std::vector<std::function<void()>>> waiting;
+	/* batches started on the thread pool and not done yet */
+	size_t running = 0;
+	bool stopped = false;
+	/* owns the transition poll timers so they never fire after the scheduler is gone */
+	std::unique_ptr<QObject> context;
+	IoThrottle throttle;
+	/* os_gettime_ns when the last transition is over */
+	uint64_t transitionEnd = 0;
+	std::atomic<bool> defer{true};
+};
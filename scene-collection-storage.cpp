@@ -0,0 +1,91 @@
+#include "scene-collection-storage.hpp"
+
+#include "scene-collection-lock.hpp"
+#include "util/platform.h"
+
+std::string LocalBackupStorage::GetBackupFile(const std::string &collectionFile, const std::string &name) const
+{
+	std::string safeName;
+	if (!GetFileSafeName(name.c_str(), safeName))
+		return "";
+	return GetBackupDirectory(collectionFile, customBackupDir) + safeName + ".json";
+}
+
+std::vector<BackupFile> LocalBackupStorage::List(const std::string &collectionFile, bool metadata)
+{
+	return ListBackups(GetBackupDirectory(collectionFile, customBackupDir), metadata);
+}
+
+bool LocalBackupStorage::Stat(const std::string &collectionFile, BackupFile &backup, bool name)
+{
+	UNUSED_PARAMETER(collectionFile);
+	return ReadBackupMetadata(backup, name);
+}
+
+bool LocalBackupStorage::Save(const std::string &collectionFile, obs_data_t *data, const std::string &name, IoThrottle *throttle)
+{
+	return SaveBackup(data, GetBackupDirectory(collectionFile, customBackupDir), name, throttle);
+}
+
+obs_data_t *LocalBackupStorage::Load(const std::string &collectionFile, const std::string &name)
+{
+	const auto file = GetBackupFile(collectionFile, name);
+	if (file.empty())
+		return nullptr;
+	return obs_data_create_from_json_file_safe(file.c_str(), "bak");
+}
+
+bool LocalBackupStorage::Rename(const std::string &collectionFile, const std::string &from, const std::string &to)
+{
+	const auto backupDir = GetBackupDirectory(collectionFile, customBackupDir);
+	const auto fromFile = GetBackupFile(collectionFile, from);
+	const auto toFile = GetBackupFile(collectionFile, to);
+	if (fromFile.empty() || toFile.empty() || os_file_exists(toFile.c_str()))
+		return false;
+	obs_data_t *data = obs_data_create_from_json_file(fromFile.c_str());
+	if (!data)
+		return false;
+	BackupDirLock lock(backupDir);
+	const bool success = lock.Locked() && SaveBackup(data, backupDir, to) && os_unlink(fromFile.c_str()) == 0;
+	obs_data_release(data);
+	return success;
+}
+
+bool LocalBackupStorage::Remove(const std::string &collectionFile, const std::string &name)
+{
+	const auto file = GetBackupFile(collectionFile, name);
+	return !file.empty() && os_unlink(file.c_str()) == 0;
+}
+
+size_t LocalBackupStorage::Prune(const std::string &collectionFile, int max)
+{
+	return PruneBackups(GetBackupDirectory(collectionFile, customBackupDir), max);
+}
+
+bool LocalBackupStorage::Move(const std::string &fromFile, const std::string &toFile)
+{
+	const auto from = GetBackupDirectory(fromFile, customBackupDir);
+	const auto to = GetBackupDirectory(toFile, customBackupDir);
+	/* a collection without backups has nothing to move */
+	if (!os_file_exists(from.c_str()))
+		return true;
+	return os_rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool GetEdgeBackup(BackupStorage &storage, const std::string &collectionFile, bool newest, BackupFile &backup)
+{
+	if (!storage.Listed(collectionFile))
+		return false;
+	bool found = false;
+	/* the name of the backup stays the one it was listed with, which is what Load takes */
+	for (auto &candidate : storage.List(collectionFile, false)) {
+		if (candidate.modified == 0 && candidate.size == 0)
+			storage.Stat(collectionFile, candidate, false);
+		if (candidate.size == 0)
+			continue;
+		if (!found || (newest ? candidate.modified >= backup.modified : candidate.modified <= backup.modified))
+			backup = candidate;
+		found = true;
+	}
+	return found;
+}
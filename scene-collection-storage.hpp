@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "obs.h"
+#include "scene-collection-core.hpp"
+
+class IoThrottle;
+
+/* where the backups of scene collections are kept, a collection is identified by its file and a backup by its name */
+class BackupStorage {
+public:
+	virtual ~BackupStorage() = default;
+
+	/* does not wait on the network, a remote storage answers from its index. Without metadata a storage may leave out
+	 * what costs extra to read per backup, Stat reads it later */
+	virtual std::vector<BackupFile> List(const std::string &collectionFile, bool metadata = true) = 0;
+	/* fills in the time and size of a backup listed without metadata, and the name unless only the time is needed */
+	virtual bool Stat(const std::string &collectionFile, BackupFile &backup, bool name = true) = 0;
+	/* false while List does not have every backup of the collection yet, like before a remote index is read */
+	virtual bool Listed(const std::string &collectionFile)
+	{
+		UNUSED_PARAMETER(collectionFile);
+		return true;
+	}
+	/* stores data as backup name, data gets the backup name set and may be kept until it is stored */
+	virtual bool Save(const std::string &collectionFile, obs_data_t *data, const std::string &name,
+			  IoThrottle *throttle = nullptr) = 0;
+	/* the backup, needs to be released, nullptr when it does not exist */
+	virtual obs_data_t *Load(const std::string &collectionFile, const std::string &name) = 0;
+	/* fails when a backup named to exists */
+	virtual bool Rename(const std::string &collectionFile, const std::string &from, const std::string &to) = 0;
+	virtual bool Remove(const std::string &collectionFile, const std::string &name) = 0;
+	/* removes the oldest automatic backups until at most max are left */
+	virtual size_t Prune(const std::string &collectionFile, int max) = 0;
+	/* the backups follow the scene collection when its file is renamed, false when they are still with fromFile */
+	virtual bool Move(const std::string &fromFile, const std::string &toFile) = 0;
+};
+
+/* the backups in a directory next to the scene collection or in the custom backup directory */
+class LocalBackupStorage : public BackupStorage {
+public:
+	explicit LocalBackupStorage(std::string customBackupDir = "") : customBackupDir(std::move(customBackupDir)) {}
+
+	std::vector<BackupFile> List(const std::string &collectionFile, bool metadata = true) override;
+	bool Stat(const std::string &collectionFile, BackupFile &backup, bool name = true) override;
+	bool Save(const std::string &collectionFile, obs_data_t *data, const std::string &name,
+		  IoThrottle *throttle = nullptr) override;
+	obs_data_t *Load(const std::string &collectionFile, const std::string &name) override;
+	bool Rename(const std::string &collectionFile, const std::string &from, const std::string &to) override;
+	bool Remove(const std::string &collectionFile, const std::string &name) override;
+	size_t Prune(const std::string &collectionFile, int max) override;
+	bool Move(const std::string &fromFile, const std::string &toFile) override;
+
+private:
+	std::string GetBackupFile(const std::string &collectionFile, const std::string &name) const;
+
+	std::string customBackupDir;
+};
+
+/* the newest or oldest backup of the collection by time only, false when there is none or the storage has not listed
+ * every backup yet */
+bool GetEdgeBackup(BackupStorage &storage, const std::string &collectionFile, bool newest, BackupFile &backup);
@@ -0,0 +1,112 @@
+#include "scene-collection-throttle.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "util/base.h"
+#include "util/platform.h"
+
+#define THROTTLE_CHUNK_SIZE (64 * 1024)
+
+#if defined(__linux__)
+/* from linux/ioprio.h, which is not available everywhere */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE 3
+#endif
+
+void IoThrottle::Acquire(size_t bytes)
+{
+	const uint64_t bytesPerSecond = rate;
+	if (!bytesPerSecond)
+		return;
+	std::chrono::steady_clock::time_point start;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto now = std::chrono::steady_clock::now();
+		/* time nothing was written does not add up to a burst later */
+		if (next < now)
+			next = now;
+		start = next;
+		next += std::chrono::nanoseconds((uint64_t)bytes * 1000000000ULL / bytesPerSecond);
+	}
+	std::this_thread::sleep_until(start);
+}
+
+BackgroundIo::BackgroundIo()
+{
+#if defined(_WIN32)
+	lowered = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0;
+#elif defined(__linux__)
+	/* 0 is the calling thread */
+	previous = (int)syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+	if (previous >= 0)
+		lowered = syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0;
+#elif defined(__APPLE__)
+	previous = getiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD);
+	if (previous >= 0)
+		lowered = setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, IOPOL_THROTTLE) == 0;
+#endif
+}
+
+BackgroundIo::~BackgroundIo()
+{
+	/* pool threads are reused, so the priority is always restored */
+	if (!lowered)
+		return;
+#if defined(_WIN32)
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#elif defined(__linux__)
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, previous);
+#elif defined(__APPLE__)
+	setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, previous);
+#endif
+}
+
+/* other instances may write a backup with the same name into a shared directory, so every write gets its own file */
+static std::string GetTempFile(const std::string &file)
+{
+	static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+	const unsigned long pid = GetCurrentProcessId();
+#else
+	const unsigned long pid = (unsigned long)getpid();
+#endif
+	return file + "." + std::to_string(pid) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+bool WriteFileThrottled(const std::string &file, const char *data, size_t size, IoThrottle *throttle)
+{
+	const auto tmp = GetTempFile(file);
+	FILE *f = os_fopen(tmp.c_str(), "wb");
+	if (!f)
+		return false;
+	bool success = true;
+	for (size_t offset = 0; success && offset < size; offset += THROTTLE_CHUNK_SIZE) {
+		const size_t n = std::min((size_t)THROTTLE_CHUNK_SIZE, size - offset);
+		if (throttle)
+			throttle->Acquire(n);
+		success = fwrite(data + offset, 1, n, f) == n;
+	}
+	success = fclose(f) == 0 && success;
+	if (success && os_rename(tmp.c_str(), file.c_str()) != 0)
+		success = false;
+	if (!success) {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to write '%s'", file.c_str());
+		os_unlink(tmp.c_str());
+	}
+	return success;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/* paces writes so all threads sharing it write at most bytesPerSecond on average, 0 is unlimited */
+class IoThrottle {
+public:
+	explicit IoThrottle(uint64_t bytesPerSecond = 0) : rate(bytesPerSecond) {}
+
+	void SetRate(uint64_t bytesPerSecond) { rate = bytesPerSecond; }
+	uint64_t GetRate() const { return rate; }
+	/* blocks until the next bytes may be written */
+	void Acquire(size_t bytes);
+
+private:
+	std::atomic<uint64_t> rate;
+	std::mutex mutex;
+	std::chrono::steady_clock::time_point next;
+};
+
+/* lowers the disk priority of the calling thread while in scope, where the platform supports it */
+class BackgroundIo {
+public:
+	BackgroundIo();
+	~BackgroundIo();
+	BackgroundIo(const BackgroundIo &) = delete;
+	BackgroundIo &operator=(const BackgroundIo &) = delete;
+
+private:
+	bool lowered = false;
+	int previous = 0;
+};
+
+/* writes through a temporary file next to file which replaces file when complete, so readers never see a partial file,
+ * in chunks paced by throttle when given */
+bool WriteFileThrottled(const std::string &file, const char *data, size_t size, IoThrottle *throttle);
@@ -0,0 +1,145 @@
+#include "scene-collection-trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "util/base.h"
+#include "util/platform.h"
+
+/* events per thread for one recording, later events of that thread are dropped */
+#define TRACE_BUFFER_EVENTS 16384
+
+struct TraceEvent {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+};
+
+/* written only by its own thread, count is published after the event so a writer of the trace can read up to it */
+struct TraceBuffer {
+	uint32_t tid = 0;
+	std::atomic<uint64_t> generation{0};
+	std::atomic<size_t> count{0};
+	std::atomic<size_t> dropped{0};
+	std::unique_ptr<TraceEvent[]> events{new TraceEvent[TRACE_BUFFER_EVENTS]};
+};
+
+static std::atomic<bool> traceEnabled{false};
+/* bumped on every enable, a buffer of an older generation starts over */
+static std::atomic<uint64_t> traceGeneration{0};
+static std::atomic<uint64_t> traceStart{0};
+/* only taken for the first event of a thread and to write the trace */
+static std::mutex traceBuffersMutex;
+static std::vector<std::shared_ptr<TraceBuffer>> traceBuffers;
+static uint32_t traceThreads = 0;
+
+static TraceBuffer *GetThreadBuffer()
+{
+	/* the list keeps the buffer of a thread that has ended until the trace is written */
+	thread_local std::shared_ptr<TraceBuffer> buffer;
+	if (!buffer) {
+		buffer = std::make_shared<TraceBuffer>();
+		std::lock_guard<std::mutex> lock(traceBuffersMutex);
+		buffer->tid = ++traceThreads;
+		traceBuffers.push_back(buffer);
+	}
+	return buffer.get();
+}
+
+/* a buffer only the list holds belongs to a thread that has ended */
+static void DropEndedThreadBuffers()
+{
+	std::lock_guard<std::mutex> lock(traceBuffersMutex);
+	traceBuffers.erase(std::remove_if(traceBuffers.begin(), traceBuffers.end(),
+					  [](const std::shared_ptr<TraceBuffer> &buffer) { return buffer.use_count() == 1; }),
+			   traceBuffers.end());
+}
+
+static void RecordSpan(const char *name, uint64_t start, uint64_t end)
+{
+	auto *buffer = GetThreadBuffer();
+	const uint64_t generation = traceGeneration.load(std::memory_order_acquire);
+	if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped.store(0, std::memory_order_relaxed);
+		buffer->generation.store(generation, std::memory_order_release);
+	}
+	const size_t count = buffer->count.load(std::memory_order_relaxed);
+	if (count >= TRACE_BUFFER_EVENTS) {
+		buffer->dropped.store(buffer->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+	buffer->events[count] = {name, start, end};
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void SetTraceEnabled(bool enabled)
+{
+	if (enabled && !traceEnabled.load()) {
+		DropEndedThreadBuffers();
+		traceStart = os_gettime_ns();
+		traceGeneration.fetch_add(1, std::memory_order_release);
+	}
+	traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsTraceEnabled()
+{
+	return traceEnabled.load(std::memory_order_relaxed);
+}
+
+bool WriteTrace(const std::string &file)
+{
+	std::vector<std::shared_ptr<TraceBuffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(traceBuffersMutex);
+		buffers = traceBuffers;
+	}
+	const uint64_t generation = traceGeneration.load(std::memory_order_acquire);
+	const uint64_t start = traceStart;
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	size_t dropped = 0;
+	char event[256];
+	for (const auto &buffer : buffers) {
+		if (buffer->generation.load(std::memory_order_acquire) != generation)
+			continue;
+		const size_t count = buffer->count.load(std::memory_order_acquire);
+		if (!count)
+			continue;
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+		snprintf(event, sizeof(event),
+			 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"thread %" PRIu32
+			 "\"}}",
+			 first ? "" : ",", buffer->tid, buffer->tid);
+		json += event;
+		first = false;
+		for (size_t i = 0; i < count; i++) {
+			const auto &e = buffer->events[i];
+			const uint64_t ts = e.start > start ? e.start - start : 0;
+			snprintf(event, sizeof(event),
+				 ",{\"name\":\"%s\",\"cat\":\"scene-collection-manager\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+				 "\"pid\":1,\"tid\":%" PRIu32 "}",
+				 e.name, (double)ts / 1000.0, (double)(e.end - e.start) / 1000.0, buffer->tid);
+			json += event;
+		}
+	}
+	json += "]}\n";
+	buffers.clear();
+	DropEndedThreadBuffers();
+	if (dropped)
+		blog(LOG_WARNING, "[Scene Collection Manager] %zu trace events did not fit in the trace buffers", dropped);
+	return os_quick_write_utf8_file_safe(file.c_str(), json.c_str(), json.size(), false, "tmp", nullptr);
+}
+
+TraceSpan::TraceSpan(const char *name) : spanName(name), start(IsTraceEnabled() ? os_gettime_ns() : 0) {}
+
+TraceSpan::~TraceSpan()
+{
+	if (start && IsTraceEnabled())
+		RecordSpan(spanName, start, os_gettime_ns());
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/* opt-in timeline of the phases of operations, written as Chrome trace JSON for chrome://tracing or Perfetto. Every
+ * thread records into its own buffer without locking, while disabled a span costs one atomic load */
+void SetTraceEnabled(bool enabled);
+bool IsTraceEnabled();
+/* writes what was recorded since tracing was last enabled */
+bool WriteTrace(const std::string &file);
+
+/* records the time from construction to destruction under name, which has to be a string literal */
+class TraceSpan {
+public:
+	explicit TraceSpan(const char *name);
+	~TraceSpan();
+	TraceSpan(const TraceSpan &) = delete;
+	TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+	const char *spanName;
+	uint64_t start;
+};
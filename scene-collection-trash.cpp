@@ -0,0 +1,167 @@
+#include "scene-collection-trash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "obs.h"
+#include "scene-collection-core.hpp"
+#include "util/platform.h"
+
+#define TRASH_INFO "trash.json"
+#define TRASH_COLLECTION "collection.json"
+#define TRASH_BACKUPS "backups"
+
+static std::string WithoutSlash(std::string dir)
+{
+	while (dir.length() > 1 && (dir.back() == '/' || dir.back() == '\\'))
+		dir.resize(dir.length() - 1);
+	return dir;
+}
+
+std::string GetTrashDirectory(const std::string &sceneCollectionsPath)
+{
+	std::string dir = sceneCollectionsPath;
+	if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+		dir += "/";
+	return dir + ".trash/";
+}
+
+bool MoveToTrash(const std::string &trashDir, const std::string &name, const std::string &file, const std::string &backupDir,
+		 TrashEntry &entry)
+{
+	std::string safeName;
+	if (!GetFileSafeName(name.c_str(), safeName))
+		safeName = GetFilenameFromPath(file, false);
+	const int64_t now = (int64_t)time(nullptr);
+	std::string entryName = std::to_string(now) + "_" + safeName;
+	for (int i = 2; os_file_exists((trashDir + entryName).c_str()); i++)
+		entryName = std::to_string(now) + "_" + safeName + "_" + std::to_string(i);
+
+	entry = TrashEntry();
+	entry.path = trashDir + entryName + "/";
+	entry.name = name;
+	entry.file = file;
+	entry.deleted = now;
+	if (os_mkdirs(entry.path.c_str()) == MKDIR_ERROR)
+		return false;
+	if (os_rename(file.c_str(), (entry.path + TRASH_COLLECTION).c_str()) != 0) {
+		os_rmdir(entry.path.c_str());
+		return false;
+	}
+
+	const auto backups = WithoutSlash(backupDir);
+	if (!backupDir.empty() && os_file_exists(backups.c_str())) {
+		entry.backup_dir = backupDir;
+		if (os_rename(backups.c_str(), (entry.path + TRASH_BACKUPS).c_str()) == 0) {
+			entry.backup_trash = entry.path + TRASH_BACKUPS;
+		} else {
+			const auto sibling = backups + ".trash-" + entryName;
+			if (os_rename(backups.c_str(), sibling.c_str()) == 0)
+				entry.backup_trash = sibling;
+			else
+				blog(LOG_WARNING, "[Scene Collection Manager] failed to move backups '%s' to the trash", backups.c_str());
+		}
+	}
+
+	obs_data_t *info = obs_data_create();
+	obs_data_set_string(info, "name", entry.name.c_str());
+	obs_data_set_string(info, "file", entry.file.c_str());
+	obs_data_set_string(info, "backup_dir", entry.backup_dir.c_str());
+	obs_data_set_string(info, "backup_trash", entry.backup_trash.c_str());
+	obs_data_set_int(info, "deleted", entry.deleted);
+	obs_data_save_json(info, (entry.path + TRASH_INFO).c_str());
+	obs_data_release(info);
+	return true;
+}
+
+bool RestoreFromTrash(const TrashEntry &entry)
+{
+	if (entry.file.empty() || os_file_exists(entry.file.c_str()))
+		return false;
+	if (os_rename((entry.path + TRASH_COLLECTION).c_str(), entry.file.c_str()) != 0)
+		return false;
+	if (!entry.backup_trash.empty()) {
+		const auto backups = WithoutSlash(entry.backup_dir);
+		if (os_file_exists(backups.c_str()) || os_rename(entry.backup_trash.c_str(), backups.c_str()) != 0)
+			blog(LOG_WARNING, "[Scene Collection Manager] failed to restore backups of '%s'", entry.name.c_str());
+	}
+	RemoveDirectoryRecursive(entry.path);
+	return true;
+}
+
+std::vector<TrashEntry> ListTrash(const std::string &trashDir)
+{
+	std::vector<TrashEntry> entries;
+	os_dir_t *dir = os_opendir(WithoutSlash(trashDir).c_str());
+	if (!dir)
+		return entries;
+	while (struct os_dirent *ent = os_readdir(dir)) {
+		if (!ent->directory || ent->d_name[0] == '.')
+			continue;
+		TrashEntry entry;
+		entry.path = trashDir + ent->d_name + "/";
+		obs_data_t *info = obs_data_create_from_json_file((entry.path + TRASH_INFO).c_str());
+		if (!info)
+			continue;
+		entry.name = obs_data_get_string(info, "name");
+		entry.file = obs_data_get_string(info, "file");
+		entry.backup_dir = obs_data_get_string(info, "backup_dir");
+		entry.backup_trash = obs_data_get_string(info, "backup_trash");
+		entry.deleted = obs_data_get_int(info, "deleted");
+		obs_data_release(info);
+		entries.push_back(std::move(entry));
+	}
+	os_closedir(dir);
+	std::sort(entries.begin(), entries.end(), [](const TrashEntry &a, const TrashEntry &b) { return a.deleted > b.deleted; });
+	return entries;
+}
+
+size_t PurgeTrash(const std::string &trashDir, int64_t retention, const std::vector<std::string> &keep)
+{
+	const int64_t now = (int64_t)time(nullptr);
+	size_t purged = 0;
+	for (const auto &entry : ListTrash(trashDir)) {
+		if (now - entry.deleted < retention)
+			continue;
+		if (std::find(keep.begin(), keep.end(), entry.path) != keep.end())
+			continue;
+		if (!entry.backup_trash.empty() && entry.backup_trash.compare(0, entry.path.length(), entry.path) != 0)
+			RemoveDirectoryRecursive(entry.backup_trash);
+		if (RemoveDirectoryRecursive(entry.path))
+			purged++;
+	}
+	if (purged)
+		blog(LOG_INFO, "[Scene Collection Manager] purged %zu scene collections from the trash", purged);
+	return purged;
+}
+
+bool RemoveDirectoryRecursive(const std::string &dir)
+{
+	const auto path = WithoutSlash(dir);
+	os_dir_t *d = os_opendir(path.c_str());
+	if (!d)
+		return false;
+	bool success = true;
+	while (struct os_dirent *ent = os_readdir(d)) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+			continue;
+		const auto child = path + "/" + ent->d_name;
+		bool directory = ent->directory;
+#ifndef _WIN32
+		/* never follow a link out of the directory */
+		struct stat st;
+		if (directory && lstat(child.c_str(), &st) == 0 && S_ISLNK(st.st_mode))
+			directory = false;
+#endif
+		if (directory)
+			success = RemoveDirectoryRecursive(child) && success;
+		else if (os_unlink(child.c_str()) != 0)
+			success = false;
+	}
+	os_closedir(d);
+	return os_rmdir(path.c_str()) == 0 && success;
+}
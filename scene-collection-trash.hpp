@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TrashEntry {
+	std::string path;
+	std::string name;
+	std::string file;
+	std::string backup_dir;
+	std::string backup_trash;
+	int64_t deleted = 0;
+};
+
+std::string GetTrashDirectory(const std::string &sceneCollectionsPath);
+
+/* moves the scene collection file and its backup directory into the trash, only renames are used so this does not
+ * depend on the number of backups, a backup directory on another file system is renamed next to where it is */
+bool MoveToTrash(const std::string &trashDir, const std::string &name, const std::string &file, const std::string &backupDir,
+		 TrashEntry &entry);
+bool RestoreFromTrash(const TrashEntry &entry);
+
+/* trash entries, most recently deleted first */
+std::vector<TrashEntry> ListTrash(const std::string &trashDir);
+/* permanently removes the trash entries deleted more than retention seconds ago, except those in keep */
+size_t PurgeTrash(const std::string &trashDir, int64_t retention, const std::vector<std::string> &keep = {});
+
+bool RemoveDirectoryRecursive(const std::string &dir);
@@ -0,0 +1,159 @@
+#include "source-type-mappings.hpp"
+#include "util/platform.h"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <obs-nix-platform.h>
+#endif
+
+bool SourceTypeMappings::Load(const char *file)
+{
+	if (!file || !os_file_exists(file))
+		return false;
+	obs_data_t *data = obs_data_create_from_json_file(file);
+	if (!data) {
+		blog(LOG_WARNING, "[Scene Collection Manager] failed to read source mappings '%s'", file);
+		return false;
+	}
+	const std::pair<const char *, std::vector<SourceTarget>> sections[] = {
+		{"windows", {SourceTarget::Windows}},
+		{"mac", {SourceTarget::Mac}},
+		{"linux", {SourceTarget::LinuxX11, SourceTarget::LinuxWayland}},
+		{"linux_x11", {SourceTarget::LinuxX11}},
+		{"linux_wayland", {SourceTarget::LinuxWayland}},
+	};
+	for (const auto &section : sections) {
+		obs_data_array_t *entries = obs_data_get_array(data, section.first);
+		if (!entries)
+			continue;
+		for (auto target : section.second)
+			Add(target, entries);
+		obs_data_array_release(entries);
+	}
+	obs_data_release(data);
+	return true;
+}
+
+void SourceTypeMappings::Add(SourceTarget target, obs_data_array_t *entries)
+{
+	auto &mappings = targets[(size_t)target];
+	const size_t count = obs_data_array_count(entries);
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *entry = obs_data_array_item(entries, i);
+		if (!entry)
+			continue;
+		const char *from = obs_data_get_string(entry, "from");
+		const char *to = obs_data_get_string(entry, "to");
+		if (!*from) {
+			obs_data_release(entry);
+			continue;
+		}
+		if (!*to) {
+			mappings.erase(from);
+			obs_data_release(entry);
+			continue;
+		}
+		SourceTypeMapping mapping;
+		mapping.id = to;
+		obs_data_set_default_bool(entry, "reset_settings", true);
+		mapping.reset_settings = obs_data_get_bool(entry, "reset_settings");
+		if (obs_data_t *settings = obs_data_get_obj(entry, "settings")) {
+			for (obs_data_item_t *item = obs_data_first(settings); item; obs_data_item_next(&item)) {
+				if (obs_data_item_gettype(item) == OBS_DATA_STRING)
+					mapping.settings.emplace_back(obs_data_item_get_name(item), obs_data_item_get_string(item));
+			}
+			obs_data_release(settings);
+		}
+		mappings[from] = std::move(mapping);
+		obs_data_release(entry);
+	}
+}
+
+const SourceTypeMapping *SourceTypeMappings::Find(SourceTarget target, const char *id) const
+{
+	const auto &mappings = targets[(size_t)target];
+	const auto it = mappings.find(id);
+	return it == mappings.end() ? nullptr : &it->second;
+}
+
+bool SourceTypeMappings::Apply(obs_data_t *source, SourceTarget target) const
+{
+	const SourceTypeMapping *mapping = Find(target, obs_data_get_string(source, "id"));
+	if (!mapping)
+		return false;
+
+	obs_data_set_string(source, "id", mapping->id.c_str());
+	const char *vid = obs_initialized() ? obs_get_latest_input_type_id(mapping->id.c_str()) : nullptr;
+	obs_data_set_string(source, "versioned_id", vid ? vid : mapping->id.c_str());
+
+	obs_data_t *settings = obs_data_get_obj(source, "settings");
+	if (mapping->reset_settings) {
+		obs_data_t *c = obs_data_create();
+		if (settings) {
+			for (const auto &key : mapping->settings)
+				CopyDataItem(settings, key.first.c_str(), c, key.second.c_str());
+		}
+		obs_data_set_obj(source, "settings", c);
+		obs_data_release(c);
+	} else if (settings) {
+		for (const auto &key : mapping->settings) {
+			if (key.first == key.second)
+				continue;
+			if (CopyDataItem(settings, key.first.c_str(), settings, key.second.c_str()))
+				obs_data_erase(settings, key.first.c_str());
+		}
+	}
+	obs_data_release(settings);
+	return true;
+}
+
+SourceTarget GetCurrentSourceTarget()
+{
+#ifdef _WIN32
+	return SourceTarget::Windows;
+#elif defined(__APPLE__)
+	return SourceTarget::Mac;
+#else
+	return obs_get_nix_platform() == OBS_NIX_PLATFORM_X11_EGL ? SourceTarget::LinuxX11 : SourceTarget::LinuxWayland;
+#endif
+}
+
+bool CopyDataItem(obs_data_t *from, const char *from_name, obs_data_t *to, const char *to_name)
+{
+	if (!obs_data_has_user_value(from, from_name))
+		return false;
+	obs_data_item_t *item = obs_data_item_byname(from, from_name);
+	if (!item)
+		return false;
+	bool copied = true;
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		obs_data_set_string(to, to_name, obs_data_item_get_string(item));
+		break;
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT)
+			obs_data_set_int(to, to_name, obs_data_item_get_int(item));
+		else
+			obs_data_set_double(to, to_name, obs_data_item_get_double(item));
+		break;
+	case OBS_DATA_BOOLEAN:
+		obs_data_set_bool(to, to_name, obs_data_item_get_bool(item));
+		break;
+	case OBS_DATA_OBJECT: {
+		obs_data_t *obj = obs_data_item_get_obj(item);
+		obs_data_set_obj(to, to_name, obj);
+		obs_data_release(obj);
+		break;
+	}
+	case OBS_DATA_ARRAY: {
+		obs_data_array_t *array = obs_data_item_get_array(item);
+		obs_data_set_array(to, to_name, array);
+		obs_data_array_release(array);
+		break;
+	}
+	default:
+		copied = false;
+		break;
+	}
+	obs_data_item_release(&item);
+	return copied;
+}
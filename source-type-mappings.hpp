@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "obs.h"
+
+enum class SourceTarget { Windows, Mac, LinuxX11, LinuxWayland, Count };
+
+struct SourceTypeMapping {
+	std::string id;
+	bool reset_settings = true;
+	/* settings keys carried over to the new source type, old key to new key */
+	std::vector<std::pair<std::string, std::string>> settings;
+};
+
+class SourceTypeMappings {
+public:
+	/* entries of later loaded files replace earlier ones, an empty "to" removes a mapping */
+	bool Load(const char *file);
+	const SourceTypeMapping *Find(SourceTarget target, const char *id) const;
+	bool Apply(obs_data_t *source, SourceTarget target) const;
+
+private:
+	void Add(SourceTarget target, obs_data_array_t *entries);
+
+	std::array<std::unordered_map<std::string, SourceTypeMapping>, (size_t)SourceTarget::Count> targets;
+};
+
+SourceTarget GetCurrentSourceTarget();
+bool CopyDataItem(obs_data_t *from, const char *from_name, obs_data_t *to, const char *to_name);